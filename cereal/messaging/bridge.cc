@@ -1,13 +1,18 @@
+#include <getopt.h>
+
 #include <algorithm>
 #include <cassert>
 #include <csignal>
 #include <iostream>
 #include <map>
+#include <sstream>
 #include <string>
 
 typedef void (*sighandler_t)(int sig);
 
+#include "cereal/messaging/bridge_mux.h"
 #include "cereal/services.h"
+#include "common/timing.h"
 #include "msgq/impl_msgq.h"
 #include "msgq/impl_zmq.h"
 
@@ -34,14 +39,91 @@ static std::vector<std::string> get_services(std::string whitelist_str, bool zmq
   return service_list;
 }
 
+// "service=hz,service=hz"
+static bool parse_rate_limits(const std::string &str, std::map<std::string, double> &rate_limits) {
+  std::stringstream ss(str);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    auto pos = item.find('=');
+    if (pos == std::string::npos) return false;
+    try {
+      size_t len = 0;
+      const std::string hz = item.substr(pos + 1);
+      rate_limits[item.substr(0, pos)] = std::stod(hz, &len);
+      if (len != hz.size()) return false;
+    } catch (const std::exception &) {
+      return false;  // not a number, or out of range
+    }
+  }
+  return true;
+}
+
+template <class Bridge>
+static int run_mux(Bridge &bridge, const char *name) {
+  const double report_interval = 5.0;
+  double last_report = seconds_since_boot();
+  while (!do_exit) {
+    bridge.poll(100);
+
+    const double now = seconds_since_boot();
+    if (now - last_report >= report_interval) {
+      bridge.takeStats().report(name, now - last_report);
+      last_report = now;
+    }
+  }
+  return 0;
+}
+
+static void usage(const char *prog) {
+  std::cerr << "usage: " << prog << "                    msgq -> zmq, one socket per service\n"
+            << "       " << prog << " <ip> <whitelist>   zmq -> msgq, one socket per service\n"
+            << "       " << prog << " -m [-w ms] [-z level] [-r service=hz,...] [-p port]\n"
+            << "                                msgq -> zmq, all services batched over a single connection\n"
+            << "       " << prog << " -m [-p port] <ip> [whitelist]\n"
+            << "                                zmq -> msgq, from a multiplexed bridge\n";
+}
+
 int main(int argc, char** argv) {
   signal(SIGPIPE, (sighandler_t)sigpipe_handler);
   signal(SIGINT, (sighandler_t)set_do_exit);
   signal(SIGTERM, (sighandler_t)set_do_exit);
 
-  bool zmq_to_msgq = argc > 2;
-  std::string ip = zmq_to_msgq ? argv[1] : "127.0.0.1";
-  std::string whitelist_str = zmq_to_msgq ? std::string(argv[2]) : "";
+  bool mux = false;
+  BridgeMuxConfig mux_config;
+  int opt;
+  while ((opt = getopt(argc, argv, "mw:z:r:p:")) != -1) {
+    switch (opt) {
+      case 'm': mux = true; break;
+      case 'w': mux_config.window_ms = std::max(0, atoi(optarg)); break;
+      case 'z': mux_config.compression_level = atoi(optarg); break;
+      case 'p': mux_config.port = atoi(optarg); break;
+      case 'r':
+        if (!parse_rate_limits(optarg, mux_config.rate_limits)) {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  argc -= optind;
+  argv += optind;
+
+  if (mux) {
+    if (argc == 0) {
+      BridgeMuxSender sender(get_services("", false), mux_config);
+      return run_mux(sender, "bridge tx");
+    }
+    std::string whitelist_str = argc > 1 ? argv[1] : "";
+    BridgeMuxReceiver receiver(argv[0], get_services(whitelist_str, !whitelist_str.empty()), mux_config);
+    return run_mux(receiver, "bridge rx");
+  }
+
+  bool zmq_to_msgq = argc > 1;
+  std::string ip = zmq_to_msgq ? argv[0] : "127.0.0.1";
+  std::string whitelist_str = zmq_to_msgq ? std::string(argv[1]) : "";
 
   Poller *poller;
   Context *pub_context;
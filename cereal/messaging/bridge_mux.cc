@@ -0,0 +1,258 @@
+#include "cereal/messaging/bridge_mux.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+#include "common/timing.h"
+
+void BridgeMuxStats::addLatency(uint64_t us) {
+  latency_sum_us += us;
+  latency_max_us = std::max(latency_max_us, us);
+}
+
+void BridgeMuxStats::report(const char *name, double seconds) const {
+  printf("%s: %" PRIu64 " msgs (%" PRIu64 " dropped) in %" PRIu64 " batches, %.1f KB/s raw, %.1f KB/s wire, latency avg %.2f ms max %.2f ms\n",
+         name, messages, dropped, batches, raw_bytes / 1024.0 / seconds, wire_bytes / 1024.0 / seconds,
+         batches ? latency_sum_us / 1000.0 / batches : 0., latency_max_us / 1000.0);
+  fflush(stdout);
+}
+
+// BridgeMuxSender
+
+BridgeMuxSender::BridgeMuxSender(const std::vector<std::string> &services, const BridgeMuxConfig &config) : config_(config) {
+  sub_context_.reset(new MSGQContext());
+  pub_context_.reset(new ZMQContext());
+  poller_.reset(new MSGQPoller());
+
+  pub_sock_.reset(new ZMQPubSocket());
+  int ret = pub_sock_->connect(pub_context_.get(), std::to_string(config_.port), false);
+  assert(ret == 0);
+
+  for (const auto &name : services) {
+    SubSocket *sock = new MSGQSubSocket();
+    sock->connect(sub_context_.get(), name, "127.0.0.1", false);
+    poller_->registerSocket(sock);
+
+    Service &s = sockets_[sock];
+    s.name = name;
+    if (auto it = config_.rate_limits.find(name); it != config_.rate_limits.end() && it->second > 0) {
+      s.min_interval = 1e9 / it->second;
+    }
+  }
+
+  if (config_.compression_level > 0) {
+    cctx_ = ZSTD_createCCtx();
+    ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel, config_.compression_level);
+  }
+}
+
+BridgeMuxSender::~BridgeMuxSender() {
+  flush();
+  for (auto &[sock, _] : sockets_) delete sock;
+  ZSTD_freeCCtx(cctx_);
+}
+
+void BridgeMuxSender::poll(int timeout_ms) {
+  if (batch_count_ > 0) {
+    const int remaining = config_.window_ms - (int)((nanos_since_boot() - batch_start_) / 1000000);
+    timeout_ms = std::clamp(remaining, 0, timeout_ms);
+  }
+
+  for (auto sock : poller_->poll(timeout_ms)) {
+    Service &service = sockets_.at(sock);
+    // drain everything queued on the socket since the last poll
+    while (Message *msg = sock->receive(true)) {
+      append(service, msg, nanos_since_boot());
+      delete msg;
+    }
+  }
+
+  if (batch_count_ > 0 && (nanos_since_boot() - batch_start_) >= config_.window_ms * 1000000ULL) {
+    flush();
+  }
+}
+
+// Rate limits go by the messages' own log time, so which messages pass doesn't depend on
+// when the bridge got to read them off the socket.
+uint64_t BridgeMuxSender::logMonoTime(Message *msg, uint64_t fallback) {
+  try {
+    capnp::FlatArrayMessageReader reader(aligned_buf_.align(msg));
+    return reader.getRoot<cereal::Event>().getLogMonoTime();
+  } catch (const kj::Exception &) {
+    return fallback;
+  }
+}
+
+void BridgeMuxSender::append(Service &service, Message *msg, uint64_t now) {
+  if (service.min_interval > 0) {
+    const uint64_t t = logMonoTime(msg, now);
+    // a log time going backwards, e.g. from a restarted publisher, starts over
+    if (t >= service.last_forwarded && t - service.last_forwarded < service.min_interval) {
+      ++stats_.dropped;
+      return;
+    }
+    service.last_forwarded = t;
+  }
+
+  if (batch_count_ == 0) {
+    batch_.assign(sizeof(BridgeMuxHeader), '\0');
+    batch_start_ = now;
+  }
+
+  const uint8_t name_len = service.name.size();
+  const uint32_t size = msg->getSize();
+  batch_.append((const char *)&name_len, sizeof(name_len));
+  batch_.append(service.name);
+  batch_.append((const char *)&size, sizeof(size));
+  batch_.append(msg->getData(), size);
+  ++batch_count_;
+  ++stats_.messages;
+
+  if (batch_.size() >= config_.flush_size) {
+    flush();
+  }
+}
+
+void BridgeMuxSender::flush() {
+  if (batch_count_ == 0) return;
+
+  BridgeMuxHeader header = {
+    .magic = BRIDGE_MUX_MAGIC,
+    .version = BRIDGE_MUX_VERSION,
+    .count = batch_count_,
+    .raw_size = uint32_t(batch_.size() - sizeof(BridgeMuxHeader)),
+    .send_time = nanos_since_epoch(),
+  };
+
+  std::string *out = &batch_;
+  if (cctx_) {
+    compressed_.resize(sizeof(BridgeMuxHeader) + ZSTD_compressBound(header.raw_size));
+    size_t size = ZSTD_compress2(cctx_, compressed_.data() + sizeof(BridgeMuxHeader), compressed_.size() - sizeof(BridgeMuxHeader),
+                                 batch_.data() + sizeof(BridgeMuxHeader), header.raw_size);
+    // send small or incompressible batches as is
+    if (!ZSTD_isError(size) && size < header.raw_size) {
+      compressed_.resize(sizeof(BridgeMuxHeader) + size);
+      header.compressed = 1;
+      out = &compressed_;
+    }
+  }
+  memcpy(out->data(), &header, sizeof(header));
+
+  int ret;
+  do {
+    ret = pub_sock_->send(out->data(), out->size());
+  } while (ret == -1 && errno == EINTR);
+
+  if (ret >= 0) {
+    ++stats_.batches;
+    stats_.raw_bytes += header.raw_size;
+    stats_.wire_bytes += out->size();
+    stats_.addLatency((nanos_since_boot() - batch_start_) / 1000);
+  } else {
+    stats_.dropped += batch_count_;
+  }
+  batch_count_ = 0;
+}
+
+BridgeMuxStats BridgeMuxSender::takeStats() {
+  return std::exchange(stats_, {});
+}
+
+// BridgeMuxReceiver
+
+BridgeMuxReceiver::BridgeMuxReceiver(const std::string &ip, const std::vector<std::string> &services, const BridgeMuxConfig &config) {
+  sub_context_.reset(new ZMQContext());
+  pub_context_.reset(new MSGQContext());
+  poller_.reset(new ZMQPoller());
+
+  sub_sock_.reset(new ZMQSubSocket());
+  int ret = sub_sock_->connect(sub_context_.get(), std::to_string(config.port), ip, false, false);
+  assert(ret == 0);
+  poller_->registerSocket(sub_sock_.get());
+
+  for (const auto &name : services) {
+    auto &sock = pub_socks_[name];
+    sock.reset(new MSGQPubSocket());
+    sock->connect(pub_context_.get(), name);
+  }
+  dctx_ = ZSTD_createDCtx();
+}
+
+BridgeMuxReceiver::~BridgeMuxReceiver() {
+  ZSTD_freeDCtx(dctx_);
+}
+
+void BridgeMuxReceiver::poll(int timeout_ms) {
+  for (auto sock : poller_->poll(timeout_ms)) {
+    while (Message *msg = sock->receive(true)) {
+      if (!unpack(msg->getData(), msg->getSize())) {
+        fprintf(stderr, "bridge: dropping malformed batch of %zu bytes\n", msg->getSize());
+      }
+      delete msg;
+    }
+  }
+}
+
+bool BridgeMuxReceiver::unpack(const char *data, size_t size) {
+  BridgeMuxHeader header;
+  if (size < sizeof(header)) return false;
+  memcpy(&header, data, sizeof(header));
+  if (header.magic != BRIDGE_MUX_MAGIC || header.version != BRIDGE_MUX_VERSION || header.raw_size > BRIDGE_MUX_MAX_BATCH_SIZE) {
+    return false;
+  }
+
+  std::string_view records(data + sizeof(header), size - sizeof(header));
+  if (header.compressed) {
+    decompressed_.resize(header.raw_size);
+    size_t ret = ZSTD_decompressDCtx(dctx_, decompressed_.data(), decompressed_.size(), records.data(), records.size());
+    if (ZSTD_isError(ret) || ret != header.raw_size) return false;
+    records = decompressed_;
+  } else if (records.size() != header.raw_size) {
+    return false;
+  }
+
+  ++stats_.batches;
+  stats_.raw_bytes += header.raw_size;
+  stats_.wire_bytes += size;
+  const uint64_t now = nanos_since_epoch();
+  stats_.addLatency(now > header.send_time ? (now - header.send_time) / 1000 : 0);
+
+  for (uint32_t i = 0; i < header.count; ++i) {
+    uint8_t name_len;
+    uint32_t msg_size;
+    if (records.size() < sizeof(name_len)) return false;
+    memcpy(&name_len, records.data(), sizeof(name_len));
+    records.remove_prefix(sizeof(name_len));
+    if (records.size() < name_len + sizeof(msg_size)) return false;
+    std::string_view name = records.substr(0, name_len);
+    memcpy(&msg_size, records.data() + name_len, sizeof(msg_size));
+    records.remove_prefix(name_len + sizeof(msg_size));
+    if (records.size() < msg_size) return false;
+
+    auto it = pub_socks_.find(name);
+    if (it != pub_socks_.end()) {
+      int ret;
+      do {
+        ret = it->second->send((char *)records.data(), msg_size);
+      } while (ret == -1 && errno == EINTR);
+      if (ret >= 0) {
+        ++stats_.messages;
+      } else {
+        ++stats_.dropped;
+      }
+    } else {
+      ++stats_.dropped;
+    }
+    records.remove_prefix(msg_size);
+  }
+  return true;
+}
+
+BridgeMuxStats BridgeMuxReceiver::takeStats() {
+  return std::exchange(stats_, {});
+}
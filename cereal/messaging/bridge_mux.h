@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <zstd.h>
+
+#include "cereal/messaging/messaging.h"
+#include "msgq/impl_msgq.h"
+#include "msgq/impl_zmq.h"
+
+// Multiplexed bridge: every service is forwarded over a single ZMQ connection.
+// Messages are collected for a short window and sent as one batch, optionally
+// zstd compressed. Batch layout:
+//   BridgeMuxHeader, then `count` records of
+//   [uint8 name length][name][uint32 size][data]
+
+const int BRIDGE_MUX_PORT = 8022;  // just below the range used for per-service ports
+const uint32_t BRIDGE_MUX_MAGIC = 0x58554d42;  // "BMUX"
+const uint8_t BRIDGE_MUX_VERSION = 1;
+const size_t BRIDGE_MUX_MAX_BATCH_SIZE = 64 * 1024 * 1024;
+
+struct BridgeMuxHeader {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t compressed;
+  uint16_t reserved;
+  uint32_t count;
+  uint32_t raw_size;   // size of the records before compression
+  uint64_t send_time;  // nanos_since_epoch, so latency is only meaningful with synced clocks
+};
+static_assert(sizeof(BridgeMuxHeader) == 24);
+
+struct BridgeMuxConfig {
+  int port = BRIDGE_MUX_PORT;
+  int window_ms = 10;
+  size_t flush_size = 1024 * 1024;    // flush early once a batch grows this large
+  int compression_level = 0;          // zstd level, 0 sends batches uncompressed
+  std::map<std::string, double> rate_limits;  // service -> max forwarded rate in Hz, by logMonoTime
+};
+
+struct BridgeMuxStats {
+  uint64_t messages = 0;
+  uint64_t dropped = 0;     // rate limited messages, batches or messages the socket refused
+  uint64_t batches = 0;
+  uint64_t raw_bytes = 0;
+  uint64_t wire_bytes = 0;
+  uint64_t latency_sum_us = 0;  // batching delay on the sender, send to receive on the receiver
+  uint64_t latency_max_us = 0;
+
+  void addLatency(uint64_t us);
+  void report(const char *name, double seconds) const;
+};
+
+class BridgeMuxSender {
+public:
+  BridgeMuxSender(const std::vector<std::string> &services, const BridgeMuxConfig &config);
+  ~BridgeMuxSender();
+  // receives for up to timeout_ms and sends the batch once its window has passed
+  void poll(int timeout_ms);
+  void flush();
+  BridgeMuxStats takeStats();
+
+private:
+  struct Service {
+    std::string name;
+    uint64_t min_interval = 0;  // ns, from the rate limit
+    uint64_t last_forwarded = 0;  // logMonoTime of the last forwarded message
+  };
+  void append(Service &service, Message *msg, uint64_t now);
+  uint64_t logMonoTime(Message *msg, uint64_t fallback);
+
+  BridgeMuxConfig config_;
+  std::unique_ptr<Context> sub_context_, pub_context_;
+  std::unique_ptr<Poller> poller_;
+  std::unique_ptr<PubSocket> pub_sock_;
+  std::map<SubSocket *, Service> sockets_;
+  ZSTD_CCtx *cctx_ = nullptr;
+  AlignedBuffer aligned_buf_;
+
+  std::string batch_;  // header followed by the records
+  std::string compressed_;
+  uint32_t batch_count_ = 0;
+  uint64_t batch_start_ = 0;
+  BridgeMuxStats stats_;
+};
+
+class BridgeMuxReceiver {
+public:
+  // republishes the given services, messages for any other service are dropped
+  BridgeMuxReceiver(const std::string &ip, const std::vector<std::string> &services, const BridgeMuxConfig &config);
+  ~BridgeMuxReceiver();
+  void poll(int timeout_ms);
+  BridgeMuxStats takeStats();
+
+private:
+  bool unpack(const char *data, size_t size);
+
+  std::unique_ptr<Context> sub_context_, pub_context_;
+  std::unique_ptr<Poller> poller_;
+  std::unique_ptr<SubSocket> sub_sock_;
+  std::map<std::string, std::unique_ptr<PubSocket>, std::less<>> pub_socks_;
+  ZSTD_DCtx *dctx_ = nullptr;
+  std::string decompressed_;
+  BridgeMuxStats stats_;
+};
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+import os
+import random
+import shutil
+import subprocess
+import time
+import unittest
+import uuid
+from contextlib import contextmanager
+from parameterized import parameterized
+
+import cereal.messaging as messaging
+from cereal.messaging.tests.test_messaging import random_carstate, assert_carstate
+
+BRIDGE = os.path.join(os.path.dirname(os.path.realpath(__file__)), "..", "bridge")
+
+
+@contextmanager
+def msgq_prefix(prefix):
+  original = os.environ.get("OPENPILOT_PREFIX")
+  os.environ["OPENPILOT_PREFIX"] = prefix
+  try:
+    yield
+  finally:
+    if original is None:
+      del os.environ["OPENPILOT_PREFIX"]
+    else:
+      os.environ["OPENPILOT_PREFIX"] = original
+
+
+@unittest.skipIf("ZMQ" in os.environ, "the bridge needs msgq on both ends")
+@unittest.skipIf(not os.path.isfile(BRIDGE), "bridge not built")
+class TestMuxBridge(unittest.TestCase):
+  # tx and rx run in separate msgq namespaces on the same machine, joined over loopback
+
+  def setUp(self):
+    self.tx_prefix, self.rx_prefix = (f"bridge_{uuid.uuid4().hex[:8]}" for _ in range(2))
+    for p in (self.tx_prefix, self.rx_prefix):
+      os.mkdir(os.path.join("/dev/shm", p))
+    self.port = str(random.randint(8000, 8020))
+    self.procs = []
+
+  def tearDown(self):
+    for p in self.procs:
+      p.terminate()
+      p.wait(5)
+    for p in (self.tx_prefix, self.rx_prefix):
+      shutil.rmtree(os.path.join("/dev/shm", p), ignore_errors=True)
+
+  def _start(self, prefix, *args):
+    env = {**os.environ, "OPENPILOT_PREFIX": prefix}
+    self.procs.append(subprocess.Popen([BRIDGE, "-m", "-p", self.port, *args], env=env, stdout=subprocess.DEVNULL))
+
+  def _connect(self, service, tx_args=(), rx_args=()):
+    self._start(self.tx_prefix, *tx_args)
+    self._start(self.rx_prefix, *rx_args, "127.0.0.1")
+    with msgq_prefix(self.tx_prefix):
+      pub = messaging.pub_sock(service)
+    with msgq_prefix(self.rx_prefix):
+      sub = messaging.sub_sock(service, timeout=100)
+
+    # wait for the zmq connection to come up
+    for _ in range(100):
+      pub.send(random_carstate().to_bytes())
+      if sub.receive() is not None:
+        break
+    else:
+      raise AssertionError("bridge never connected")
+    time.sleep(0.1)
+    messaging.drain_sock_raw(sub)
+    return pub, sub
+
+  @parameterized.expand([("uncompressed", []), ("zstd", ["-z", "3"])])
+  def test_loopback(self, _, tx_args):
+    pub, sub = self._connect("carState", tx_args=tx_args)
+
+    sent = [random_carstate() for _ in range(200)]
+    for msg in sent:
+      pub.send(msg.to_bytes())
+
+    received = []
+    start = time.monotonic()
+    while len(received) < len(sent) and time.monotonic() - start < 5:
+      received += messaging.drain_sock(sub, wait_for_one=True)
+
+    self.assertEqual(len(received), len(sent))
+    for s, r in zip(sent, received, strict=True):
+      self.assertEqual(s.logMonoTime, r.logMonoTime)
+      assert_carstate(s.carState, r.carState)
+
+  def test_rate_limit(self):
+    pub, sub = self._connect("carState", tx_args=["-r", "carState=10"])
+
+    # the limit applies to logMonoTime, so a burst of 1s of 100Hz messages forwards exactly 10
+    start_time = int(time.monotonic() * 1e9) + int(1e9)
+    sent = []
+    for i in range(100):
+      msg = random_carstate()
+      msg.logMonoTime = start_time + i * int(1e7)
+      sent.append(msg)
+      pub.send(msg.to_bytes())
+
+    received = []
+    start = time.monotonic()
+    while time.monotonic() - start < 1:
+      received += messaging.drain_sock(sub, wait_for_one=True)
+    self.assertEqual([m.logMonoTime for m in received], [m.logMonoTime for m in sent[::10]])
+
+  def test_whitelist(self):
+    self._start(self.rx_prefix, "127.0.0.1", "carState")
+    self._start(self.tx_prefix)
+    with msgq_prefix(self.tx_prefix):
+      pub_cs, pub_cc = messaging.pub_sock("carState"), messaging.pub_sock("carControl")
+    with msgq_prefix(self.rx_prefix):
+      sub_cs, sub_cc = messaging.sub_sock("carState", timeout=100), messaging.sub_sock("carControl", timeout=100)
+
+    for _ in range(100):
+      pub_cs.send(messaging.new_message("carState").to_bytes())
+      pub_cc.send(messaging.new_message("carControl").to_bytes())
+      if sub_cs.receive() is not None:
+        break
+    else:
+      raise AssertionError("bridge never connected")
+    time.sleep(0.1)
+    self.assertEqual(len(messaging.drain_sock_raw(sub_cc)), 0)
+
+
+if __name__ == "__main__":
+  unittest.main()
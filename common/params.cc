@@ -1,7 +1,10 @@
 #include "common/params.h"
 
 #include <dirent.h>
+#include <poll.h>
+#include <sys/eventfd.h>
 #include <sys/file.h>
+#include <sys/inotify.h>
 
 #include <algorithm>
 #include <cassert>
@@ -191,6 +194,7 @@ std::unordered_map<std::string, uint32_t> keys = {
     {"PrimeType", PERSISTENT},
     {"RecordFront", PERSISTENT},
     {"RecordFrontLock", PERSISTENT},  // for the internal fleet
+    {"RecordZstdLogs", PERSISTENT},
     {"ReplayControlsState", CLEAR_ON_MANAGER_START | CLEAR_ON_ONROAD_TRANSITION},
     {"RouteCount", PERSISTENT},
     {"SecOCKey", PERSISTENT | DONT_LOG},
@@ -539,9 +543,112 @@ std::unordered_map<std::string, uint32_t> keys = {
 } // namespace
 
 
-Params::Params(const std::string &path) {
+ParamsCache::ParamsCache(const std::string &dir) : dir(dir) {
+  inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  exit_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (inotify_fd < 0 || exit_fd < 0 || !addWatch()) {
+    throw std::runtime_error(util::string_format("Failed to watch params path, errno=%d, path=%s", errno, dir.c_str()));
+  }
+  thread = std::thread(&ParamsCache::watchThread, this);
+}
+
+ParamsCache::~ParamsCache() {
+  uint64_t val = 1;
+  [[maybe_unused]] ssize_t ret = write(exit_fd, &val, sizeof(val));
+  thread.join();
+  close(exit_fd);
+  close(inotify_fd);
+}
+
+ParamsCache::Value ParamsCache::read(const std::string &key) {
+  std::unique_lock lk(lock);
+  if (auto it = values.find(key); it != values.end()) {
+    return it->second;
+  }
+  const uint64_t gen = generation;
+  lk.unlock();
+
+  Value v = {.str = util::read_file(dir + "/" + key)};
+  v.b = v.str == "1";
+  v.i = std::strtol(v.str.c_str(), nullptr, 10);
+  v.f = std::strtof(v.str.c_str(), nullptr);
+
+  lk.lock();
+  // don't cache a value that may have been replaced while it was being read,
+  // or one that no watch would invalidate
+  if (watching && gen == generation) {
+    values.emplace(key, v);
+  }
+  return v;
+}
+
+void ParamsCache::invalidate(const std::string &key) {
+  std::lock_guard lk(lock);
+  values.erase(key);
+  generation++;
+}
+
+void ParamsCache::clear() {
+  std::lock_guard lk(lock);
+  values.clear();
+  generation++;
+}
+
+bool ParamsCache::addWatch() {
+  // params are replaced by rename, so watching for moves and unlinks is enough. The directory
+  // itself moving away or being deleted ends the watch with IN_IGNORED.
+  wd = inotify_add_watch(inotify_fd, dir.c_str(), IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CLOSE_WRITE | IN_MOVE_SELF);
+  setWatching(wd >= 0);
+  return wd >= 0;
+}
+
+void ParamsCache::setWatching(bool watch) {
+  std::lock_guard lk(lock);
+  watching = watch;
+  values.clear();
+  generation++;
+}
+
+void ParamsCache::watchThread() {
+  util::set_thread_name("params_cache");
+  alignas(struct inotify_event) char buf[4096];
+  struct pollfd fds[] = {{.fd = inotify_fd, .events = POLLIN}, {.fd = exit_fd, .events = POLLIN}};
+  while (true) {
+    // while the directory is gone reads go to disk, and the watch is retried every 100ms
+    // until the directory is recreated
+    if (wd < 0 && !addWatch() && errno != ENOENT) {
+      LOGE("Failed to watch params path, errno=%d, path=%s", errno, dir.c_str());
+    }
+    if (HANDLE_EINTR(poll(fds, 2, wd < 0 ? 100 : -1)) <= 0) continue;
+    if (fds[1].revents & POLLIN) break;
+
+    ssize_t len;
+    while ((len = ::read(inotify_fd, buf, sizeof(buf))) > 0) {
+      for (char *p = buf; p < buf + len;) {
+        auto event = (const struct inotify_event *)p;
+        if (event->mask & IN_Q_OVERFLOW) {
+          clear();
+        } else if (event->mask & IN_MOVE_SELF) {
+          // the path no longer leads to the watched directory, drop the watch
+          inotify_rm_watch(inotify_fd, event->wd);
+        } else if ((event->mask & IN_IGNORED) && event->wd == wd) {
+          wd = -1;
+          setWatching(false);
+        } else if (event->len > 0) {
+          invalidate(event->name);
+        }
+        p += sizeof(struct inotify_event) + event->len;
+      }
+    }
+  }
+}
+
+Params::Params(const std::string &path, bool cached) {
   params_prefix = "/" + util::getenv("OPENPILOT_PREFIX", "d");
   params_path = ensure_params_path(params_prefix, path);
+  if (cached) {
+    cache = std::make_unique<ParamsCache>(getParamPath());
+  }
 }
 
 Params::~Params() {
@@ -599,6 +706,9 @@ int Params::put(const char* key, const char* value, size_t value_size) {
     result = fsync_dir(getParamPath());
   } while (false);
 
+  // don't wait for inotify to see our own write
+  if (cache) cache->invalidate(key);
+
   close(tmp_fd);
   if (result != 0) {
     ::unlink(tmp_path.c_str());
@@ -609,6 +719,7 @@ int Params::put(const char* key, const char* value, size_t value_size) {
 int Params::remove(const std::string &key) {
   FileLock file_lock(params_path + "/.lock");
   int result = unlink(getParamPath(key).c_str());
+  if (cache) cache->invalidate(key);
   if (result != 0) {
     return result;
   }
@@ -616,6 +727,12 @@ int Params::remove(const std::string &key) {
 }
 
 std::string Params::get(const std::string &key, bool block) {
+  if (cache) {
+    // a blocking read of a cached key that is already set doesn't need to wait
+    std::string value = cache->get(key);
+    if (!block || !value.empty()) return value;
+  }
+
   if (!block) {
     return util::read_file(getParamPath(key));
   } else {
@@ -662,6 +779,7 @@ void Params::clearAll(ParamKeyType key_type) {
   }
 
   fsync_dir(getParamPath());
+  if (cache) cache->clear();
 }
 
 void Params::putNonBlocking(const std::string &key, const std::string &val) {
@@ -2,8 +2,12 @@
 
 #include <future>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -19,9 +23,49 @@ enum ParamKeyType {
   ALL = 0xFFFFFFFF
 };
 
+// In-memory cache of parsed param values. Entries are loaded on first read and dropped
+// when inotify reports the file was replaced or removed, so reads of a cached key are a
+// hash lookup instead of an open/read/close. If the params directory is removed, the cache
+// is dropped and reads go to disk until it is recreated and watched again.
+class ParamsCache {
+public:
+  struct Value {
+    std::string str;
+    bool b = false;
+    int i = 0;
+    float f = 0;
+  };
+
+  ParamsCache(const std::string &dir);
+  ~ParamsCache();
+  std::string get(const std::string &key) { return read(key).str; }
+  bool getBool(const std::string &key) { return read(key).b; }
+  int getInt(const std::string &key) { return read(key).i; }
+  float getFloat(const std::string &key) { return read(key).f; }
+  void invalidate(const std::string &key);
+  void clear();
+
+private:
+  Value read(const std::string &key);
+  bool addWatch();
+  void setWatching(bool watch);
+  void watchThread();
+
+  const std::string dir;
+  int inotify_fd = -1;
+  int exit_fd = -1;  // eventfd, wakes the watch thread on destruction
+  int wd = -1;       // watch descriptor of dir, -1 while it's gone
+  std::mutex lock;
+  std::unordered_map<std::string, Value> values;
+  uint64_t generation = 0;  // bumped on every invalidation, see read()
+  bool watching = false;    // values are only cached while dir is watched
+  std::thread thread;
+};
+
 class Params {
 public:
-  explicit Params(const std::string &path = {});
+  // cached: serve non-blocking reads from a ParamsCache
+  explicit Params(const std::string &path = {}, bool cached = false);
   ~Params();
   // Not copyable.
   Params(const Params&) = delete;
@@ -41,13 +85,16 @@ public:
   // helpers for reading values
   std::string get(const std::string &key, bool block = false);
   inline bool getBool(const std::string &key, bool block = false) {
+    if (cache && !block) return cache->getBool(key);
     return get(key, block) == "1";
   }
   inline int getInt(const std::string &key, bool block = false) {
+    if (cache && !block) return cache->getInt(key);
     std::string value = get(key, block);
     return value.empty() ? 0 : std::stoi(value);
   }
   inline float getFloat(const std::string &key, bool block = false) {
+    if (cache && !block) return cache->getFloat(key);
     std::string value = get(key, block);
     return value.empty() ? 0.0 : std::stof(value);
   }
@@ -87,4 +134,6 @@ private:
   // for nonblocking write
   std::future<void> future;
   SafeQueue<std::pair<std::string, std::string>> queue;
+
+  std::unique_ptr<ParamsCache> cache;
 };
@@ -1,8 +1,21 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
 #include <condition_variable>
+#include <cstdint>
+#include <ctime>
 #include <mutex>
 #include <queue>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 template <class T>
 class SafeQueue {
@@ -50,3 +63,243 @@ private:
   std::condition_variable cv;
   std::queue<T> q;
 };
+
+// Bounded lock-free ring queues for per-frame hand-offs between threads. Capacity is a
+// power of two fixed at compile time, slots are reused in place and items are moved in
+// and out, so steady-state operation never allocates or takes a lock. push() blocks
+// while the queue is full and pop() while it is empty; both sleep on a futex instead of
+// a mutex, and the wake-up syscall is only made when the other side is actually asleep.
+// A blocked producer is woken once the queue has drained to half, not on every pop, so
+// a full queue doesn't turn into a context switch per item.
+namespace queue_detail {
+
+constexpr size_t CACHE_LINE = 64;
+
+// An event counter that threads can sleep on until a condition becomes true. The low bit
+// of the futex word is set while someone is asleep, and the first notify() after that
+// clears it and makes the one wake-up call.
+class WaitEvent {
+public:
+  // Call after making the condition true.
+  void notify() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint32_t s = word.load(std::memory_order_relaxed);
+    while (s & 1) {
+      if (word.compare_exchange_weak(s, s + 1, std::memory_order_relaxed)) {
+        wake();
+        break;
+      }
+    }
+  }
+
+  // Waits until ready() returns true. timeout_ms < 0 waits forever.
+  template <class F>
+  bool wait(F ready, int timeout_ms) {
+    if (ready()) return true;
+    if (timeout_ms == 0) return false;
+
+    // the other side is usually mid-operation, give it a chance before going to sleep
+    for (int i = 0; i < 4; ++i) {
+      std::this_thread::yield();
+      if (ready()) return true;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (true) {
+      const uint32_t s = word.fetch_or(1, std::memory_order_relaxed) | 1;
+      // pairs with the fence in notify(): either the notifier sees the bit, or we see its update
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (ready()) return true;
+
+      int64_t remaining_us = -1;
+      if (timeout_ms > 0) {
+        remaining_us = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (remaining_us <= 0) return false;
+      }
+      sleep(s, remaining_us);
+    }
+  }
+
+private:
+  void sleep(uint32_t s, int64_t timeout_us) {
+#ifdef __linux__
+    struct timespec ts = {(time_t)(timeout_us / 1000000), (long)(timeout_us % 1000000) * 1000};
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE, s, timeout_us < 0 ? nullptr : &ts, nullptr, 0);
+#else
+    // no futex, poll
+    std::this_thread::sleep_for(std::chrono::microseconds(timeout_us < 0 ? 100 : std::min<int64_t>(timeout_us, 100)));
+#endif
+  }
+
+  void wake() {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#endif
+  }
+
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free);
+  std::atomic<uint32_t> word = 0;
+};
+
+}  // namespace queue_detail
+
+// Single producer, single consumer. T must be default constructible and movable.
+template <class T, size_t N>
+class SpscQueue {
+  static_assert(N > 1 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+  bool try_push(T v) { return push_one(v); }
+
+  void push(T v) {
+    while (!push_one(v)) {
+      not_full.wait([this] { return !full(); }, -1);
+    }
+  }
+
+  bool try_pop(T &v, int timeout_ms = 0) {
+    while (!pop_one(v)) {
+      if (!not_empty.wait([this] { return !empty(); }, timeout_ms)) return false;
+    }
+    return true;
+  }
+
+  T pop() {
+    T v;
+    try_pop(v, -1);
+    return v;
+  }
+
+  bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+  bool full() const { return size() == N; }
+  size_t size() const {
+    const size_t h = head.load(std::memory_order_acquire);
+    return tail.load(std::memory_order_acquire) - h;
+  }
+  static constexpr size_t capacity() { return N; }
+
+private:
+  // v is only moved from on success
+  bool push_one(T &v) {
+    const size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head_cache == N) {
+      head_cache = head.load(std::memory_order_acquire);
+      if (t - head_cache == N) return false;
+    }
+    slots[t & (N - 1)] = std::move(v);
+    tail.store(t + 1, std::memory_order_release);
+    not_empty.notify();
+    return true;
+  }
+
+  bool pop_one(T &v) {
+    const size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail_cache) {
+      tail_cache = tail.load(std::memory_order_acquire);
+      if (h == tail_cache) return false;
+    }
+    v = std::move(slots[h & (N - 1)]);
+    head.store(h + 1, std::memory_order_release);
+    if (size() <= N / 2) not_full.notify();
+    return true;
+  }
+
+  // producer and consumer state on separate cache lines
+  alignas(queue_detail::CACHE_LINE) std::atomic<size_t> tail = 0;
+  size_t head_cache = 0;
+  alignas(queue_detail::CACHE_LINE) std::atomic<size_t> head = 0;
+  size_t tail_cache = 0;
+  alignas(queue_detail::CACHE_LINE) queue_detail::WaitEvent not_empty;
+  alignas(queue_detail::CACHE_LINE) queue_detail::WaitEvent not_full;
+  alignas(queue_detail::CACHE_LINE) T slots[N];
+};
+
+// Multiple producers, single consumer. Each slot carries a sequence number that tells
+// producers and the consumer whose turn it is, so producers only contend on a single
+// fetch position and never on each other's slots.
+template <class T, size_t N>
+class MpscQueue {
+  static_assert(N > 1 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+  MpscQueue() {
+    for (size_t i = 0; i < N; ++i) slots[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  bool try_push(T v) { return push_one(v); }
+
+  void push(T v) {
+    while (!push_one(v)) {
+      not_full.wait([this] { return !full(); }, -1);
+    }
+  }
+
+  bool try_pop(T &v, int timeout_ms = 0) {
+    while (!pop_one(v)) {
+      if (!not_empty.wait([this] { return !empty(); }, timeout_ms)) return false;
+    }
+    return true;
+  }
+
+  T pop() {
+    T v;
+    try_pop(v, -1);
+    return v;
+  }
+
+  bool empty() const {
+    const size_t h = head.load(std::memory_order_acquire);
+    return slots[h & (N - 1)].seq.load(std::memory_order_acquire) != h + 1;
+  }
+  bool full() const { return size() >= N; }
+  size_t size() const {
+    const size_t h = head.load(std::memory_order_acquire);
+    const size_t t = tail.load(std::memory_order_acquire);
+    return t > h ? t - h : 0;
+  }
+  static constexpr size_t capacity() { return N; }
+
+private:
+  bool push_one(T &v) {
+    size_t pos = tail.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+      slot = &slots[pos & (N - 1)];
+      const intptr_t diff = (intptr_t)slot->seq.load(std::memory_order_acquire) - (intptr_t)pos;
+      if (diff == 0) {
+        if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        return false;  // full
+      } else {
+        pos = tail.load(std::memory_order_relaxed);
+      }
+    }
+    slot->value = std::move(v);
+    slot->seq.store(pos + 1, std::memory_order_release);
+    not_empty.notify();
+    return true;
+  }
+
+  bool pop_one(T &v) {
+    const size_t h = head.load(std::memory_order_relaxed);
+    Slot &slot = slots[h & (N - 1)];
+    if (slot.seq.load(std::memory_order_acquire) != h + 1) return false;
+
+    v = std::move(slot.value);
+    slot.seq.store(h + N, std::memory_order_release);
+    head.store(h + 1, std::memory_order_release);
+    if (size() <= N / 2) not_full.notify();
+    return true;
+  }
+
+  struct Slot {
+    std::atomic<size_t> seq;
+    T value;
+  };
+
+  alignas(queue_detail::CACHE_LINE) std::atomic<size_t> tail = 0;
+  alignas(queue_detail::CACHE_LINE) std::atomic<size_t> head = 0;
+  alignas(queue_detail::CACHE_LINE) queue_detail::WaitEvent not_empty;
+  alignas(queue_detail::CACHE_LINE) queue_detail::WaitEvent not_full;
+  alignas(queue_detail::CACHE_LINE) Slot slots[N];
+};
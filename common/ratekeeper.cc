@@ -1,40 +1,93 @@
 #include "common/ratekeeper.h"
 
 #include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <ctime>
 
 #include "common/swaglog.h"
 #include "common/timing.h"
 #include "common/util.h"
 
+void LoopStats::started(uint64_t deadline_ns, uint64_t start_ns) {
+  const uint64_t jitter = start_ns > deadline_ns ? start_ns - deadline_ns : 0;
+  const uint64_t jitter_us = jitter / 1000;
+  size_t i = 0;
+  while (i < JITTER_BUCKETS_US.size() && jitter_us >= JITTER_BUCKETS_US[i]) ++i;
+  ++jitter_hist[i];
+  ++count;
+  max_jitter_ns = std::max(max_jitter_ns, jitter);
+  last_deadline_ns = deadline_ns;
+}
+
+void LoopStats::report(uint64_t now_ns) {
+  if (last_report_ns == 0) {
+    last_report_ns = now_ns;
+    return;
+  }
+  if (now_ns - last_report_ns < REPORT_INTERVAL * 1e9) return;
+
+  // loops that kept up with all their deadlines stay quiet
+  if (overruns > 0) {
+    std::string hist;
+    for (size_t i = 0; i < jitter_hist.size(); ++i) {
+      hist += i < JITTER_BUCKETS_US.size() ? util::string_format("<%" PRIu64 "us:%" PRIu64 " ", JITTER_BUCKETS_US[i], jitter_hist[i])
+                                           : util::string_format(">=%" PRIu64 "us:%" PRIu64, JITTER_BUCKETS_US.back(), jitter_hist[i]);
+    }
+    LOG("%s timing: %" PRIu64 " frames, %" PRIu64 " overruns, max jitter %.2f ms, jitter [%s]",
+        name.c_str(), count, overruns, max_jitter_ns / 1e6, hist.c_str());
+  }
+  reset();
+  last_report_ns = now_ns;
+}
+
+void LoopStats::reset() {
+  count = overruns = max_jitter_ns = 0;
+  jitter_hist = {};
+}
+
 RateKeeper::RateKeeper(const std::string &name, float rate, float print_delay_threshold)
-    : name(name),
-      print_delay_threshold(std::max(0.f, print_delay_threshold)) {
-  interval = 1 / rate;
-  last_monitor_time = seconds_since_boot();
-  next_frame_time = last_monitor_time + interval;
+    : print_delay_threshold(std::max(0.f, print_delay_threshold)),
+      name(name),
+      stats_(name) {
+  interval_ns = 1e9 / rate;
+  next_frame_time = next_aligned_deadline(nanos_since_boot(), interval_ns);
 }
 
 bool RateKeeper::keepTime() {
   bool lagged = monitorTime();
   if (remaining_ > 0) {
+    const uint64_t deadline = next_frame_time - interval_ns;
+#ifdef __linux__
+    struct timespec ts = {(time_t)(deadline / 1000000000ULL), (long)(deadline % 1000000000ULL)};
+    while (clock_nanosleep(CLOCK_BOOTTIME, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+#else
     util::sleep_for(remaining_ * 1000);
+#endif
+    const uint64_t now = nanos_since_boot();
+    stats_.started(deadline, now);
+    stats_.report(now);
   }
   return lagged;
 }
 
 bool RateKeeper::monitorTime() {
   ++frame_;
-  last_monitor_time = seconds_since_boot();
-  remaining_ = next_frame_time - last_monitor_time;
+  const uint64_t now = nanos_since_boot();
+  remaining_ = ((double)next_frame_time - (double)now) / 1e9;
 
   bool lagged = remaining_ < 0;
   if (lagged) {
     if (print_delay_threshold > 0 && remaining_ < -print_delay_threshold) {
       LOGW("%s lagging by %.2f ms", name.c_str(), -remaining_ * 1000);
     }
-    next_frame_time = last_monitor_time + interval;
+    // skip to the next deadline on the same grid
+    const uint64_t next = next_aligned_deadline(now, interval_ns, next_frame_time);
+    stats_.missed((next - next_frame_time) / interval_ns);
+    stats_.report(now);
+    next_frame_time = next;
   } else {
-    next_frame_time += interval;
+    next_frame_time += interval_ns;
   }
   return lagged;
 }
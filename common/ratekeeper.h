@@ -1,8 +1,38 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <string>
 
+// Timing of a periodic loop: how late each iteration started after its deadline (jitter),
+// and how many deadlines passed without an iteration (overruns). A summary with the jitter
+// histogram is logged every REPORT_INTERVAL seconds in which deadlines were missed.
+class LoopStats {
+public:
+  // upper bucket edges in microseconds, the last bucket is open-ended
+  static constexpr std::array<uint64_t, 10> JITTER_BUCKETS_US = {50, 100, 200, 400, 800, 1600, 3200, 6400, 12800, 25600};
+  static constexpr double REPORT_INTERVAL = 60.;
+
+  LoopStats(const std::string &name) : name(name) {}
+  void started(uint64_t deadline_ns, uint64_t start_ns);
+  void missed(uint64_t deadlines) { overruns += deadlines; }
+  void report(uint64_t now_ns);
+  void reset();
+
+  uint64_t count = 0;
+  uint64_t overruns = 0;
+  uint64_t max_jitter_ns = 0;
+  std::array<uint64_t, JITTER_BUCKETS_US.size() + 1> jitter_hist = {};
+  uint64_t last_deadline_ns = 0;  // deadline of the latest iteration, kept across reports
+
+private:
+  std::string name;
+  uint64_t last_report_ns = 0;
+};
+
+// Deadlines are absolute and fall on multiples of the interval on the CLOCK_BOOTTIME
+// timeline, so loops in the same process that run at related rates wake up together.
+// A loop that falls behind skips the deadlines it missed instead of bursting to catch up.
 class RateKeeper {
 public:
   RateKeeper(const std::string &name, float rate, float print_delay_threshold = 0);
@@ -11,13 +41,21 @@ public:
   bool monitorTime();
   inline uint64_t frame() const { return frame_; }
   inline double remaining() const { return remaining_; }
+  inline const LoopStats &stats() const { return stats_; }
 
 private:
-  double interval;
-  double next_frame_time;
-  double last_monitor_time;
+  uint64_t interval_ns;
+  uint64_t next_frame_time;
   double remaining_ = 0;
   float print_delay_threshold = 0;
   uint64_t frame_ = 0;
   std::string name;
+  LoopStats stats_;
 };
+
+// First deadline after now on the grid of multiples of interval, shifted by phase.
+inline uint64_t next_aligned_deadline(uint64_t now_ns, uint64_t interval_ns, uint64_t phase_ns = 0) {
+  phase_ns %= interval_ns;
+  if (now_ns < phase_ns) return phase_ns;
+  return ((now_ns - phase_ns) / interval_ns + 1) * interval_ns + phase_ns;
+}
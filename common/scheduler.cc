@@ -0,0 +1,114 @@
+#include "common/scheduler.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <iterator>
+#include <tuple>
+
+#include "common/swaglog.h"
+#include "common/timing.h"
+#include "common/util.h"
+
+PeriodicScheduler::PeriodicScheduler(const std::string &name) : name(name) {
+  timer_fd = timerfd_create(CLOCK_BOOTTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+  event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  assert(timer_fd >= 0 && event_fd >= 0 && epoll_fd >= 0);
+
+  for (int fd : {timer_fd, event_fd}) {
+    struct epoll_event ev = {.events = EPOLLIN, .data = {.fd = fd}};
+    int ret = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    assert(ret == 0);
+  }
+}
+
+PeriodicScheduler::~PeriodicScheduler() {
+  stop();
+  close(epoll_fd);
+  close(event_fd);
+  close(timer_fd);
+}
+
+void PeriodicScheduler::add(const std::string &task_name, float rate, std::function<void()> fn, uint64_t phase_ns) {
+  assert(!running() && rate > 0);
+  const uint64_t period = 1e9 / rate;
+  tasks.push_back({task_name, period, phase_ns % period, 0, std::move(fn), LoopStats(name + "/" + task_name)});
+}
+
+void PeriodicScheduler::start() {
+  assert(!running());
+  uint64_t v;
+  while (read(event_fd, &v, sizeof(v)) > 0) {}
+  thread = std::thread(&PeriodicScheduler::run, this);
+}
+
+void PeriodicScheduler::stop() {
+  if (!running()) return;
+  const uint64_t v = 1;
+  HANDLE_EINTR(write(event_fd, &v, sizeof(v)));
+  thread.join();
+}
+
+void PeriodicScheduler::run() {
+  util::set_thread_name(name.c_str());
+
+  uint64_t now = nanos_since_boot();
+  for (auto &t : tasks) {
+    t.deadline_ns = next_aligned_deadline(now, t.period_ns, t.phase_ns);
+  }
+
+  std::vector<Task *> due;
+  while (!tasks.empty()) {
+    const uint64_t next = std::min_element(tasks.begin(), tasks.end(), [](auto &a, auto &b) {
+      return a.deadline_ns < b.deadline_ns;
+    })->deadline_ns;
+    struct itimerspec spec = {.it_interval = {}, .it_value = {(time_t)(next / 1000000000ULL), (long)(next % 1000000000ULL)}};
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+
+    struct epoll_event events[2];
+    int n = epoll_wait(epoll_fd, events, std::size(events), -1);
+    if (n < 0 && errno != EINTR) {
+      LOGE("%s: epoll_wait failed %d", name.c_str(), errno);
+      break;
+    }
+    bool exit = false;
+    for (int i = 0; i < n; ++i) {
+      uint64_t v;
+      exit |= events[i].data.fd == event_fd;
+      while (read(events[i].data.fd, &v, sizeof(v)) > 0) {}
+    }
+    if (exit) break;
+
+    // run everything that is due, earliest deadline first and faster tasks first on ties
+    now = nanos_since_boot();
+    due.clear();
+    for (auto &t : tasks) {
+      if (t.deadline_ns <= now) due.push_back(&t);
+    }
+    std::sort(due.begin(), due.end(), [](auto a, auto b) {
+      return std::tie(a->deadline_ns, a->period_ns) < std::tie(b->deadline_ns, b->period_ns);
+    });
+
+    for (Task *t : due) {
+      const uint64_t start = nanos_since_boot();
+      t->stats.started(t->deadline_ns, start);
+      t->fn();
+
+      const uint64_t end = nanos_since_boot();
+      t->deadline_ns += t->period_ns;
+      if (t->deadline_ns <= end) {
+        // skip the deadlines that passed while running, staying on the grid
+        const uint64_t next_deadline = next_aligned_deadline(end, t->period_ns, t->deadline_ns);
+        t->stats.missed((next_deadline - t->deadline_ns) / t->period_ns);
+        t->deadline_ns = next_deadline;
+      }
+      t->stats.report(end);
+    }
+  }
+}
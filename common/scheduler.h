@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/ratekeeper.h"
+
+// Runs several fixed-rate tasks on one thread. A single timerfd is armed for the earliest
+// absolute deadline and waited on with epoll, so tasks whose deadlines coincide share one
+// wakeup. Deadlines fall on multiples of each task's period (plus an optional phase), the
+// same grid RateKeeper uses, and each task keeps LoopStats that are logged periodically.
+class PeriodicScheduler {
+public:
+  PeriodicScheduler(const std::string &name);
+  ~PeriodicScheduler();
+
+  // Runs fn at rate Hz, phase_ns after each multiple of the period. Call before start().
+  void add(const std::string &name, float rate, std::function<void()> fn, uint64_t phase_ns = 0);
+  void start();
+  void stop();
+  bool running() const { return thread.joinable(); }
+
+  // for tests, only valid when stopped
+  const LoopStats &stats(size_t task) const { return tasks[task].stats; }
+
+private:
+  struct Task {
+    std::string name;
+    uint64_t period_ns;
+    uint64_t phase_ns;
+    uint64_t deadline_ns = 0;
+    std::function<void()> fn;
+    LoopStats stats;
+  };
+
+  void run();
+
+  std::string name;
+  std::vector<Task> tasks;
+  std::thread thread;
+  int timer_fd = -1;
+  int event_fd = -1;
+  int epoll_fd = -1;
+};
@@ -0,0 +1,61 @@
+// Compares SafeQueue with the lock-free ring queues under contention: throughput with
+// 1-4 producers feeding one consumer, and the round trip of a single item bounced
+// between two threads, which is what the per-frame queues in camerad and the encoders see.
+//
+// usage: bench_queue [items]
+
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "common/queue.h"
+#include "common/timing.h"
+
+template <class Q>
+double throughput(int producers, int items) {
+  Q q;
+  const int per_producer = items / producers;
+  double start = nanos_since_boot();
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&q, per_producer] {
+      for (int i = 0; i < per_producer; ++i) q.push(i);
+    });
+  }
+  for (int i = 0; i < per_producer * producers; ++i) q.pop();
+  for (auto &t : threads) t.join();
+  return (nanos_since_boot() - start) / (per_producer * producers);
+}
+
+template <class Q>
+double round_trip(int items) {
+  Q ping, pong;
+  std::thread echo([&] {
+    for (int i = 0; i < items; ++i) pong.push(ping.pop());
+  });
+  double start = nanos_since_boot();
+  for (int i = 0; i < items; ++i) {
+    ping.push(i);
+    pong.pop();
+  }
+  echo.join();
+  return (nanos_since_boot() - start) / items;
+}
+
+int main(int argc, char *argv[]) {
+  const int items = argc > 1 ? atoi(argv[1]) : 1000000;
+
+  printf("%-28s %12s %12s\n", "ns/item", "SafeQueue", "lock-free");
+  printf("%-28s %12.1f %12.1f\n", "1 producer (SpscQueue)",
+         throughput<SafeQueue<int>>(1, items), throughput<SpscQueue<int, 64>>(1, items));
+  for (int producers : {1, 2, 4}) {
+    char name[64];
+    snprintf(name, sizeof(name), "%d producer%s (MpscQueue)", producers, producers > 1 ? "s" : "");
+    printf("%-28s %12.1f %12.1f\n", name,
+           throughput<SafeQueue<int>>(producers, items), throughput<MpscQueue<int, 64>>(producers, items));
+  }
+  printf("%-28s %12.1f %12.1f\n", "round trip (SpscQueue)",
+         round_trip<SafeQueue<int>>(items / 10), round_trip<SpscQueue<int, 64>>(items / 10));
+  return 0;
+}
@@ -25,3 +25,48 @@ TEST_CASE("params_nonblocking_put") {
     REQUIRE(p.get(name) == "1");
   }
 }
+
+TEST_CASE("params_cache") {
+  char tmp_path[] = "/tmp/paramsCache_XXXXXX";
+  const std::string param_path = mkdtemp(tmp_path);
+  Params writer(param_path);
+  Params params(param_path, true);
+  REQUIRE(params.cache != nullptr);
+
+  REQUIRE(params.get("IsMetric").empty());
+  REQUIRE(params.getBool("IsMetric") == false);
+
+  // own writes are visible immediately
+  params.putInt("CEStatus", 3);
+  REQUIRE(params.getInt("CEStatus") == 3);
+  REQUIRE(params.cache->values.count("CEStatus") == 1);
+
+  // writes and removes by other processes invalidate the cached value
+  auto wait_for = [&](auto condition) {
+    for (int i = 0; i < 100 && !condition(); ++i) util::sleep_for(10);
+    return condition();
+  };
+  writer.putBool("IsMetric", true);
+  REQUIRE(wait_for([&] { return params.getBool("IsMetric"); }));
+  writer.putFloat("CEStatus", 1.5);
+  REQUIRE(wait_for([&] { return params.getFloat("CEStatus") == 1.5f; }));
+  REQUIRE(params.getInt("CEStatus") == 1);
+  writer.remove("IsMetric");
+  REQUIRE(wait_for([&] { return params.get("IsMetric").empty(); }));
+
+  params.clearAll(ALL);
+  REQUIRE(params.cache->values.empty());
+  REQUIRE(params.getInt("CEStatus") == 0);
+
+  // the cache survives the params directory being moved away and recreated
+  writer.putInt("CEStatus", 3);
+  REQUIRE(wait_for([&] { return params.getInt("CEStatus") == 3; }));
+  const std::string dir = util::readlink(params.getParamPath());
+  REQUIRE(rename(dir.c_str(), (dir + ".old").c_str()) == 0);
+  REQUIRE(wait_for([&] { return params.get("CEStatus").empty(); }));
+  REQUIRE(util::create_directories(dir, 0775));
+  writer.putInt("CEStatus", 4);
+  REQUIRE(wait_for([&] { return params.getInt("CEStatus") == 4 && params.cache->values.count("CEStatus") == 1; }));
+  writer.putInt("CEStatus", 5);
+  REQUIRE(wait_for([&] { return params.getInt("CEStatus") == 5; }));
+}
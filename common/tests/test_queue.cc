@@ -0,0 +1,86 @@
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "common/queue.h"
+#include "common/timing.h"
+#include "common/util.h"
+
+TEMPLATE_TEST_CASE("ring queue basics", "", (SpscQueue<std::unique_ptr<int>, 4>), (MpscQueue<std::unique_ptr<int>, 4>)) {
+  TestType q;
+  REQUIRE(q.empty());
+  std::unique_ptr<int> v;
+  REQUIRE_FALSE(q.try_pop(v));
+
+  for (int i = 0; i < 4; ++i) {
+    REQUIRE(q.try_push(std::make_unique<int>(i)));
+  }
+  REQUIRE(q.full());
+  REQUIRE(q.size() == 4);
+
+  // a failed push leaves the queue untouched
+  REQUIRE_FALSE(q.try_push(std::make_unique<int>(4)));
+
+  for (int i = 0; i < 4; ++i) {
+    REQUIRE(q.try_pop(v));
+    REQUIRE(*v == i);
+  }
+  REQUIRE(q.empty());
+
+  SECTION("try_pop times out") {
+    double start = millis_since_boot();
+    REQUIRE_FALSE(q.try_pop(v, 20));
+    REQUIRE(millis_since_boot() - start >= 19);
+  }
+  SECTION("pop wakes up on push") {
+    std::thread t([&] {
+      util::sleep_for(10);
+      q.push(std::make_unique<int>(42));
+    });
+    REQUIRE(*q.pop() == 42);
+    t.join();
+  }
+  SECTION("push waits for space") {
+    for (int i = 0; i < 4; ++i) q.push(std::make_unique<int>(i));
+    std::thread t([&] { q.push(std::make_unique<int>(4)); });
+    util::sleep_for(10);
+    for (int i = 0; i < 5; ++i) {
+      REQUIRE(*q.pop() == i);
+    }
+    t.join();
+  }
+}
+
+TEST_CASE("SpscQueue keeps order across threads") {
+  const int count = 200000;
+  SpscQueue<int, 64> q;
+  std::thread producer([&] {
+    for (int i = 0; i < count; ++i) q.push(i);
+  });
+  for (int i = 0; i < count; ++i) {
+    REQUIRE(q.pop() == i);
+  }
+  producer.join();
+  REQUIRE(q.empty());
+}
+
+TEST_CASE("MpscQueue delivers every item from every producer") {
+  const int producers = 4, count = 100000;
+  MpscQueue<std::pair<int, int>, 64> q;
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&q, p] {
+      for (int i = 0; i < count; ++i) q.push({p, i});
+    });
+  }
+
+  // items from one producer arrive in the order they were pushed
+  std::vector<int> next(producers, 0);
+  for (int i = 0; i < producers * count; ++i) {
+    auto [p, v] = q.pop();
+    REQUIRE(v == next[p]++);
+  }
+  for (auto &t : threads) t.join();
+  REQUIRE(q.empty());
+}
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "common/ratekeeper.h"
+#include "common/scheduler.h"
+#include "common/timing.h"
+#include "common/util.h"
+
+TEST_CASE("next_aligned_deadline") {
+  REQUIRE(next_aligned_deadline(0, 10) == 10);
+  REQUIRE(next_aligned_deadline(15, 10) == 20);
+  REQUIRE(next_aligned_deadline(20, 10) == 30);
+  REQUIRE(next_aligned_deadline(15, 10, 3) == 23);
+  REQUIRE(next_aligned_deadline(23, 10, 13) == 33);
+  REQUIRE(next_aligned_deadline(1, 10, 3) == 3);
+}
+
+// Wakeups can be arbitrarily late on a loaded machine, so these tests check the deadlines
+// the loops recorded and the LoopStats accounting rather than when they actually woke up.
+
+TEST_CASE("RateKeeper") {
+  const uint64_t interval = 10 * 1e6;
+  RateKeeper rk("test", 100);
+
+  SECTION("wakes up on the grid") {
+    int lagged = 0;
+    uint64_t prev_deadline = 0;
+    for (int i = 0; i < 10; ++i) {
+      if (rk.keepTime()) {
+        lagged++;
+        continue;
+      }
+      const uint64_t deadline = rk.stats().last_deadline_ns;
+      REQUIRE(deadline % interval == 0);
+      REQUIRE(deadline > prev_deadline);
+      REQUIRE(nanos_since_boot() >= deadline);
+      prev_deadline = deadline;
+    }
+    REQUIRE(rk.frame() == 10);
+    REQUIRE(rk.stats().count == 10 - lagged);
+    REQUIRE(rk.stats().overruns >= lagged);
+  }
+  SECTION("skips missed deadlines") {
+    rk.keepTime();
+    util::sleep_for(35);
+    REQUIRE(rk.keepTime());
+    REQUIRE(rk.remaining() < -0.02);
+    REQUIRE(rk.stats().overruns >= 3);
+    if (!rk.keepTime()) {
+      REQUIRE(rk.stats().last_deadline_ns % interval == 0);
+    }
+  }
+}
+
+TEST_CASE("PeriodicScheduler") {
+  const uint64_t fast_period = 10e6, slow_period = 50e6;
+  PeriodicScheduler scheduler("test_scheduler");
+  // deadlines of the runs, read on the scheduler thread while the task runs
+  std::vector<uint64_t> fast, slow;
+  scheduler.add("fast", 100, [&] { fast.push_back(scheduler.stats(0).last_deadline_ns); });
+  scheduler.add("slow", 20, [&] { slow.push_back(scheduler.stats(1).last_deadline_ns); });
+
+  SECTION("runs each task at its rate on a shared grid") {
+    scheduler.start();
+    util::sleep_for(505);
+    scheduler.stop();
+
+    REQUIRE(fast.size() >= 2);
+    REQUIRE(slow.size() >= 2);
+    for (size_t i = 0; i < fast.size(); ++i) {
+      REQUIRE(fast[i] % fast_period == 0);
+      if (i > 0) REQUIRE(fast[i] > fast[i - 1]);
+    }
+    for (size_t i = 0; i < slow.size(); ++i) {
+      REQUIRE(slow[i] % slow_period == 0);
+      if (i > 0) REQUIRE(slow[i] > slow[i - 1]);
+      // every slow deadline is also a fast one, so they share the wakeup
+      REQUIRE((slow[i] < fast.front() || slow[i] > fast.back() || std::binary_search(fast.begin(), fast.end(), slow[i])));
+    }
+    // every deadline between the first and last run was either run or counted as missed
+    const LoopStats &stats = scheduler.stats(0);
+    REQUIRE(stats.count == fast.size());
+    REQUIRE(stats.count + stats.overruns >= (fast.back() - fast.front()) / fast_period + 1);
+  }
+  SECTION("counts overruns and stays on the grid") {
+    scheduler.add("busy", 10, [&] { util::sleep_for(25); });
+    scheduler.start();
+    util::sleep_for(500);
+    scheduler.stop();
+
+    // each busy run makes the fast task skip a deadline and run another one at least 15ms late
+    const uint64_t busy_runs = scheduler.stats(2).count;
+    REQUIRE(busy_runs >= 2);
+    REQUIRE(scheduler.stats(0).overruns >= busy_runs - 1);
+    REQUIRE(scheduler.stats(0).jitter_hist[9] + scheduler.stats(0).jitter_hist[10] >= busy_runs - 1);
+    for (uint64_t deadline : fast) {
+      REQUIRE(deadline % fast_period == 0);
+    }
+  }
+}
@@ -61,6 +61,24 @@ Geodetic ecef2geodetic(ECEF e){
   return to_degrees({lat, lon, h});
 }
 
+void geodetic2ecef(const double *geodetic, double *ecef, size_t n) {
+  for (size_t i = 0; i < n * 3; i += 3) {
+    ECEF e = geodetic2ecef(Geodetic{geodetic[i], geodetic[i + 1], geodetic[i + 2]});
+    ecef[i] = e.x;
+    ecef[i + 1] = e.y;
+    ecef[i + 2] = e.z;
+  }
+}
+
+void ecef2geodetic(const double *ecef, double *geodetic, size_t n) {
+  for (size_t i = 0; i < n * 3; i += 3) {
+    Geodetic g = ecef2geodetic(ECEF{ecef[i], ecef[i + 1], ecef[i + 2]});
+    geodetic[i] = g.lat;
+    geodetic[i + 1] = g.lon;
+    geodetic[i + 2] = g.alt;
+  }
+}
+
 LocalCoord::LocalCoord(Geodetic g, ECEF e){
   init_ecef <<  e.x, e.y, e.z;
 
@@ -98,3 +116,25 @@ Geodetic LocalCoord::ned2geodetic(NED n){
   ECEF e = ned2ecef(n);
   return ::ecef2geodetic(e);
 }
+
+// The batch conversions view the points as the columns of a 3 x n matrix
+typedef Eigen::Map<const Eigen::Matrix<double, 3, Eigen::Dynamic>> ConstPoints;
+typedef Eigen::Map<Eigen::Matrix<double, 3, Eigen::Dynamic>> Points;
+
+void LocalCoord::ecef2ned(const double *ecef, double *ned, size_t n) {
+  Points(ned, 3, n) = ecef2ned_matrix * (ConstPoints(ecef, 3, n).colwise() - init_ecef);
+}
+
+void LocalCoord::ned2ecef(const double *ned, double *ecef, size_t n) {
+  Points(ecef, 3, n) = (ned2ecef_matrix * ConstPoints(ned, 3, n)).colwise() + init_ecef;
+}
+
+void LocalCoord::geodetic2ned(const double *geodetic, double *ned, size_t n) {
+  ::geodetic2ecef(geodetic, ned, n);
+  ecef2ned(ned, ned, n);
+}
+
+void LocalCoord::ned2geodetic(const double *ned, double *geodetic, size_t n) {
+  ned2ecef(ned, geodetic, n);
+  ::ecef2geodetic(geodetic, geodetic, n);
+}
@@ -27,6 +27,10 @@ struct Geodetic {
 ECEF geodetic2ecef(Geodetic g);
 Geodetic ecef2geodetic(ECEF e);
 
+// Batch versions take n points as consecutive triplets, the rows of an (n, 3) array
+void geodetic2ecef(const double *geodetic, double *ecef, size_t n);
+void ecef2geodetic(const double *ecef, double *geodetic, size_t n);
+
 class LocalCoord {
 public:
   Eigen::Matrix3d ned2ecef_matrix;
@@ -40,4 +44,9 @@ public:
   ECEF ned2ecef(NED n);
   NED geodetic2ned(Geodetic g);
   Geodetic ned2geodetic(NED n);
+
+  void ecef2ned(const double *ecef, double *ned, size_t n);
+  void ned2ecef(const double *ned, double *ecef, size_t n);
+  void geodetic2ned(const double *geodetic, double *ned, size_t n);
+  void ned2geodetic(const double *ned, double *geodetic, size_t n);
 };
@@ -142,3 +142,51 @@ Eigen::Vector3d ned_euler_from_ecef(ECEF ecef_init, Eigen::Vector3d ecef_pose){
   return {phi, theta, psi};
 }
 
+
+typedef Eigen::Map<const Eigen::Matrix<double, 3, 3, Eigen::RowMajor>> ConstRowMajor3;
+typedef Eigen::Map<Eigen::Matrix<double, 3, 3, Eigen::RowMajor>> RowMajor3;
+
+static void store_quat(const Eigen::Quaterniond &q, double *out) {
+  out[0] = q.w();
+  out[1] = q.x();
+  out[2] = q.y();
+  out[3] = q.z();
+}
+
+void euler2quat(const double *euler, double *quat, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    store_quat(euler2quat(Eigen::Vector3d(euler + i * 3)), quat + i * 4);
+  }
+}
+
+void quat2euler(const double *quat, double *euler, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    const double *q = quat + i * 4;
+    Eigen::Map<Eigen::Vector3d>(euler + i * 3) = quat2euler(Eigen::Quaterniond(q[0], q[1], q[2], q[3]));
+  }
+}
+
+void quat2rot(const double *quat, double *rot, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    const double *q = quat + i * 4;
+    RowMajor3(rot + i * 9) = quat2rot(Eigen::Quaterniond(q[0], q[1], q[2], q[3]));
+  }
+}
+
+void rot2quat(const double *rot, double *quat, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    store_quat(rot2quat(ConstRowMajor3(rot + i * 9)), quat + i * 4);
+  }
+}
+
+void euler2rot(const double *euler, double *rot, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    RowMajor3(rot + i * 9) = euler2rot(Eigen::Vector3d(euler + i * 3));
+  }
+}
+
+void rot2euler(const double *rot, double *euler, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    Eigen::Map<Eigen::Vector3d>(euler + i * 3) = rot2euler(ConstRowMajor3(rot + i * 9));
+  }
+}
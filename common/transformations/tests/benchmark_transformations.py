@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+"""Times the batch transformations on 1M points, against a per-point loop over the *_single functions."""
+import time
+import numpy as np
+
+import openpilot.common.transformations.coordinates as coord
+import openpilot.common.transformations.orientation as orient
+from openpilot.common.transformations import transformations
+
+N = 1_000_000
+SINGLE_N = 10_000  # the per-point loop is timed on a subset and scaled up
+
+
+def bench(name, batch_fn, single_fn, inp):
+  t = time.monotonic()
+  batch_fn(inp)
+  batch_time = time.monotonic() - t
+
+  t = time.monotonic()
+  for p in inp[:SINGLE_N]:
+    single_fn(p)
+  single_time = (time.monotonic() - t) * N / SINGLE_N
+  print(f"{name:<16} batch {batch_time * 1e3:8.1f} ms   per point {single_time * 1e3:8.1f} ms   {single_time / batch_time:6.1f}x")
+
+
+if __name__ == "__main__":
+  rng = np.random.default_rng(0)
+  geodetic = np.column_stack([rng.uniform(-89, 89, N), rng.uniform(-180, 180, N), rng.uniform(-100, 5000, N)])
+  ecef = coord.geodetic2ecef(geodetic)
+  eulers = rng.uniform(-np.pi, np.pi, (N, 3))
+  quats = orient.euler2quat(eulers)
+  rots = orient.quat2rot(quats)
+  converter = coord.LocalCoord.from_geodetic(geodetic[0])
+  ned = converter.ecef2ned(ecef)
+
+  print(f"{N} points")
+  bench("geodetic2ecef", coord.geodetic2ecef, transformations.geodetic2ecef_single, geodetic)
+  bench("ecef2geodetic", coord.ecef2geodetic, transformations.ecef2geodetic_single, ecef)
+  bench("ecef2ned", converter.ecef2ned, converter.ecef2ned_single, ecef)
+  bench("ned2geodetic", converter.ned2geodetic, converter.ned2geodetic_single, ned)
+  bench("euler2quat", orient.euler2quat, transformations.euler2quat_single, eulers)
+  bench("quat2rot", orient.quat2rot, transformations.quat2rot_single, quats)
+  bench("rot2euler", orient.rot2euler, transformations.rot2euler_single, rots)
@@ -1,6 +1,7 @@
 import numpy as np
 
 import openpilot.common.transformations.coordinates as coord
+from openpilot.common.transformations.transformations import ecef2geodetic_single, geodetic2ecef_single
 
 geodetic_positions = np.array([[37.7610403, -122.4778699, 115],
                                  [27.4840915, -68.5867592, 2380],
@@ -102,3 +103,18 @@ class TestNED:
     np.testing.assert_allclose(converter.ned2ecef(ned_offsets_batch),
                                                            ecef_positions_offset_batch,
                                                            rtol=1e-9, atol=1e-7)
+
+  def test_batch_matches_single(self):
+    rng = np.random.default_rng(0)
+    geodetic = np.column_stack([rng.uniform(-89, 89, 1000), rng.uniform(-180, 180, 1000), rng.uniform(-100, 5000, 1000)])
+    ecef = coord.geodetic2ecef(geodetic)
+    np.testing.assert_allclose(ecef, [geodetic2ecef_single(g) for g in geodetic], rtol=0, atol=1e-9)
+    np.testing.assert_allclose(coord.ecef2geodetic(ecef), [ecef2geodetic_single(e) for e in ecef], rtol=0, atol=1e-9)
+
+    converter = coord.LocalCoord.from_geodetic(geodetic_positions[0])
+    ned = converter.ecef2ned(ecef)
+    np.testing.assert_allclose(ned, [converter.ecef2ned_single(e) for e in ecef], rtol=0, atol=1e-9)
+    np.testing.assert_allclose(converter.ned2ecef(ned), [converter.ned2ecef_single(n) for n in ned], rtol=0, atol=1e-9)
+    np.testing.assert_allclose(converter.geodetic2ned(geodetic), [converter.geodetic2ned_single(g) for g in geodetic], rtol=0, atol=1e-9)
+    np.testing.assert_allclose(converter.ned2geodetic(ned), [converter.ned2geodetic_single(n) for n in ned], rtol=0, atol=1e-9)
+    assert coord.geodetic2ecef(np.zeros((0, 3))).shape == (0, 3)
@@ -3,6 +3,8 @@ import numpy as np
 from openpilot.common.transformations.orientation import euler2quat, quat2euler, euler2rot, rot2euler, \
                                                rot2quat, quat2rot, \
                                                ned_euler_from_ecef
+from openpilot.common.transformations.transformations import euler2quat_single, quat2euler_single, euler2rot_single, \
+                                                   rot2euler_single, rot2quat_single, quat2rot_single
 
 eulers = np.array([[ 1.46520501,  2.78688383,  2.92780854],
        [ 4.86909526,  3.60618161,  4.30648981],
@@ -59,3 +61,15 @@ class TestOrientation:
       np.testing.assert_allclose(ned_eulers[i], ned_euler_from_ecef(ecef_positions[i], eulers[i]), rtol=1e-7)
       #np.testing.assert_allclose(eulers[i], ecef_euler_from_ned(ecef_positions[i], ned_eulers[i]), rtol=1e-7)
     # np.testing.assert_allclose(ned_eulers, ned_euler_from_ecef(ecef_positions, eulers), rtol=1e-7)
+
+  def test_batch_matches_single(self):
+    rng = np.random.default_rng(0)
+    batch_eulers = rng.uniform(-np.pi, np.pi, (1000, 3))
+    batch_quats = euler2quat(batch_eulers)
+    batch_rots = quat2rot(batch_quats)
+    np.testing.assert_allclose(batch_quats, [euler2quat_single(e) for e in batch_eulers], rtol=0, atol=1e-9)
+    np.testing.assert_allclose(quat2euler(batch_quats), [quat2euler_single(q) for q in batch_quats], rtol=0, atol=1e-9)
+    np.testing.assert_allclose(batch_rots, [quat2rot_single(q) for q in batch_quats], rtol=0, atol=1e-9)
+    np.testing.assert_allclose(rot2quat(batch_rots), [rot2quat_single(r) for r in batch_rots], rtol=0, atol=1e-9)
+    np.testing.assert_allclose(euler2rot(batch_eulers), [euler2rot_single(e) for e in batch_eulers], rtol=0, atol=1e-9)
+    np.testing.assert_allclose(rot2euler(batch_rots), [rot2euler_single(r) for r in batch_rots], rtol=0, atol=1e-9)
@@ -34,6 +34,13 @@ cdef extern from "orientation.hpp":
   Vector3 ecef_euler_from_ned(ECEF, Vector3)
   Vector3 ned_euler_from_ecef(ECEF, Vector3)
 
+  void euler2quat_batch "euler2quat"(const double*, double*, size_t)
+  void quat2euler_batch "quat2euler"(const double*, double*, size_t)
+  void quat2rot_batch "quat2rot"(const double*, double*, size_t)
+  void rot2quat_batch "rot2quat"(const double*, double*, size_t)
+  void euler2rot_batch "euler2rot"(const double*, double*, size_t)
+  void rot2euler_batch "rot2euler"(const double*, double*, size_t)
+
 
 cdef extern from "coordinates.cc":
   cdef struct ECEF:
@@ -54,6 +61,8 @@ cdef extern from "coordinates.cc":
 
   ECEF geodetic2ecef(Geodetic)
   Geodetic ecef2geodetic(ECEF)
+  void geodetic2ecef_batch "geodetic2ecef"(const double*, double*, size_t)
+  void ecef2geodetic_batch "ecef2geodetic"(const double*, double*, size_t)
 
   cdef cppclass LocalCoord_c "LocalCoord":
     Matrix3 ned2ecef_matrix
@@ -67,6 +76,10 @@ cdef extern from "coordinates.cc":
     ECEF ned2ecef(NED)
     NED geodetic2ned(Geodetic)
     Geodetic ned2geodetic(NED)
+    void ecef2ned_batch "ecef2ned"(const double*, double*, size_t)
+    void ned2ecef_batch "ned2ecef"(const double*, double*, size_t)
+    void geodetic2ned_batch "geodetic2ned"(const double*, double*, size_t)
+    void ned2geodetic_batch "ned2geodetic"(const double*, double*, size_t)
 
 cdef extern from "coordinates.hpp":
   pass
@@ -15,6 +15,14 @@ from openpilot.common.transformations.transformations cimport ned_euler_from_ece
 from openpilot.common.transformations.transformations cimport geodetic2ecef as geodetic2ecef_c
 from openpilot.common.transformations.transformations cimport ecef2geodetic as ecef2geodetic_c
 from openpilot.common.transformations.transformations cimport LocalCoord_c
+from openpilot.common.transformations.transformations cimport euler2quat_batch as euler2quat_batch_c
+from openpilot.common.transformations.transformations cimport quat2euler_batch as quat2euler_batch_c
+from openpilot.common.transformations.transformations cimport quat2rot_batch as quat2rot_batch_c
+from openpilot.common.transformations.transformations cimport rot2quat_batch as rot2quat_batch_c
+from openpilot.common.transformations.transformations cimport euler2rot_batch as euler2rot_batch_c
+from openpilot.common.transformations.transformations cimport rot2euler_batch as rot2euler_batch_c
+from openpilot.common.transformations.transformations cimport geodetic2ecef_batch as geodetic2ecef_batch_c
+from openpilot.common.transformations.transformations cimport ecef2geodetic_batch as ecef2geodetic_batch_c
 
 
 import numpy as np
@@ -53,6 +61,45 @@ cdef Geodetic list2geodetic(geodetic):
     g.alt = geodetic[2]
     return g
 
+# The *_batch functions convert the rows of a C-contiguous float64 (n, k) array into
+# the rows of a preallocated output array, without copying either.
+cdef size_t check_batch(const double[:, ::1] inp, double[:, ::1] out, size_t in_size, size_t out_size) except? 0:
+    if inp.shape[1] != in_size or out.shape[1] != out_size or inp.shape[0] != out.shape[0]:
+        raise ValueError(f"expected ({inp.shape[0]}, {in_size}) input and output of ({inp.shape[0]}, {out_size})")
+    return inp.shape[0]
+
+def euler2quat_batch(const double[:, ::1] euler, double[:, ::1] quat):
+    if check_batch(euler, quat, 3, 4):
+        euler2quat_batch_c(&euler[0, 0], &quat[0, 0], euler.shape[0])
+
+def quat2euler_batch(const double[:, ::1] quat, double[:, ::1] euler):
+    if check_batch(quat, euler, 4, 3):
+        quat2euler_batch_c(&quat[0, 0], &euler[0, 0], quat.shape[0])
+
+def quat2rot_batch(const double[:, ::1] quat, double[:, ::1] rot):
+    if check_batch(quat, rot, 4, 9):
+        quat2rot_batch_c(&quat[0, 0], &rot[0, 0], quat.shape[0])
+
+def rot2quat_batch(const double[:, ::1] rot, double[:, ::1] quat):
+    if check_batch(rot, quat, 9, 4):
+        rot2quat_batch_c(&rot[0, 0], &quat[0, 0], rot.shape[0])
+
+def euler2rot_batch(const double[:, ::1] euler, double[:, ::1] rot):
+    if check_batch(euler, rot, 3, 9):
+        euler2rot_batch_c(&euler[0, 0], &rot[0, 0], euler.shape[0])
+
+def rot2euler_batch(const double[:, ::1] rot, double[:, ::1] euler):
+    if check_batch(rot, euler, 9, 3):
+        rot2euler_batch_c(&rot[0, 0], &euler[0, 0], rot.shape[0])
+
+def geodetic2ecef_batch(const double[:, ::1] geodetic, double[:, ::1] ecef):
+    if check_batch(geodetic, ecef, 3, 3):
+        geodetic2ecef_batch_c(&geodetic[0, 0], &ecef[0, 0], geodetic.shape[0])
+
+def ecef2geodetic_batch(const double[:, ::1] ecef, double[:, ::1] geodetic):
+    if check_batch(ecef, geodetic, 3, 3):
+        ecef2geodetic_batch_c(&ecef[0, 0], &geodetic[0, 0], ecef.shape[0])
+
 def euler2quat_single(euler):
     cdef Vector3 e = Vector3(euler[0], euler[1], euler[2])
     cdef Quaternion q = euler2quat_c(e)
@@ -169,5 +216,25 @@ cdef class LocalCoord:
         cdef Geodetic g = self.lc.ned2geodetic(n)
         return [g.lat, g.lon, g.alt]
 
+    def ecef2ned_batch(self, const double[:, ::1] ecef, double[:, ::1] ned):
+        assert self.lc
+        if check_batch(ecef, ned, 3, 3):
+            self.lc.ecef2ned_batch(&ecef[0, 0], &ned[0, 0], ecef.shape[0])
+
+    def ned2ecef_batch(self, const double[:, ::1] ned, double[:, ::1] ecef):
+        assert self.lc
+        if check_batch(ned, ecef, 3, 3):
+            self.lc.ned2ecef_batch(&ned[0, 0], &ecef[0, 0], ned.shape[0])
+
+    def geodetic2ned_batch(self, const double[:, ::1] geodetic, double[:, ::1] ned):
+        assert self.lc
+        if check_batch(geodetic, ned, 3, 3):
+            self.lc.geodetic2ned_batch(&geodetic[0, 0], &ned[0, 0], geodetic.shape[0])
+
+    def ned2geodetic_batch(self, const double[:, ::1] ned, double[:, ::1] geodetic):
+        assert self.lc
+        if check_batch(ned, geodetic, 3, 3):
+            self.lc.ned2geodetic_batch(&ned[0, 0], &geodetic[0, 0], ned.shape[0])
+
     def __dealloc__(self):
         del self.lc
@@ -11,8 +11,10 @@
 #include <random>
 #include <string>
 #include <limits>
+#include <mutex>
 
 #include <poll.h>
+#include <pthread.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -25,10 +27,117 @@
 
 #include "msgq/msgq.h"
 
+#ifdef __APPLE__
+#define CLOCK_BOOTTIME CLOCK_MONOTONIC
+#endif
+
 void sigusr2_handler(int signal) {
   assert(signal == SIGUSR2);
 }
 
+static std::atomic<bool> trace_enabled = std::getenv("MSGQ_TRACE") != nullptr;
+static std::mutex trace_lock;
+static std::atomic<msgq_trace_buffer_t *> trace_buffer = nullptr;
+static thread_local uint32_t trace_cached_tid = 0;
+// the forking thread is the only one in the child, so its cached tid is the only stale one
+[[maybe_unused]] static const int trace_atfork = pthread_atfork(nullptr, nullptr, [] { trace_cached_tid = 0; });
+
+static uint64_t trace_time() {
+  struct timespec t;
+  clock_gettime(CLOCK_BOOTTIME, &t);
+  return t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+static uint32_t trace_tid() {
+  if (trace_cached_tid == 0) {
+#ifdef __APPLE__
+    trace_cached_tid = getpid();
+#else
+    trace_cached_tid = syscall(SYS_gettid);
+#endif
+  }
+  return trace_cached_tid;
+}
+
+bool msgq_trace_enabled() {
+  return trace_enabled;
+}
+
+void msgq_trace_set_enabled(bool enabled) {
+  trace_enabled = enabled;
+}
+
+msgq_trace_buffer_t *msgq_trace_buffer() {
+  return trace_buffer;
+}
+
+static msgq_trace_buffer_t *trace_buffer_open() {
+  // a forked child gets a buffer of its own
+  const uint32_t pid = getpid();
+  if (msgq_trace_buffer_t *buf = trace_buffer; buf && buf->pid == pid) return buf;
+
+  std::lock_guard lk(trace_lock);
+  if (msgq_trace_buffer_t *buf = trace_buffer; buf && buf->pid == pid) return buf;
+
+  std::string path = "/dev/shm/";
+  if (const char* prefix = std::getenv("OPENPILOT_PREFIX")) {
+    path += std::string(prefix) + "/";
+  }
+  path += "msgq_trace_" + std::to_string(pid);
+
+  const size_t size = sizeof(msgq_trace_buffer_t) + MSGQ_TRACE_CAPACITY * sizeof(msgq_trace_event_t);
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0664);
+  if (fd < 0 || ftruncate(fd, size) < 0) {
+    std::cout << "Warning, could not create msgq trace buffer: " << path << std::endl;
+    if (fd >= 0) close(fd);
+    trace_enabled = false;
+    return nullptr;
+  }
+  void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    trace_enabled = false;
+    return nullptr;
+  }
+
+  auto buf = (msgq_trace_buffer_t *)mem;
+  buf->version = MSGQ_TRACE_VERSION;
+  buf->pid = pid;
+  buf->capacity = MSGQ_TRACE_CAPACITY;
+  buf->next = 0;
+  if (FILE *f = fopen(("/proc/" + std::to_string(pid) + "/comm").c_str(), "r")) {
+    if (fgets(buf->comm, sizeof(buf->comm), f)) {
+      buf->comm[strcspn(buf->comm, "\n")] = '\0';
+    }
+    fclose(f);
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+  buf->magic = MSGQ_TRACE_MAGIC;
+  trace_buffer = buf;
+  return buf;
+}
+
+static void trace_record(const msgq_queue_t *q, const msgq_trace_stamp_t &stamp, uint64_t ready_time, uint64_t dequeue_time, uint32_t size) {
+  msgq_trace_buffer_t *buf = trace_buffer_open();
+  if (!buf) return;
+
+  const uint64_t idx = buf->next.fetch_add(1, std::memory_order_relaxed);
+  msgq_trace_event_t &e = buf->events[idx % buf->capacity];
+  e.commit.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  e.publish_time = stamp.publish_time;
+  e.ready_time = ready_time;
+  e.dequeue_time = dequeue_time;
+  e.seq = stamp.seq;
+  e.publisher_pid = stamp.publisher_pid;
+  e.publisher_tid = stamp.publisher_tid;
+  e.subscriber_tid = trace_tid();
+  e.size = size;
+  strncpy(e.endpoint, q->endpoint.c_str(), sizeof(e.endpoint) - 1);
+  e.endpoint[sizeof(e.endpoint) - 1] = '\0';
+  e.commit.store(idx + 1, std::memory_order_release);
+}
+
 uint64_t msgq_get_uid(void){
   std::random_device rd("/dev/urandom");
   std::uniform_int_distribution<uint64_t> distribution(0, std::numeric_limits<uint32_t>::max());
@@ -132,6 +241,8 @@ int msgq_new_queue(msgq_queue_t * q, const char * path, size_t size){
 
   q->endpoint = path;
   q->read_conflate = false;
+  q->write_seq_local = 0;
+  q->ready_time = 0;
 
   return 0;
 }
@@ -156,6 +267,7 @@ void msgq_init_publisher(msgq_queue_t * q) {
   }
 
   q->write_uid_local = uid;
+  q->write_seq_local = 0;
 }
 
 static void thread_signal(uint32_t tid) {
@@ -225,7 +337,10 @@ int msgq_msg_send(msgq_msg_t * msg, msgq_queue_t *q){
     return -1;
   }
 
-  uint64_t total_msg_size = ALIGN(msg->size + sizeof(int64_t));
+  // Traced messages carry a stamp between the size tag and the data
+  const bool traced = trace_enabled;
+  const uint64_t header_size = sizeof(int64_t) + (traced ? sizeof(msgq_trace_stamp_t) : 0);
+  uint64_t total_msg_size = ALIGN(msg->size + header_size);
 
   // We need to fit at least three messages in the queue,
   // then we can always safely access the last message
@@ -268,7 +383,7 @@ int msgq_msg_send(msgq_msg_t * msg, msgq_queue_t *q){
 
   // Invalidate readers that are in the area that will be written
   uint64_t start = write_pointer;
-  uint64_t end = ALIGN(start + sizeof(int64_t) + msg->size);
+  uint64_t end = ALIGN(start + header_size + msg->size);
 
   for (uint64_t i = 0; i < num_readers; i++){
     uint32_t read_cycles, read_pointer;
@@ -282,14 +397,24 @@ int msgq_msg_send(msgq_msg_t * msg, msgq_queue_t *q){
 
   // Write size tag
   std::atomic<int64_t> *size_p = reinterpret_cast<std::atomic<int64_t>*>(p);
-  *size_p = msg->size;
+  *size_p = msg->size | (traced ? MSGQ_TRACE_FLAG : 0);
+
+  if (traced) {
+    msgq_trace_stamp_t stamp = {
+      .publish_time = trace_time(),
+      .seq = ++q->write_seq_local,
+      .publisher_pid = (uint32_t)getpid(),
+      .publisher_tid = trace_tid(),
+    };
+    memcpy(p + sizeof(int64_t), &stamp, sizeof(stamp));
+  }
 
   // Copy data
-  memcpy(p + sizeof(int64_t), msg->data, msg->size);
+  memcpy(p + header_size, msg->data, msg->size);
   __sync_synchronize();
 
   // Update write pointer
-  uint32_t new_ptr = ALIGN(write_pointer + msg->size + sizeof(int64_t));
+  uint32_t new_ptr = ALIGN(write_pointer + msg->size + header_size);
   PACK64(*q->write_pointer, write_cycles, new_ptr);
 
   // Notify readers
@@ -328,7 +453,11 @@ int msgq_msg_ready(msgq_queue_t * q){
   UNUSED(write_cycles);
 
   // Check if new message is available
-  return (read_pointer != write_pointer);
+  bool ready = read_pointer != write_pointer;
+  if (ready && q->ready_time == 0 && trace_enabled) {
+    q->ready_time = trace_time();
+  }
+  return ready;
 }
 
 int msgq_msg_recv(msgq_msg_t * msg, msgq_queue_t * q){
@@ -380,12 +509,16 @@ int msgq_msg_recv(msgq_msg_t * msg, msgq_queue_t * q){
     goto start;
   }
 
+  const bool traced = size & MSGQ_TRACE_FLAG;
+  size &= ~MSGQ_TRACE_FLAG;
+  const uint64_t header_size = sizeof(std::int64_t) + (traced ? sizeof(msgq_trace_stamp_t) : 0);
+
   // crashing is better than passing garbage data to the consumer
   // the size will have weird value if it was overwritten by data accidentally
   assert((uint64_t)size < q->size);
   assert(size > 0);
 
-  uint32_t new_read_pointer = ALIGN(read_pointer + sizeof(std::int64_t) + size);
+  uint32_t new_read_pointer = ALIGN(read_pointer + header_size + size);
 
   // If conflate is true, check if this is the latest message, else start over
   if (q->read_conflate){
@@ -400,8 +533,12 @@ int msgq_msg_recv(msgq_msg_t * msg, msgq_queue_t * q){
   if (msgq_msg_init_size(msg, size) < 0)
     return -1;
 
+  msgq_trace_stamp_t stamp;
   __sync_synchronize();
-  memcpy(msg->data, p + sizeof(int64_t), size);
+  if (traced) {
+    memcpy(&stamp, p + sizeof(int64_t), sizeof(stamp));
+  }
+  memcpy(msg->data, p + header_size, size);
   __sync_synchronize();
 
   // Update read pointer
@@ -414,6 +551,11 @@ int msgq_msg_recv(msgq_msg_t * msg, msgq_queue_t * q){
     goto start;
   }
 
+  if (traced && trace_enabled) {
+    const uint64_t now = trace_time();
+    trace_record(q, stamp, q->ready_time ? q->ready_time : now, now, size);
+  }
+  q->ready_time = 0;
 
   return msg->size;
 }
@@ -22,6 +22,51 @@ struct  msgq_header_t {
   uint64_t read_uids[NUM_READERS];
 };
 
+// Optional latency tracing, enabled with MSGQ_TRACE=1. Publishers prepend a stamp to
+// each message, flagged in the size tag, and subscribers log every stamped message
+// they dequeue into a per-process ring buffer in /dev/shm/[prefix/]msgq_trace_<pid>.
+// The buffer outlives the process; the exporter removes it once the process has exited.
+// tools/profiling/perfetto/msgq_trace.py turns the buffers into a Perfetto trace.
+#define MSGQ_TRACE_FLAG (1LL << 62)
+#define MSGQ_TRACE_MAGIC 0x5254514d  // "MQTR"
+#define MSGQ_TRACE_VERSION 1
+#define MSGQ_TRACE_CAPACITY 16384
+
+struct msgq_trace_stamp_t {
+  uint64_t publish_time;  // CLOCK_BOOTTIME ns
+  uint64_t seq;           // per publisher, starting at 1
+  uint32_t publisher_pid;
+  uint32_t publisher_tid;
+};
+
+struct msgq_trace_event_t {
+  std::atomic<uint64_t> commit;  // ring index + 1 once the event is complete
+  uint64_t publish_time;
+  uint64_t ready_time;     // first seen by msgq_poll, or the dequeue time when not polled
+  uint64_t dequeue_time;
+  uint64_t seq;
+  uint32_t publisher_pid;
+  uint32_t publisher_tid;
+  uint32_t subscriber_tid;
+  uint32_t size;
+  char endpoint[32];
+};
+
+struct msgq_trace_buffer_t {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t pid;
+  uint32_t capacity;
+  std::atomic<uint64_t> next;
+  char comm[16];
+  uint64_t reserved[3];
+  msgq_trace_event_t events[];
+};
+
+static_assert(sizeof(msgq_trace_stamp_t) == 24);
+static_assert(sizeof(msgq_trace_event_t) == 88);
+static_assert(sizeof(msgq_trace_buffer_t) == 64);
+
 struct msgq_queue_t {
   std::atomic<uint64_t> *num_readers;
   std::atomic<uint64_t> *write_pointer;
@@ -35,6 +80,8 @@ struct msgq_queue_t {
   int reader_id;
   uint64_t read_uid_local;
   uint64_t write_uid_local;
+  uint64_t write_seq_local;
+  uint64_t ready_time;
 
   bool read_conflate;
   std::string endpoint;
@@ -68,3 +115,8 @@ int msgq_msg_ready(msgq_queue_t * q);
 int msgq_poll(msgq_pollitem_t * items, size_t nitems, int timeout);
 
 bool msgq_all_readers_updated(msgq_queue_t *q);
+
+bool msgq_trace_enabled();
+void msgq_trace_set_enabled(bool enabled);
+// this process's trace buffer, NULL until the first traced message is received
+msgq_trace_buffer_t *msgq_trace_buffer();
@@ -1,3 +1,9 @@
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <string>
+
 #include "catch2/catch.hpp"
 #include "msgq/msgq.h"
 
@@ -422,3 +428,97 @@ TEST_CASE("1 publisher, 2 subscribers", "[integration]")
     msgq_msg_close(&msg2);
   }
 }
+
+TEST_CASE("Traced messages", "[integration]")
+{
+  remove("/dev/shm/test_queue");
+  const size_t msg_size = 100;
+  msgq_queue_t writer, reader;
+
+  msgq_new_queue(&writer, "test_queue", 1024);
+  msgq_new_queue(&reader, "test_queue", 1024);
+
+  msgq_init_publisher(&writer);
+  msgq_init_subscriber(&reader);
+
+  msgq_msg_t outgoing_msg;
+  msgq_msg_init_size(&outgoing_msg, msg_size);
+  for (size_t i = 0; i < msg_size; i++)
+  {
+    outgoing_msg.data[i] = i;
+  }
+
+  msgq_trace_set_enabled(true);
+  REQUIRE(msgq_msg_send(&outgoing_msg, &writer) == msg_size);
+  REQUIRE((*(int64_t *)writer.data & MSGQ_TRACE_FLAG) != 0);
+  REQUIRE(*writer.write_pointer == ALIGN(msg_size + sizeof(int64_t) + sizeof(msgq_trace_stamp_t)));
+
+  // Stamped and plain messages can be mixed in the same queue
+  msgq_trace_set_enabled(false);
+  REQUIRE(msgq_msg_send(&outgoing_msg, &writer) == msg_size);
+  msgq_trace_set_enabled(true);
+  REQUIRE(msgq_msg_send(&outgoing_msg, &writer) == msg_size);
+
+  msgq_pollitem_t item = {.q = &reader};
+  REQUIRE(msgq_poll(&item, 1, 0) == 1);
+
+  msgq_trace_buffer_t *buf = msgq_trace_buffer();
+  const uint64_t first_event = buf ? buf->next.load() : 0;
+  for (int i = 0; i < 3; i++)
+  {
+    msgq_msg_t incoming_msg;
+    REQUIRE(msgq_msg_recv(&incoming_msg, &reader) == msg_size);
+    REQUIRE(memcmp(incoming_msg.data, outgoing_msg.data, msg_size) == 0);
+    msgq_msg_close(&incoming_msg);
+  }
+  msgq_trace_set_enabled(false);
+
+  // Only the stamped messages are recorded
+  buf = msgq_trace_buffer();
+  REQUIRE(buf != nullptr);
+  REQUIRE(buf->magic == MSGQ_TRACE_MAGIC);
+  REQUIRE(buf->pid == (uint32_t)getpid());
+  REQUIRE(buf->next == first_event + 2);
+
+  const uint64_t expected_seq[] = {1, 2};
+  for (int i = 0; i < 2; i++)
+  {
+    const uint64_t idx = first_event + i;
+    const msgq_trace_event_t &e = buf->events[idx % buf->capacity];
+    REQUIRE(e.commit == idx + 1);
+    REQUIRE(e.seq == expected_seq[i]);
+    REQUIRE(e.size == msg_size);
+    REQUIRE(e.publisher_pid == (uint32_t)getpid());
+    REQUIRE(std::string(e.endpoint) == "test_queue");
+    REQUIRE(e.publish_time <= e.ready_time);
+    REQUIRE(e.ready_time <= e.dequeue_time);
+  }
+
+  // a forked child records into a buffer of its own, with its own thread ids
+  pid_t child = fork();
+  if (child == 0) {
+    msgq_trace_set_enabled(true);
+    msgq_msg_send(&outgoing_msg, &writer);
+    msgq_msg_t incoming_msg;
+    const bool received = msgq_msg_recv(&incoming_msg, &reader) == msg_size;
+    msgq_trace_buffer_t *child_buf = msgq_trace_buffer();
+    const bool ok = received && child_buf && child_buf != buf && child_buf->pid == (uint32_t)getpid() &&
+                    child_buf->events[0].publisher_tid == (uint32_t)getpid() &&
+                    child_buf->events[0].subscriber_tid == (uint32_t)getpid();
+    _exit(ok ? 0 : 1);
+  }
+  int status = 0;
+  pid_t ret;
+  // the child's send signals this process's subscriber
+  while ((ret = waitpid(child, &status, 0)) < 0 && errno == EINTR) {}
+  REQUIRE(ret == child);
+  REQUIRE((WIFEXITED(status) && WEXITSTATUS(status) == 0));
+
+  // the buffers outlive their processes until the exporter has read them
+  const std::string child_trace_file = "/dev/shm/msgq_trace_" + std::to_string(child);
+  REQUIRE(access(child_trace_file.c_str(), F_OK) == 0);
+  unlink(child_trace_file.c_str());
+  unlink(("/dev/shm/msgq_trace_" + std::to_string(getpid())).c_str());
+
+  msgq_msg_close(&outgoing_msg);
+}
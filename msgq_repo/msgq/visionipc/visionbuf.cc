@@ -1,5 +1,10 @@
 #include "msgq/visionipc/visionbuf.h"
 
+#include <signal.h>
+#include <unistd.h>
+
+#include <cerrno>
+
 #define ALIGN(x, align) (((x) + (align)-1) & ~((align)-1))
 
 void visionbuf_compute_aligned_width_and_height(int width, int height, int *aligned_w, int *aligned_h) {
@@ -33,3 +38,57 @@ uint64_t VisionBuf::get_frame_id() {
 void VisionBuf::set_frame_id(uint64_t id) {
   *frame_id = id;
 }
+
+// Claims and leases are ordered like Dekker's algorithm: the server sets writing before it
+// checks the lease slots, and a client takes a slot before it checks writing, so at least
+// one of them sees the other.
+bool VisionBuf::claim(bool force) {
+  shared->writing = true;
+  bool leased = false;
+  for (auto &lease : shared->leases) {
+    int32_t pid = lease.load();
+    if (pid == 0) continue;
+    if (kill(pid, 0) != 0 && errno == ESRCH) {
+      // the client died while holding its lease
+      lease.compare_exchange_strong(pid, 0);
+      continue;
+    }
+    leased = true;
+  }
+  if (leased && !force) {
+    shared->writing = false;
+  }
+  return !leased;
+}
+
+uint64_t VisionBuf::publish() {
+  const uint64_t seq = shared->seq.fetch_add(1) + 1;
+  shared->writing = false;
+  return seq;
+}
+
+bool VisionBuf::acquire_lease(uint64_t seq) {
+  const int32_t pid = getpid();
+  for (int i = 0; i < VISIONBUF_MAX_LEASES && lease_slot < 0; i++) {
+    int32_t free_slot = 0;
+    if (shared->leases[i].compare_exchange_strong(free_slot, pid)) {
+      lease_slot = i;
+    }
+  }
+  if (lease_slot < 0) return false;
+
+  // the server may be filling the buffer, or have refilled and sent it again since this frame was sent
+  if (shared->writing.load() || shared->seq.load() != seq) {
+    shared->leases[lease_slot] = 0;
+    lease_slot = -1;
+    return false;
+  }
+  return true;
+}
+
+bool VisionBuf::release_lease(uint64_t seq) {
+  const bool intact = !shared->writing.load() && shared->seq.load() == seq;
+  shared->leases[lease_slot] = 0;
+  lease_slot = -1;
+  return intact;
+}
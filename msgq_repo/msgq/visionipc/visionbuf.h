@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 #include "msgq/visionipc/visionipc.h"
 
 #define CL_USE_DEPRECATED_OPENCL_1_2_APIS
@@ -21,12 +23,28 @@ enum VisionStreamType {
   VISION_STREAM_MAX,
 };
 
+#define VISIONBUF_MAX_LEASES 8
+
+// Shared by the server and all clients, mapped right after the buffer data
+struct VisionBufShared {
+  uint64_t frame_id;
+  std::atomic<uint64_t> seq;   // bumped each time the server sends the buffer
+  std::atomic<bool> writing;   // set while the server fills the buffer
+  // pids of the clients holding a lease, 0 if the slot is free. The owner pid lets the
+  // server reclaim leases of clients that died without releasing them.
+  std::atomic<int32_t> leases[VISIONBUF_MAX_LEASES];
+};
+
+// offset of VisionBufShared after size bytes of data, on its own cache line
+inline size_t visionbuf_shared_offset(size_t size) { return (size + 63) & ~(size_t)63; }
+
 class VisionBuf {
  public:
   size_t len = 0;
   size_t mmap_len = 0;
   void * addr = nullptr;
   uint64_t *frame_id;
+  VisionBufShared *shared = nullptr;
   int fd = 0;
 
   bool rgb = false;
@@ -51,6 +69,9 @@ class VisionBuf {
   // ion
   int handle = 0;
 
+  // slot of this client's lease in shared->leases, -1 if not leased
+  int lease_slot = -1;
+
   void allocate(size_t len);
   void import();
   void init_cl(cl_device_id device_id, cl_context ctx);
@@ -61,6 +82,15 @@ class VisionBuf {
 
   void set_frame_id(uint64_t id);
   uint64_t get_frame_id();
+
+  // Leases. The server claims a buffer before filling it, which fails while clients hold
+  // leases on it unless forced, and publishes it when sent. A client lease only succeeds
+  // if the buffer still holds the frame with sequence number seq, and a free slot is left.
+  bool claim(bool force);
+  uint64_t publish();
+  bool acquire_lease(uint64_t seq);
+  // returns false if the buffer was overwritten while leased
+  bool release_lease(uint64_t seq);
 };
 
 void visionbuf_compute_aligned_width_and_height(int width, int height, int *aligned_w, int *aligned_h);
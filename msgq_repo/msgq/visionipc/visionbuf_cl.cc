@@ -11,7 +11,40 @@
 
 std::atomic<int> offset = 0;
 
-static void *malloc_with_fd(size_t len, int *fd) {
+#ifdef __linux__
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+static void *mmap_memfd(size_t *len, int *fd, bool hugepages) {
+  const size_t size = hugepages ? (*len + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1) : *len;
+  *fd = memfd_create("visionbuf", MFD_CLOEXEC | (hugepages ? MFD_HUGETLB : 0));
+  if (*fd < 0) return MAP_FAILED;
+
+  void *addr = MAP_FAILED;
+  if (ftruncate(*fd, size) == 0) {
+    addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+  }
+  if (addr == MAP_FAILED) {
+    close(*fd);
+  } else {
+    *len = size;
+  }
+  return addr;
+}
+#endif
+
+// Shared memory that is only reachable through the fd, which clients receive over
+// the listener socket and map zero-copy. len may be rounded up.
+static void *malloc_with_fd(size_t *len, int *fd) {
+#ifdef __linux__
+  // VISIONBUF_HUGEPAGES=1 backs buffers with huge pages when the system has them reserved
+  if (const char *env = getenv("VISIONBUF_HUGEPAGES"); env && atoi(env) > 0) {
+    void *addr = mmap_memfd(len, fd, true);
+    if (addr != MAP_FAILED) return addr;
+  }
+  void *addr = mmap_memfd(len, fd, false);
+  if (addr != MAP_FAILED) return addr;
+#endif
+
   char full_path[0x100];
 
 #ifdef __APPLE__
@@ -25,18 +58,19 @@ static void *malloc_with_fd(size_t len, int *fd) {
 
   unlink(full_path);
 
-  ftruncate(*fd, len);
-  void *addr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
-  assert(addr != MAP_FAILED);
+  ftruncate(*fd, *len);
+  void *mem = mmap(NULL, *len, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+  assert(mem != MAP_FAILED);
 
-  return addr;
+  return mem;
 }
 
 void VisionBuf::allocate(size_t length) {
   this->len = length;
-  this->mmap_len = this->len + sizeof(uint64_t);
-  this->addr = malloc_with_fd(this->mmap_len, &this->fd);
-  this->frame_id = (uint64_t*)((uint8_t*)this->addr + this->len);
+  this->mmap_len = visionbuf_shared_offset(this->len) + sizeof(VisionBufShared);
+  this->addr = malloc_with_fd(&this->mmap_len, &this->fd);
+  this->shared = (VisionBufShared*)((uint8_t*)this->addr + visionbuf_shared_offset(this->len));
+  this->frame_id = &this->shared->frame_id;
 }
 
 void VisionBuf::init_cl(cl_device_id device_id, cl_context ctx){
@@ -55,7 +89,8 @@ void VisionBuf::import(){
   this->addr = mmap(NULL, this->mmap_len, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
   assert(this->addr != MAP_FAILED);
 
-  this->frame_id = (uint64_t*)((uint8_t*)this->addr + this->len);
+  this->shared = (VisionBufShared*)((uint8_t*)this->addr + visionbuf_shared_offset(this->len));
+  this->frame_id = &this->shared->frame_id;
 }
 
 
@@ -86,7 +121,7 @@ int VisionBuf::free() {
     if (err != 0) return err;
   }
 
-  err = munmap(this->addr, this->len);
+  err = munmap(this->addr, this->mmap_len);
   if (err != 0) return err;
 
   err = close(this->fd);
@@ -21,5 +21,6 @@ struct VisionIpcBufExtra {
 struct VisionIpcPacket {
   uint64_t server_id;
   size_t idx;
+  uint64_t seq;
   struct VisionIpcBufExtra extra;
 };
@@ -32,6 +32,7 @@ VisionIpcClient::VisionIpcClient(std::string name, VisionStreamType type, bool c
 // Connect is not thread safe. Do not use the buffers while calling connect
 bool VisionIpcClient::connect(bool blocking){
   connected = false;
+  release();
 
   // Cleanup old buffers on reconnect
   for (size_t i = 0; i < num_buffers; i++){
@@ -78,6 +79,7 @@ bool VisionIpcClient::connect(bool blocking){
 }
 
 VisionBuf * VisionIpcClient::recv(VisionIpcBufExtra * extra, const int timeout_ms){
+  release();
   auto p = poller->poll(timeout_ms);
 
   if (!p.size()){
@@ -102,6 +104,16 @@ VisionBuf * VisionIpcClient::recv(VisionIpcBufExtra * extra, const int timeout_m
     return nullptr;
   }
 
+  if (use_leases) {
+    if (!buf->acquire_lease(packet->seq)) {
+      dropped_frames++;
+      delete r;
+      return nullptr;
+    }
+    leased_buf = buf;
+    leased_seq = packet->seq;
+  }
+
   if (extra) {
     *extra = packet->extra;
   }
@@ -114,6 +126,15 @@ VisionBuf * VisionIpcClient::recv(VisionIpcBufExtra * extra, const int timeout_m
   return buf;
 }
 
+void VisionIpcClient::release() {
+  if (leased_buf) {
+    if (!leased_buf->release_lease(leased_seq)) {
+      overrun_frames++;
+    }
+    leased_buf = nullptr;
+  }
+}
+
 std::set<VisionStreamType> VisionIpcClient::getAvailableStreams(const std::string &name, bool blocking) {
   int socket_fd = connect_to_vipc_server(name, blocking);
   if (socket_fd < 0) {
@@ -132,6 +153,7 @@ std::set<VisionStreamType> VisionIpcClient::getAvailableStreams(const std::strin
 }
 
 VisionIpcClient::~VisionIpcClient(){
+  release();
   for (size_t i = 0; i < num_buffers; i++){
     if (buffers[i].free() != 0) {
       LOGE("Failed to free buffer %zu", i);
@@ -17,15 +17,25 @@ private:
   cl_device_id device_id = nullptr;
   cl_context ctx = nullptr;
 
+  VisionBuf *leased_buf = nullptr;
+  uint64_t leased_seq = 0;
+
 public:
   bool connected = false;
   VisionStreamType type;
   int num_buffers = 0;
   VisionBuf buffers[VISIONIPC_MAX_FDS];
+
+  // With leases, a received buffer is held until the next recv() or release(), and
+  // the server doesn't reuse it in the meantime.
+  bool use_leases = false;
+  uint64_t dropped_frames = 0;  // reused by the server before they could be leased
+  uint64_t overrun_frames = 0;  // overwritten while leased, because the server ran out of buffers
   VisionIpcClient(std::string name, VisionStreamType type, bool conflate, cl_device_id device_id=nullptr, cl_context ctx=nullptr);
   ~VisionIpcClient();
   VisionBuf * recv(VisionIpcBufExtra * extra=nullptr, const int timeout_ms=100);
   bool connect(bool blocking=true);
+  void release();
   bool is_connected() { return connected; }
   static std::set<VisionStreamType> getAvailableStreams(const std::string &name, bool blocking = true);
 };
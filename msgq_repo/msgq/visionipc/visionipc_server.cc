@@ -76,6 +76,7 @@ void VisionIpcServer::create_buffers_with_sizes(VisionStreamType type, size_t nu
   }
 
   cur_idx[type] = 0;
+  stats[type];
 
   // Create msgq publisher for each of the `name` + type combos
   // TODO: compute port number directly if using zmq
@@ -168,10 +169,20 @@ void VisionIpcServer::listener(){
 
 
 VisionBuf * VisionIpcServer::get_buffer(VisionStreamType type){
-  // Do we want to keep track if the buffer has been sent out yet and warn user?
   assert(buffers.count(type));
-  auto b = buffers[type];
-  return b[cur_idx[type]++ % b.size()];
+  auto &b = buffers[type];
+  for (size_t i = 0; i < b.size(); i++) {
+    VisionBuf *buf = b[cur_idx[type]++ % b.size()];
+    if (buf->claim(false)) {
+      return buf;
+    }
+    stats[type].skipped++;
+  }
+
+  VisionBuf *buf = b[cur_idx[type]++ % b.size()];
+  buf->claim(true);
+  stats[type].overruns++;
+  return buf;
 }
 
 void VisionIpcServer::send(VisionBuf * buf, VisionIpcBufExtra * extra, bool sync){
@@ -187,9 +198,11 @@ void VisionIpcServer::send(VisionBuf * buf, VisionIpcBufExtra * extra, bool sync
   VisionIpcPacket packet = {0};
   packet.server_id = server_id;
   packet.idx = buf->idx;
+  packet.seq = buf->publish();
   packet.extra = *extra;
 
   sockets[buf->type]->send((char*)&packet, sizeof(packet));
+  stats[buf->type].sent++;
 }
 
 VisionIpcServer::~VisionIpcServer(){
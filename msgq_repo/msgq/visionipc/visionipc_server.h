@@ -11,6 +11,12 @@
 std::string get_endpoint_name(std::string name, VisionStreamType type);
 std::string get_ipc_path(const std::string &name);
 
+struct VisionIpcServerStats {
+  std::atomic<uint64_t> sent = 0;
+  std::atomic<uint64_t> skipped = 0;   // buffers passed over in get_buffer because clients held leases on them
+  std::atomic<uint64_t> overruns = 0;  // leased buffers overwritten because all buffers were leased
+};
+
 class VisionIpcServer {
  private:
   cl_device_id device_id = nullptr;
@@ -23,6 +29,7 @@ class VisionIpcServer {
 
   std::map<VisionStreamType, std::atomic<size_t> > cur_idx;
   std::map<VisionStreamType, std::vector<VisionBuf*> > buffers;
+  std::map<VisionStreamType, VisionIpcServerStats> stats;
 
   Context * msg_ctx;
   std::map<VisionStreamType, PubSocket*> sockets;
@@ -33,7 +40,9 @@ class VisionIpcServer {
   VisionIpcServer(std::string name, cl_device_id device_id=nullptr, cl_context ctx=nullptr);
   ~VisionIpcServer();
 
+  // Buffers leased by clients are skipped; if all of them are, the next one is overwritten anyway.
   VisionBuf * get_buffer(VisionStreamType type);
+  const VisionIpcServerStats &get_stats(VisionStreamType type) { return stats.at(type); }
 
   void create_buffers(VisionStreamType type, size_t num_buffers, bool rgb, size_t width, size_t height);
   void create_buffers_with_sizes(VisionStreamType type, size_t num_buffers, bool rgb, size_t width, size_t height, size_t size, size_t stride, size_t uv_offset);
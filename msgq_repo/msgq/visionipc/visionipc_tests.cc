@@ -1,5 +1,15 @@
-#include <thread>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "catch2/catch.hpp"
 
@@ -13,6 +23,77 @@ static void zmq_sleep(int milliseconds=1000){
   }
 }
 
+#ifdef __linux__
+static std::string fd_path(int fd) {
+  char path[PATH_MAX];
+  ssize_t n = readlink(("/proc/self/fd/" + std::to_string(fd)).c_str(), path, sizeof(path));
+  return n > 0 ? std::string(path, n) : "";
+}
+
+static int free_huge_pages() {
+  std::ifstream meminfo("/proc/meminfo");
+  std::string key;
+  int value = 0;
+  while (meminfo >> key) {
+    if (key == "HugePages_Free:" && meminfo >> value) return value;
+  }
+  return 0;
+}
+
+TEST_CASE("memfd buffers"){
+  const size_t len = 100 * 100 * 3 / 2;
+  const size_t mmap_len = visionbuf_shared_offset(len) + sizeof(VisionBufShared);
+
+  SECTION("regular pages") {
+    unsetenv("VISIONBUF_HUGEPAGES");
+    VisionBuf buf;
+    buf.allocate(len);
+    REQUIRE(fd_path(buf.fd).rfind("/memfd:visionbuf", 0) == 0);
+    REQUIRE(buf.mmap_len == mmap_len);
+
+    // a client maps the same memory through the fd it receives
+    VisionBuf client;
+    client.len = buf.len;
+    client.mmap_len = buf.mmap_len;
+    client.fd = dup(buf.fd);
+    client.import();
+    memset(buf.addr, 0xab, buf.len);
+    buf.set_frame_id(42);
+    REQUIRE(((uint8_t *)client.addr)[len - 1] == 0xab);
+    REQUIRE(client.get_frame_id() == 42);
+
+    REQUIRE(client.free() == 0);
+    REQUIRE(buf.free() == 0);
+  }
+
+  SECTION("VISIONBUF_HUGEPAGES=0 uses regular pages") {
+    setenv("VISIONBUF_HUGEPAGES", "0", 1);
+    VisionBuf buf;
+    buf.allocate(len);
+    unsetenv("VISIONBUF_HUGEPAGES");
+    REQUIRE(buf.mmap_len == mmap_len);
+    REQUIRE(buf.free() == 0);
+  }
+
+  SECTION("huge pages fall back to regular pages") {
+    setenv("VISIONBUF_HUGEPAGES", "1", 1);
+    VisionBuf buf;
+    buf.allocate(len);
+    unsetenv("VISIONBUF_HUGEPAGES");
+
+    REQUIRE(fd_path(buf.fd).rfind("/memfd:visionbuf", 0) == 0);
+    if (free_huge_pages() == 0) {
+      REQUIRE(buf.mmap_len == mmap_len);
+    } else {
+      // either got huge pages or fell back when they were taken in the meantime
+      REQUIRE((buf.mmap_len == mmap_len || buf.mmap_len % (2 * 1024 * 1024) == 0));
+    }
+    memset(buf.addr, 0xcd, buf.len);
+    REQUIRE(buf.free() == 0);
+  }
+}
+#endif
+
 TEST_CASE("Connecting"){
   VisionIpcServer server("camerad");
   server.create_buffers(VISION_STREAM_ROAD, 1, false, 100, 100);
@@ -148,3 +229,127 @@ TEST_CASE("Test conflate"){
   recv_buf = client.recv(&extra_recv);
   REQUIRE(recv_buf == nullptr);
 }
+
+TEST_CASE("Leased buffers are skipped"){
+  VisionIpcServer server("camerad");
+  server.create_buffers(VISION_STREAM_ROAD, 2, false, 100, 100);
+  server.start_listener();
+
+  VisionIpcClient client = VisionIpcClient("camerad", VISION_STREAM_ROAD, false);
+  client.use_leases = true;
+  REQUIRE(client.connect());
+  zmq_sleep();
+
+  VisionIpcBufExtra extra = {0};
+  VisionBuf *leased = server.get_buffer(VISION_STREAM_ROAD);
+  server.send(leased, &extra);
+  REQUIRE(client.recv(&extra) != nullptr);
+
+  // only the other buffer is handed out while the client holds its lease
+  for (int i = 0; i < 3; i++) {
+    VisionBuf *buf = server.get_buffer(VISION_STREAM_ROAD);
+    REQUIRE(buf->idx != leased->idx);
+    server.send(buf, &extra);
+  }
+  REQUIRE(server.get_stats(VISION_STREAM_ROAD).skipped > 0);
+  REQUIRE(server.get_stats(VISION_STREAM_ROAD).overruns == 0);
+
+  client.release();
+  REQUIRE(client.overrun_frames == 0);
+
+  SECTION("frames refilled before they were leased are dropped"){
+    // the three frames queued above all used the same buffer
+    REQUIRE(client.recv(&extra) == nullptr);
+    REQUIRE(client.dropped_frames == 1);
+  }
+}
+
+TEST_CASE("Leased buffer overrun"){
+  VisionIpcServer server("camerad");
+  server.create_buffers(VISION_STREAM_ROAD, 1, false, 100, 100);
+  server.start_listener();
+
+  VisionIpcClient client = VisionIpcClient("camerad", VISION_STREAM_ROAD, false);
+  client.use_leases = true;
+  REQUIRE(client.connect());
+  zmq_sleep();
+
+  VisionIpcBufExtra extra = {0};
+  server.send(server.get_buffer(VISION_STREAM_ROAD), &extra);
+  REQUIRE(client.recv(&extra) != nullptr);
+
+  // with every buffer leased, the server overwrites one anyway and both sides count it
+  server.get_buffer(VISION_STREAM_ROAD);
+  REQUIRE(server.get_stats(VISION_STREAM_ROAD).overruns == 1);
+  client.release();
+  REQUIRE(client.overrun_frames == 1);
+}
+
+TEST_CASE("Leases of dead clients are reclaimed"){
+  VisionIpcServer server("camerad");
+  server.create_buffers(VISION_STREAM_ROAD, 1, false, 100, 100);
+  server.start_listener();
+
+  VisionIpcBufExtra extra = {0};
+  VisionBuf *buf = server.get_buffer(VISION_STREAM_ROAD);
+  server.send(buf, &extra);
+
+  // a client that exited while holding a lease
+  pid_t pid = fork();
+  if (pid == 0) _exit(0);
+  REQUIRE(waitpid(pid, nullptr, 0) == pid);
+  buf->shared->leases[0] = pid;
+
+  REQUIRE(server.get_buffer(VISION_STREAM_ROAD) == buf);
+  REQUIRE(server.get_stats(VISION_STREAM_ROAD).overruns == 0);
+  REQUIRE(buf->shared->leases[0] == 0);
+}
+
+TEST_CASE("Slow consumer with leases"){
+  const size_t width = 320, height = 240, num_buffers = 4, num_frames = 200;
+  VisionIpcServer server("camerad");
+  server.create_buffers(VISION_STREAM_ROAD, num_buffers, false, width, height);
+  server.start_listener();
+
+  VisionIpcClient client = VisionIpcClient("camerad", VISION_STREAM_ROAD, true);
+  client.use_leases = true;
+  REQUIRE(client.connect());
+  zmq_sleep();
+
+  std::atomic<bool> done = false;
+  int received = 0, torn = 0;
+  std::thread consumer([&]() {
+    VisionIpcBufExtra extra = {0};
+    while (!done) {
+      VisionBuf *buf = client.recv(&extra, 10);
+      if (!buf) continue;
+
+      received++;
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      // every byte of a frame is its frame id
+      uint8_t *data = (uint8_t *)buf->addr;
+      torn += std::count(data, data + buf->len, (uint8_t)extra.frame_id) != buf->len;
+    }
+    client.release();
+  });
+
+  for (uint32_t i = 0; i < num_frames; i++) {
+    VisionBuf *buf = server.get_buffer(VISION_STREAM_ROAD);
+    memset(buf->addr, (uint8_t)i, buf->len);
+    VisionIpcBufExtra extra = {0};
+    extra.frame_id = i;
+    server.send(buf, &extra);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  done = true;
+  consumer.join();
+
+  const auto &stats = server.get_stats(VISION_STREAM_ROAD);
+  INFO("received " << received << ", dropped " << client.dropped_frames << ", skipped " << stats.skipped);
+  REQUIRE(received > 0);
+  REQUIRE(torn == 0);
+  REQUIRE(stats.sent == num_frames);
+  REQUIRE(stats.overruns == 0);
+  REQUIRE(client.overrun_frames == 0);
+}
@@ -89,12 +89,34 @@ public:
 
 class CANPacker {
 private:
+  // A message and the signals a caller packs into it, resolved once by plan()
+  struct PackPlan {
+    uint32_t address;
+    unsigned int size;
+    std::vector<const Signal *> sigs;  // nullptr for undefined signals, which are skipped
+    int counter_idx = -1;              // position of COUNTER in sigs
+    const Signal *counter = nullptr;
+    const Signal *checksum = nullptr;
+  };
+
   const DBC *dbc = NULL;
   std::map<std::pair<uint32_t, std::string>, Signal> signal_lookup;
   std::map<uint32_t, uint32_t> counters;
+  std::unordered_map<uint32_t, PackPlan> message_plans;  // counter and checksum of every message
+  std::vector<PackPlan> plans;
+
+  void finish(const PackPlan &plan, bool counter_set, std::vector<uint8_t> &out);
 
 public:
   CANPacker(const std::string& dbc_name);
   std::vector<uint8_t> pack(uint32_t address, const std::vector<SignalPackValue> &values);
   const Msg* lookup_message(uint32_t address);
+
+  // Resolves a message and the names of the signals to pack into it. Returns a handle
+  // for pack_plan() and pack_many(), or -1 if the address is undefined.
+  int plan(uint32_t address, const std::vector<std::string> &signal_names);
+  // Packs one value per planned signal into out, the same bytes as pack() would produce
+  void pack_plan(int handle, const double *values, std::vector<uint8_t> &out);
+  // Packs a batch of messages, taking the values of each plan in turn from one flat array
+  void pack_many(const std::vector<int> &handles, const double *values, std::vector<std::vector<uint8_t>> &out);
 };
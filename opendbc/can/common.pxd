@@ -76,3 +76,5 @@ cdef extern from "common.h":
   cdef cppclass CANPacker:
    CANPacker(string)
    vector[uint8_t] pack(uint32_t, vector[SignalPackValue]&)
+   int plan(uint32_t, vector[string]&)
+   void pack_many(vector[int]&, const double*, vector[vector[uint8_t]]&) except +
@@ -33,20 +33,33 @@ CANPacker::CANPacker(const std::string& dbc_name) {
   assert(dbc);
 
   for (const auto& msg : dbc->msgs) {
+    PackPlan &p = message_plans[msg.address];
+    p.address = msg.address;
+    p.size = msg.size;
     for (const auto& sig : msg.sigs) {
       signal_lookup[std::make_pair(msg.address, sig.name)] = sig;
+      if (sig.name == "COUNTER") p.counter = &sig;
+      if (sig.name == "CHECKSUM") p.checksum = &sig;
     }
   }
 }
 
+static int64_t to_raw(const Signal &sig, double value) {
+  int64_t ival = (int64_t)(round((value - sig.offset) / sig.factor));
+  if (ival < 0) {
+    ival = (1ULL << sig.size) + ival;
+  }
+  return ival;
+}
+
 std::vector<uint8_t> CANPacker::pack(uint32_t address, const std::vector<SignalPackValue> &signals) {
-  auto msg_it = dbc->addr_to_msg.find(address);
-  if (msg_it == dbc->addr_to_msg.end()) {
+  auto msg_it = message_plans.find(address);
+  if (msg_it == message_plans.end()) {
     LOGE("undefined address %d", address);
     return {};
   }
 
-  std::vector<uint8_t> ret(msg_it->second->size, 0);
+  std::vector<uint8_t> ret(msg_it->second.size, 0);
 
   // set all values for all given signal/value pairs
   bool counter_set = false;
@@ -58,12 +71,7 @@ std::vector<uint8_t> CANPacker::pack(uint32_t address, const std::vector<SignalP
       continue;
     }
     const auto &sig = sig_it->second;
-
-    int64_t ival = (int64_t)(round((sigval.value - sig.offset) / sig.factor));
-    if (ival < 0) {
-      ival = (1ULL << sig.size) + ival;
-    }
-    set_value(ret, sig, ival);
+    set_value(ret, sig, to_raw(sig, sigval.value));
 
     if (sigval.name == "COUNTER") {
       counters[address] = sigval.value;
@@ -71,29 +79,66 @@ std::vector<uint8_t> CANPacker::pack(uint32_t address, const std::vector<SignalP
     }
   }
 
-  // set message counter
-  auto sig_it_counter = signal_lookup.find(std::make_pair(address, "COUNTER"));
-  if (!counter_set && sig_it_counter != signal_lookup.end()) {
-    const auto& sig = sig_it_counter->second;
+  finish(msg_it->second, counter_set, ret);
+  return ret;
+}
+
+// sets the message counter, unless the caller did, and the checksum
+void CANPacker::finish(const PackPlan &plan, bool counter_set, std::vector<uint8_t> &out) {
+  if (!counter_set && plan.counter) {
+    uint32_t &counter = counters[plan.address];
+    set_value(out, *plan.counter, counter);
+    counter = (counter + 1) % (1 << plan.counter->size);
+  }
+
+  if (plan.checksum && plan.checksum->calc_checksum != nullptr) {
+    unsigned int checksum = plan.checksum->calc_checksum(plan.address, *plan.checksum, out);
+    set_value(out, *plan.checksum, checksum);
+  }
+}
+
+int CANPacker::plan(uint32_t address, const std::vector<std::string> &signal_names) {
+  auto msg_it = dbc->addr_to_msg.find(address);
+  if (msg_it == dbc->addr_to_msg.end()) {
+    LOGE("undefined address %d", address);
+    return -1;
+  }
 
-    if (counters.find(address) == counters.end()) {
-      counters[address] = 0;
+  const Msg *msg = msg_it->second;
+  PackPlan &p = plans.emplace_back(message_plans.at(address));
+  for (const auto &name : signal_names) {
+    auto it = std::find_if(msg->sigs.begin(), msg->sigs.end(), [&](const Signal &s) { return s.name == name; });
+    const Signal *sig = it != msg->sigs.end() ? &(*it) : nullptr;
+    if (!sig) {
+      LOGE("undefined signal %s - %d\n", name.c_str(), address);
+    } else if (name == "COUNTER") {
+      p.counter_idx = p.sigs.size();
     }
-    set_value(ret, sig, counters[address]);
-    counters[address] = (counters[address] + 1) % (1 << sig.size);
+    p.sigs.push_back(sig);
   }
+  return plans.size() - 1;
+}
 
-  // set message checksum
-  auto sig_it_checksum = signal_lookup.find(std::make_pair(address, "CHECKSUM"));
-  if (sig_it_checksum != signal_lookup.end()) {
-    const auto &sig = sig_it_checksum->second;
-    if (sig.calc_checksum != nullptr) {
-      unsigned int checksum = sig.calc_checksum(address, sig, ret);
-      set_value(ret, sig, checksum);
+void CANPacker::pack_plan(int handle, const double *values, std::vector<uint8_t> &out) {
+  const PackPlan &p = plans.at(handle);
+  out.assign(p.size, 0);
+  for (size_t i = 0; i < p.sigs.size(); ++i) {
+    if (p.sigs[i]) {
+      set_value(out, *p.sigs[i], to_raw(*p.sigs[i], values[i]));
     }
   }
+  if (p.counter_idx >= 0) {
+    counters[p.address] = values[p.counter_idx];
+  }
+  finish(p, p.counter_idx >= 0, out);
+}
 
-  return ret;
+void CANPacker::pack_many(const std::vector<int> &handles, const double *values, std::vector<std::vector<uint8_t>> &out) {
+  out.resize(handles.size());
+  for (size_t i = 0; i < handles.size(); ++i) {
+    pack_plan(handles[i], values, out[i]);
+    values += plans[handles[i]].sigs.size();
+  }
 }
 
 // This function has a definition in common.h and is used in PlotJuggler
@@ -2,6 +2,7 @@
 # cython: c_string_encoding=ascii, language_level=3
 
 from libc.stdint cimport uint8_t, uint32_t
+from libcpp.string cimport string
 from libcpp.vector cimport vector
 
 from .common cimport CANPacker as cpp_CANPacker
@@ -12,6 +13,7 @@ cdef class CANPacker:
   cdef:
     cpp_CANPacker *packer
     const DBC *dbc
+    list plans  # (address, number of signals) per plan handle
 
   def __init__(self, dbc_name):
     self.dbc = dbc_lookup(dbc_name)
@@ -19,6 +21,7 @@ cdef class CANPacker:
       raise RuntimeError(f"Can't lookup {dbc_name}")
 
     self.packer = new cpp_CANPacker(dbc_name)
+    self.plans = []
 
   def __dealloc__(self):
     if self.packer:
@@ -36,18 +39,49 @@ cdef class CANPacker:
 
     return self.packer.pack(addr, values_thing)
 
-  cpdef make_can_msg(self, name_or_addr, bus, values):
-    cdef uint32_t addr = 0
+  cdef uint32_t address(self, name_or_addr):
     cdef const Msg* m
     if isinstance(name_or_addr, int):
-      addr = name_or_addr
-    else:
-      try:
-        m = self.dbc.name_to_msg.at(name_or_addr.encode("utf8"))
-        addr = m.address
-      except IndexError:
-        # The C++ pack function will log an error message for invalid addresses
-        pass
+      return name_or_addr
+    try:
+      m = self.dbc.name_to_msg.at(name_or_addr.encode("utf8"))
+      return m.address
+    except IndexError:
+      # The C++ pack function will log an error message for invalid addresses
+      return 0
 
+  cpdef make_can_msg(self, name_or_addr, bus, values):
+    cdef uint32_t addr = self.address(name_or_addr)
     cdef vector[uint8_t] val = self.pack(addr, values)
     return [addr, 0, (<char *>&val[0])[:val.size()], bus]
+
+  def plan(self, name_or_addr, signal_names):
+    """Resolves a message and the signals packed into it once, returns a handle for pack_many"""
+    cdef uint32_t addr = self.address(name_or_addr)
+    cdef vector[string] names
+    for name in signal_names:
+      names.push_back(name.encode("utf8"))
+
+    handle = self.packer.plan(addr, names)
+    if handle < 0:
+      raise ValueError(f"undefined message {name_or_addr}")
+    self.plans.append((addr, len(signal_names)))
+    return handle
+
+  def pack_many(self, msgs):
+    """Packs a list of (plan, bus, values) into can messages like make_can_msg, with
+    the values in the order of the plan's signal names"""
+    cdef vector[int] handles
+    cdef vector[double] values
+    cdef vector[vector[uint8_t]] out
+    handles.reserve(len(msgs))
+
+    for handle, _, vals in msgs:
+      if len(vals) != self.plans[handle][1]:
+        raise ValueError(f"plan {handle} takes {self.plans[handle][1]} values, got {len(vals)}")
+      handles.push_back(handle)
+      for v in vals:
+        values.push_back(v)
+
+    self.packer.pack_many(handles, values.data(), out)
+    return [[self.plans[h][0], 0, (<char *>out[i].data())[:out[i].size()], bus] for i, (h, bus, _) in enumerate(msgs)]
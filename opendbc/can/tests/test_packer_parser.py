@@ -74,6 +74,30 @@ class TestCanParserPacker(unittest.TestCase):
       parser.update_strings([dat])
       self.assertEqual(parser.vl["CAN_FD_MESSAGE"]["COUNTER"], (cnt + i) % 256)
 
+  def test_pack_many(self):
+    # planned batches pack the same bytes and keep the same counters as make_can_msg
+    dbc_file = "honda_civic_touring_2016_can_generated"
+    packer, batch_packer = CANPacker(dbc_file), CANPacker(dbc_file)
+    msgs = {
+      "STEERING_CONTROL": ["STEER_TORQUE", "STEER_TORQUE_REQUEST"],
+      "ACC_HUD": ["PCM_SPEED", "PCM_GAS", "CRUISE_SPEED", "COUNTER"],
+      "LKAS_HUD": ["CAM_TEMP_HIGH", "SET_ME_X41", "NOT_A_SIGNAL"],
+    }
+    plans = {name: batch_packer.plan(name, sigs) for name, sigs in msgs.items()}
+
+    for _ in range(300):
+      batch, expected = [], []
+      for bus, (name, sigs) in enumerate(msgs.items()):
+        values = {s: random.randint(0, 100) for s in sigs}
+        batch.append((plans[name], bus, list(values.values())))
+        expected.append(packer.make_can_msg(name, bus, values))
+      self.assertEqual(batch_packer.pack_many(batch), expected)
+
+    with self.assertRaises(ValueError):
+      batch_packer.pack_many([(plans["ACC_HUD"], 0, [1])])
+    with self.assertRaises(ValueError):
+      batch_packer.plan("NOT_A_MESSAGE", [])
+
   def test_parser_can_valid(self):
     msgs = [("CAN_FD_MESSAGE", 10), ]
     packer = CANPacker(TEST_DBC)
@@ -4,6 +4,30 @@
 using namespace EKFS;
 using namespace Eigen;
 
+void Observation::clear(double t, int kind) {
+  this->t = t;
+  this->kind = kind;
+  this->z.clear();
+  this->R.clear();
+  this->extra_args.clear();
+  this->z_dims.clear();
+  this->extra_args_dims.clear();
+}
+
+void Observation::push_back(const Ref<const VectorXd> &zi, const Ref<const MatrixXdr> &Ri, const std::vector<double> &extra_argsi) {
+  assert(zi.rows() == Ri.rows());
+  assert(zi.rows() == Ri.cols());
+
+  const int dim = zi.rows();
+  this->z.insert(this->z.end(), zi.data(), zi.data() + dim);
+  const size_t R_offset = this->R.size();
+  this->R.resize(R_offset + dim * dim);
+  Map<MatrixXdr>(this->R.data() + R_offset, dim, dim) = Ri;
+  this->extra_args.insert(this->extra_args.end(), extra_argsi.begin(), extra_argsi.end());
+  this->z_dims.push_back(dim);
+  this->extra_args_dims.push_back(extra_argsi.size());
+}
+
 EKFSym::EKFSym(std::string name, Map<MatrixXdr> Q, Map<VectorXd> x_initial, Map<MatrixXdr> P_initial, int dim_main,
     int dim_main_err, int N, int dim_augment, int dim_augment_err, std::vector<int> maha_test_kinds,
     std::vector<int> quaternion_idxs, std::vector<std::string> global_vars, double max_rewind_age)
@@ -39,6 +63,12 @@ EKFSym::EKFSym(std::string name, Map<MatrixXdr> Q, Map<VectorXd> x_initial, Map<
   this->Q = Q;
 
   this->max_rewind_age = max_rewind_age;
+  this->rewind_slots.resize(REWIND_TO_KEEP);
+  for (RewindSlot &slot : this->rewind_slots) {
+    slot.x.resize(this->dim_x);
+    slot.P.resize(this->dim_err, this->dim_err);
+  }
+  this->rewound_obs.resize(REWIND_TO_KEEP);
   this->init_state(x_initial, P_initial, NAN);
 }
 
@@ -50,11 +80,11 @@ void EKFSym::init_state(Map<VectorXd> state, Map<MatrixXdr> covs, double init_fi
   this->reset_rewind();
 }
 
-VectorXd EKFSym::state() {
+const VectorXd &EKFSym::state() {
   return this->x;
 }
 
-MatrixXdr EKFSym::covs() {
+const MatrixXdr &EKFSym::covs() {
   return this->P;
 }
 
@@ -80,117 +110,150 @@ void EKFSym::set_global(std::string global_var, double val) {
   this->ekf->sets.at(global_var)(val);
 }
 
-std::optional<Estimate> EKFSym::predict_and_update_batch(double t, int kind, std::vector<Map<VectorXd>> z_map,
-    std::vector<Map<MatrixXdr>> R_map, std::vector<std::vector<double>> extra_args, bool augment)
-{
+bool EKFSym::prepare_update(double t, int *rewound) {
   // TODO handle rewinding at this level
 
-  std::deque<Observation> rewound;
+  *rewound = 0;
   if (!std::isnan(this->filter_time) && t < this->filter_time) {
-    if (this->rewind_t.empty() || t < this->rewind_t.front() || t < this->rewind_t.back() - this->max_rewind_age) {
+    if (this->rewind_size == 0 || t < this->rewind_slot(0).t ||
+        t < this->rewind_slot(this->rewind_size - 1).t - this->max_rewind_age) {
       LOGD("observation too old at %f with filter at %f, ignoring!", t, this->filter_time);
-      return std::nullopt;
+      return false;
     }
-    rewound = this->rewind(t);
+    *rewound = this->rewind(t);
   }
+  return true;
+}
 
-  Observation obs;
-  obs.t = t;
-  obs.kind = kind;
-  obs.extra_args = extra_args;
-  for (Map<VectorXd> zi : z_map) {
-    obs.z.push_back(zi);
+std::optional<Estimate> EKFSym::predict_and_update_batch(double t, int kind, std::vector<Map<VectorXd>> z_map,
+    std::vector<Map<MatrixXdr>> R_map, std::vector<std::vector<double>> extra_args, bool augment)
+{
+  int rewound;
+  if (!this->prepare_update(t, &rewound)) {
+    return std::nullopt;
   }
-  for (Map<MatrixXdr> Ri : R_map) {
-    obs.R.push_back(Ri);
+
+  assert(z_map.size() == R_map.size());
+  assert(z_map.size() == extra_args.size());
+  this->new_obs.clear(t, kind);
+  for (int i = 0; i < z_map.size(); i++) {
+    this->new_obs.push_back(z_map[i], R_map[i], extra_args[i]);
   }
 
-  std::optional<Estimate> res = std::make_optional(this->predict_and_update_batch(obs, augment));
+  assert(!augment); // TODO
+  // if (augment) {
+  //   this->augment();
+  // }
+
+  Estimate res;
+  res.z.assign(z_map.begin(), z_map.end());
+  res.extra_args = extra_args;
+  this->update_batch(this->new_obs, &res);
 
   // optional fast forward
-  while (!rewound.empty()) {
-    this->predict_and_update_batch(rewound.front(), false);
-    rewound.pop_front();
+  this->fast_forward(rewound);
+  return res;
+}
+
+bool EKFSym::predict_and_update(double t, int kind, const Ref<const VectorXd> &z, const Ref<const MatrixXdr> &R,
+    const std::vector<double> &extra_args)
+{
+  int rewound;
+  if (!this->prepare_update(t, &rewound)) {
+    return false;
   }
 
-  return res;
+  this->new_obs.clear(t, kind);
+  this->new_obs.push_back(z, R, extra_args);
+  this->update_batch(this->new_obs, nullptr);
+
+  this->fast_forward(rewound);
+  return true;
 }
 
 void EKFSym::reset_rewind() {
-  this->rewind_obscache.clear();
-  this->rewind_t.clear();
-  this->rewind_states.clear();
+  this->rewind_head = 0;
+  this->rewind_size = 0;
+}
+
+RewindSlot &EKFSym::rewind_slot(int i) {
+  return this->rewind_slots[(this->rewind_head + i) % REWIND_TO_KEEP];
 }
 
-std::deque<Observation> EKFSym::rewind(double t) {
-  std::deque<Observation> rewound;
+int EKFSym::rewind(double t) {
+  int rewound = 0;
 
-  // rewind observations until t is after previous observation
-  while (this->rewind_t.back() > t) {
-    rewound.push_front(this->rewind_obscache.back());
-    this->rewind_t.pop_back();
-    this->rewind_states.pop_back();
-    this->rewind_obscache.pop_back();
+  // rewind observations until t is after previous observation. the slots' observations
+  // are swapped out, they get overwritten by the new observation's checkpoint
+  while (this->rewind_slot(this->rewind_size - 1).t > t) {
+    rewound++;
+    std::swap(this->rewound_obs[REWIND_TO_KEEP - rewound], this->rewind_slot(this->rewind_size - 1).obs);
+    this->rewind_size--;
   }
 
   // set the state to the time right before that
-  this->filter_time = this->rewind_t.back();
-  this->x = this->rewind_states.back().first;
-  this->P = this->rewind_states.back().second;
+  const RewindSlot &slot = this->rewind_slot(this->rewind_size - 1);
+  this->filter_time = slot.t;
+  this->x = slot.x;
+  this->P = slot.P;
 
   return rewound;
 }
 
-void EKFSym::checkpoint(Observation& obs) {
-  // push to rewinder
-  this->rewind_t.push_back(this->filter_time);
-  this->rewind_states.push_back(std::make_pair(this->x, this->P));
-  this->rewind_obscache.push_back(obs);
-
-  // only keep a certain number around
-  if (this->rewind_t.size() > REWIND_TO_KEEP) {
-    this->rewind_t.pop_front();
-    this->rewind_states.pop_front();
-    this->rewind_obscache.pop_front();
+void EKFSym::fast_forward(int rewound) {
+  for (int i = REWIND_TO_KEEP - rewound; i < REWIND_TO_KEEP; i++) {
+    this->update_batch(this->rewound_obs[i], nullptr);
   }
 }
 
-Estimate EKFSym::predict_and_update_batch(Observation& obs, bool augment) {
-  assert(obs.z.size() == obs.R.size());
-  assert(obs.z.size() == obs.extra_args.size());
+void EKFSym::checkpoint(const Observation &obs) {
+  // push to rewinder, only keep a certain number around
+  if (this->rewind_size == REWIND_TO_KEEP) {
+    this->rewind_head = (this->rewind_head + 1) % REWIND_TO_KEEP;
+    this->rewind_size--;
+  }
 
+  RewindSlot &slot = this->rewind_slot(this->rewind_size++);
+  slot.t = this->filter_time;
+  slot.x = this->x;
+  slot.P = this->P;
+  slot.obs = obs;
+}
+
+void EKFSym::update_batch(const Observation &obs, Estimate *res) {
   this->predict(obs.t);
 
-  Estimate res;
-  res.t = obs.t;
-  res.kind = obs.kind;
-  res.z = obs.z;
-  res.extra_args = obs.extra_args;
-  res.xk1 = this->x;
-  res.Pk1 = this->P;
+  if (res) {
+    res->t = obs.t;
+    res->kind = obs.kind;
+    res->xk1 = this->x;
+    res->Pk1 = this->P;
+  }
 
   // update batch
-  std::vector<VectorXd> y;
-  for (int i = 0; i < obs.z.size(); i++) {
-    assert(obs.z[i].rows() == obs.R[i].rows());
-    assert(obs.z[i].rows() == obs.R[i].cols());
+  const bool feature_track = this->msckf && std::find(this->feature_track_kinds.begin(),
+      this->feature_track_kinds.end(), obs.kind) != this->feature_track_kinds.end();
+  const double *z = obs.z.data(), *R = obs.R.data(), *extra_args = obs.extra_args.data();
+  for (int i = 0; i < obs.size(); i++) {
+    const int z_dim = obs.z_dims[i], extra_args_dim = obs.extra_args_dims[i];
 
     // update state
-    y.push_back(this->update(obs.kind, obs.z[i], obs.R[i], obs.extra_args[i]));
-  }
+    const double *y = this->update(obs.kind, z, z_dim, R, extra_args);
+    if (res) {
+      res->y.push_back(Map<const VectorXd>(y, feature_track ? z_dim - extra_args_dim : z_dim));
+    }
 
-  res.xk = this->x;
-  res.Pk = this->P;
-  res.y = y;
+    z += z_dim;
+    R += z_dim * z_dim;
+    extra_args += extra_args_dim;
+  }
 
-  assert(!augment); // TODO
-  // if (augment) {
-  //   this->augment();
-  // }
+  if (res) {
+    res->xk = this->x;
+    res->Pk = this->P;
+  }
 
   this->checkpoint(obs);
-
-  return res;
 }
 
 void EKFSym::predict(double t) {
@@ -208,14 +271,12 @@ void EKFSym::predict(double t) {
   this->filter_time = t;
 }
 
-VectorXd EKFSym::update(int kind, VectorXd z, MatrixXdr R, std::vector<double> extra_args) {
-  this->ekf->updates.at(kind)(this->x.data(), this->P.data(), z.data(), R.data(), extra_args.data());
+const double *EKFSym::update(int kind, const double *z, int z_dim, const double *R, const double *extra_args) {
+  // the generated update overwrites z with the innovation
+  this->z_scratch.assign(z, z + z_dim);
+  this->ekf->updates.at(kind)(this->x.data(), this->P.data(), this->z_scratch.data(), (double *)R, (double *)extra_args);
   this->normalize_quaternions();
-
-  if (this->msckf && std::find(this->feature_track_kinds.begin(), this->feature_track_kinds.end(), kind) != this->feature_track_kinds.end()) {
-    return z.head(z.rows() - extra_args.size());
-  }
-  return z;
+  return this->z_scratch.data();
 }
 
 extra_routine_t EKFSym::get_extra_routine(const std::string& routine) {
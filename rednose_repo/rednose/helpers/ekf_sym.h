@@ -4,7 +4,6 @@
 #include <cassert>
 #include <string>
 #include <vector>
-#include <deque>
 #include <unordered_map>
 #include <map>
 #include <cmath>
@@ -21,14 +20,30 @@ namespace EKFS {
 
 typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> MatrixXdr;
 
+// Observation stores all measurements of a batch in flat buffers. Storing an observation
+// into one that previously held one of the same shape reuses its capacity, so once
+// warmed up the rewind buffer doesn't allocate.
 typedef struct Observation {
   double t;
   int kind;
-  std::vector<Eigen::VectorXd> z;
-  std::vector<MatrixXdr> R;
-  std::vector<std::vector<double>> extra_args;
+  std::vector<double> z;
+  std::vector<double> R;
+  std::vector<double> extra_args;
+  std::vector<int> z_dims;
+  std::vector<int> extra_args_dims;
+
+  void clear(double t, int kind);
+  void push_back(const Eigen::Ref<const Eigen::VectorXd> &zi, const Eigen::Ref<const MatrixXdr> &Ri, const std::vector<double> &extra_argsi);
+  inline int size() const { return z_dims.size(); }
 } Observation;
 
+typedef struct RewindSlot {
+  double t;
+  Eigen::VectorXd x;
+  MatrixXdr P;
+  Observation obs;
+} RewindSlot;
+
 typedef struct Estimate {
   Eigen::VectorXd xk1;
   Eigen::VectorXd xk;
@@ -50,8 +65,8 @@ public:
       std::vector<std::string> global_vars = std::vector<std::string>(), double max_rewind_age = 1.0);
   void init_state(Eigen::Map<Eigen::VectorXd> state, Eigen::Map<MatrixXdr> covs, double filter_time);
 
-  Eigen::VectorXd state();
-  MatrixXdr covs();
+  const Eigen::VectorXd &state();
+  const MatrixXdr &covs();
   void set_filter_time(double t);
   double get_filter_time();
   void normalize_quaternions();
@@ -62,15 +77,21 @@ public:
   void predict(double t);
   std::optional<Estimate> predict_and_update_batch(double t, int kind, std::vector<Eigen::Map<Eigen::VectorXd>> z,
       std::vector<Eigen::Map<MatrixXdr>> R, std::vector<std::vector<double>> extra_args = {{}}, bool augment = false);
+  // single measurement update that doesn't build an Estimate and doesn't allocate
+  bool predict_and_update(double t, int kind, const Eigen::Ref<const Eigen::VectorXd> &z,
+      const Eigen::Ref<const MatrixXdr> &R, const std::vector<double> &extra_args = {});
 
   extra_routine_t get_extra_routine(const std::string& routine);
 
 private:
-  std::deque<Observation> rewind(double t);
-  void checkpoint(Observation& obs);
+  bool prepare_update(double t, int *rewound);
+  int rewind(double t);
+  void fast_forward(int rewound);
+  void checkpoint(const Observation &obs);
+  RewindSlot &rewind_slot(int i);
 
-  Estimate predict_and_update_batch(Observation& obs, bool augment);
-  Eigen::VectorXd update(int kind, Eigen::VectorXd z, MatrixXdr R, std::vector<double> extra_args);
+  void update_batch(const Observation &obs, Estimate *res);
+  const double *update(int kind, const double *z, int z_dim, const double *R, const double *extra_args);
 
   // stuct with linked sympy generated functions
   const EKF *ekf = NULL;
@@ -99,11 +120,14 @@ private:
   // process noise
   MatrixXdr Q;
 
-  // rewind stuff
+  // rewind stuff, a ring buffer of REWIND_TO_KEEP preallocated slots
   double max_rewind_age;
-  std::deque<double> rewind_t;
-  std::deque<std::pair<Eigen::VectorXd, MatrixXdr>> rewind_states;
-  std::deque<Observation> rewind_obscache;
+  std::vector<RewindSlot> rewind_slots;
+  int rewind_head = 0;  // oldest slot
+  int rewind_size = 0;
+  std::vector<Observation> rewound_obs;  // observations to replay after a rewind
+  Observation new_obs;
+  std::vector<double> z_scratch;  // updates write the innovation into z
 
   Eigen::VectorXd augment_times;
 
@@ -239,6 +239,7 @@ OmxEncoder::OmxEncoder(const char* path, int width, int height, int fps, int bit
   OMX_CHECK(OMX_SetParameter(handle, OMX_IndexParamPortDefinition, (OMX_PTR) &in_port));
   OMX_CHECK(OMX_GetParameter(handle, OMX_IndexParamPortDefinition, (OMX_PTR) &in_port));
   in_buf_headers.resize(in_port.nBufferCountActual);
+  assert(in_buf_headers.size() <= free_in.capacity());
 
   // setup output port
   OMX_PARAM_PORTDEFINITIONTYPE out_port;
@@ -276,6 +277,7 @@ OmxEncoder::OmxEncoder(const char* path, int width, int height, int fps, int bit
   }
 
   out_buf_headers.resize(out_port.nBufferCountActual);
+  assert(out_buf_headers.size() <= done_out.capacity());
 
   OMX_VIDEO_PARAM_BITRATETYPE bitrate_type = {0};
   bitrate_type.nSize = sizeof(bitrate_type);
@@ -401,7 +403,7 @@ void OmxEncoder::handle_out_buf(OmxEncoder *encoder, OMX_BUFFERHEADERTYPE *out_b
   OMX_CHECK(OMX_FillThisBuffer(encoder->handle, out_buf));
 }
 
-int OmxEncoder::encode_frame_rgba(const uint8_t *ptr, int in_width, int in_height, uint64_t ts) {
+int OmxEncoder::encode_frame_argb(const uint8_t *ptr, int in_width, int in_height, uint64_t ts) {
   if (!is_open) {
     return -1;
   }
@@ -424,7 +426,8 @@ int OmxEncoder::encode_frame_rgba(const uint8_t *ptr, int in_width, int in_heigh
   int in_uv_stride = VENUS_UV_STRIDE(COLOR_FMT_NV12, width);
   uint8_t *in_uv_ptr = in_buf_ptr + (in_y_stride * VENUS_Y_SCANLINES(COLOR_FMT_NV12, height));
 
-  int err = ABGRToNV12(ptr, width * 4, in_y_ptr, in_y_stride, in_uv_ptr, in_uv_stride, width, height);
+  // converts straight into the encoder's input buffer
+  int err = ARGBToNV12(ptr, width * 4, in_y_ptr, in_y_stride, in_uv_ptr, in_uv_stride, width, height);
   assert(err == 0);
 
   in_buf->nFilledLen = VENUS_BUFFER_SIZE(COLOR_FMT_NV12, width, height);
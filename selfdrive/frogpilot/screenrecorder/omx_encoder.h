@@ -18,7 +18,7 @@ public:
   OmxEncoder(const char* path, int width, int height, int fps, int bitrate);
   ~OmxEncoder();
 
-  int encode_frame_rgba(const uint8_t *ptr, int in_width, int in_height, uint64_t ts);
+  int encode_frame_argb(const uint8_t *ptr, int in_width, int in_height, uint64_t ts);
   void encoder_open(const char* filename);
   void encoder_close();
 
@@ -59,8 +59,9 @@ private:
 
   uint64_t last_t;
 
-  SafeQueue<OMX_BUFFERHEADERTYPE *> free_in;
-  SafeQueue<OMX_BUFFERHEADERTYPE *> done_out;
+  // filled from the OMX callback threads, so sized for every buffer the component owns
+  MpscQueue<OMX_BUFFERHEADERTYPE *, 32> free_in;
+  MpscQueue<OMX_BUFFERHEADERTYPE *, 32> done_out;
 
   AVFormatContext *ofmt_ctx;
   AVStream *out_stream;
@@ -16,7 +16,11 @@ ScreenRecorder::ScreenRecorder(QWidget *parent) : QPushButton(parent) {
 
   encoder = std::make_unique<OmxEncoder>(RECORDINGS_FOLDER.path().toStdString().c_str(), SCREEN_WIDTH, SCREEN_HEIGHT, UI_FREQ * 2, 12 * 1024 * 1024);
 
-  rgbScaleBuffer.resize(SCREEN_WIDTH * SCREEN_HEIGHT * 4);
+  blendBuffer.resize(SCREEN_WIDTH * SCREEN_HEIGHT * 4);
+  for (int i = 0; i < IMAGE_POOL_SIZE; ++i) {
+    // opaque, so premultiplied is plain ARGB. it's also the format QPainter is fastest with
+    freeImages.try_push(QImage(SCREEN_WIDTH, SCREEN_HEIGHT, QImage::Format_ARGB32_Premultiplied));
+  }
 
   rootWidget = topWidget(this);
 
@@ -40,8 +44,13 @@ void ScreenRecorder::updateState() {
     return;
   }
 
-  if (frameCount % 2 == 0) {
-    imageQueue.push(rootWidget->grab().toImage());
+  // drop the frame rather than block the UI when the encoder falls behind
+  QImage image;
+  if (frameCount % 2 == 0 && freeImages.try_pop(image)) {
+    // recycled images still hold an older frame where the widgets don't paint
+    image.fill(Qt::black);
+    rootWidget->render(&image);
+    imageQueue.try_push(std::move(image));
   }
 
   frameCount += 1;
@@ -73,21 +82,9 @@ void ScreenRecorder::stopRecording() {
   encoder->encoder_close();
 }
 
-QImage ScreenRecorder::synthesizeFrame(const QImage &frame1, const QImage &frame2, double alpha) {
-  QImage blended(frame1.size(), frame1.format());
-
-  const uint8_t *bits1 = frame1.constBits();
-  const uint8_t *bits2 = frame2.constBits();
-
-  uint8_t *blendedBits = blended.bits();
-
-  int numPixels = frame1.width() * frame1.height();
-
-  for (int i = 0; i < numPixels * 4; ++i) {
-    blendedBits[i] = bits1[i] * (1.0 - alpha) + bits2[i] * alpha;
-  }
-
-  return blended;
+void ScreenRecorder::synthesizeFrame(const QImage &frame1, const QImage &frame2, double alpha) {
+  ARGBInterpolate(frame1.constBits(), frame1.bytesPerLine(), frame2.constBits(), frame2.bytesPerLine(),
+                  blendBuffer.data(), SCREEN_WIDTH * 4, SCREEN_WIDTH, SCREEN_HEIGHT, std::clamp((int)(alpha * 256), 0, 255));
 }
 
 void ScreenRecorder::encodeImage() {
@@ -101,26 +98,32 @@ void ScreenRecorder::encodeImage() {
     QImage image;
 
     if (imageQueue.pop_wait_for(image, std::chrono::milliseconds(1000 / UI_FREQ))) {
-      image = image.convertToFormat(QImage::Format_RGBA8888);
-
       if (!previousImage.isNull()) {
         double alpha = std::clamp((currentTimestamp - previousTimestamp) / (1000.0 / UI_FREQ), 0.0, 1.0);
 
-        QImage syntheticImage = synthesizeFrame(previousImage, image, alpha);
+        synthesizeFrame(previousImage, image, alpha);
+        encoder->encode_frame_argb(blendBuffer.data(), SCREEN_WIDTH, SCREEN_HEIGHT, (previousTimestamp + currentTimestamp) / 2);
 
-        std::copy(syntheticImage.bits(), syntheticImage.bits() + SCREEN_WIDTH * SCREEN_HEIGHT * 4, rgbScaleBuffer.data());
-        encoder->encode_frame_rgba(rgbScaleBuffer.data(), SCREEN_WIDTH, SCREEN_HEIGHT, (previousTimestamp + currentTimestamp) / 2);
+        freeImages.try_push(std::move(previousImage));
       }
 
-      std::copy(image.bits(), image.bits() + SCREEN_WIDTH * SCREEN_HEIGHT * 4, rgbScaleBuffer.data());
-      encoder->encode_frame_rgba(rgbScaleBuffer.data(), SCREEN_WIDTH, SCREEN_HEIGHT, currentTimestamp);
+      encoder->encode_frame_argb(image.constBits(), SCREEN_WIDTH, SCREEN_HEIGHT, currentTimestamp);
 
-      previousImage = image;
+      previousImage = std::move(image);
       previousTimestamp = currentTimestamp;
     }
 
     std::this_thread::yield();
   }
+
+  // hand every image back to the pool for the next recording
+  if (!previousImage.isNull()) {
+    freeImages.try_push(std::move(previousImage));
+  }
+  QImage image;
+  while (imageQueue.try_pop(image)) {
+    freeImages.try_push(std::move(image));
+  }
 }
 
 void ScreenRecorder::paintEvent(QPaintEvent *event) {
@@ -35,15 +35,19 @@ private:
 
   std::unique_ptr<OmxEncoder> encoder;
 
-  std::vector<uint8_t> rgbScaleBuffer;
+  std::vector<uint8_t> blendBuffer;
 
-  BlockingQueue<QImage> imageQueue{UI_FREQ};
+  // Frames are rendered into a small pool of recycled images, so capturing doesn't
+  // allocate or convert on the UI thread
+  static constexpr int IMAGE_POOL_SIZE = 4;
+  BlockingQueue<QImage> freeImages{IMAGE_POOL_SIZE};
+  BlockingQueue<QImage> imageQueue{IMAGE_POOL_SIZE};
 
   QColor blackColor(int alpha = 255) { return QColor(0, 0, 0, alpha); }
   QColor redColor(int alpha = 255) { return QColor(201, 34, 49, alpha); }
   QColor whiteColor(int alpha = 255) { return QColor(255, 255, 255, alpha); }
 
-  QImage synthesizeFrame(const QImage &frame1, const QImage &frame2, double alpha);
+  void synthesizeFrame(const QImage &frame1, const QImage &frame2, double alpha);
 
   QWidget *rootWidget;
 };
@@ -259,13 +259,13 @@ void Localizer::handle_sensor(double current_time, const cereal::SensorEventData
     auto v = log.getGyroUncalibrated().getV();
     auto meas = Vector3d(-v[2], -v[1], -v[0]);
 
-    VectorXd gyro_bias = this->kf->get_x().segment<STATE_GYRO_BIAS_LEN>(STATE_GYRO_BIAS_START);
+    Vector3d gyro_bias = this->kf->get_x().segment<STATE_GYRO_BIAS_LEN>(STATE_GYRO_BIAS_START);
     float gyro_camodo_yawrate_err = std::abs((meas[2] - gyro_bias[2]) - this->camodo_yawrate_distribution[0]);
     float gyro_camodo_yawrate_err_threshold = YAWRATE_CROSS_ERR_CHECK_FACTOR * this->camodo_yawrate_distribution[1];
     bool gyro_valid = gyro_camodo_yawrate_err < gyro_camodo_yawrate_err_threshold;
 
     if ((meas.norm() < ROTATION_SANITY_CHECK) && gyro_valid) {
-      this->kf->predict_and_observe(sensor_time, OBSERVATION_PHONE_GYRO, { meas });
+      this->kf->observe(sensor_time, OBSERVATION_PHONE_GYRO, meas);
       this->observation_values_invalid["gyroscope"] *= DECAY;
     } else {
       this->observation_values_invalid["gyroscope"] += 1.0;
@@ -283,7 +283,7 @@ void Localizer::handle_sensor(double current_time, const cereal::SensorEventData
 
     auto meas = Vector3d(-v[2], -v[1], -v[0]);
     if (meas.norm() < ACCEL_SANITY_CHECK) {
-      this->kf->predict_and_observe(sensor_time, OBSERVATION_PHONE_ACCEL, { meas });
+      this->kf->observe(sensor_time, OBSERVATION_PHONE_ACCEL, meas);
       this->observation_values_invalid["accelerometer"] *= DECAY;
     } else {
       this->observation_values_invalid["accelerometer"] += 1.0;
@@ -303,8 +303,8 @@ void Localizer::input_fake_gps_observations(double current_time) {
   const MatrixXdr &ecef_pos_R = this->kf->get_fake_gps_pos_cov();
   const MatrixXdr &ecef_vel_R = this->kf->get_fake_gps_vel_cov();
 
-  this->kf->predict_and_observe(current_time, OBSERVATION_ECEF_POS, { ecef_pos }, { ecef_pos_R });
-  this->kf->predict_and_observe(current_time, OBSERVATION_ECEF_VEL, { ecef_vel }, { ecef_vel_R });
+  this->kf->observe(current_time, OBSERVATION_ECEF_POS, ecef_pos, ecef_pos_R);
+  this->kf->observe(current_time, OBSERVATION_ECEF_VEL, ecef_vel, ecef_vel_R);
 }
 
 void Localizer::handle_gps(double current_time, const cereal::GpsLocationData::Reader& log, const double sensor_time_offset) {
@@ -352,15 +352,15 @@ void Localizer::handle_gps(double current_time, const cereal::GpsLocationData::R
   if (ecef_vel.norm() > 5.0 && orientation_error.norm() > 1.0) {
     LOGE("Locationd vs ubloxLocation orientation difference too large, kalman reset");
     this->reset_kalman(NAN, initial_pose_ecef_quat, ecef_pos, ecef_vel, ecef_pos_R, ecef_vel_R);
-    this->kf->predict_and_observe(sensor_time, OBSERVATION_ECEF_ORIENTATION_FROM_GPS, { initial_pose_ecef_quat });
+    this->kf->observe(sensor_time, OBSERVATION_ECEF_ORIENTATION_FROM_GPS, initial_pose_ecef_quat);
   } else if (gps_est_error > 100.0) {
     LOGE("Locationd vs ubloxLocation position difference too large, kalman reset");
     this->reset_kalman(NAN, initial_pose_ecef_quat, ecef_pos, ecef_vel, ecef_pos_R, ecef_vel_R);
   }
 
   this->last_gps_msg = sensor_time;
-  this->kf->predict_and_observe(sensor_time, OBSERVATION_ECEF_POS, { ecef_pos }, { ecef_pos_R });
-  this->kf->predict_and_observe(sensor_time, OBSERVATION_ECEF_VEL, { ecef_vel }, { ecef_vel_R });
+  this->kf->observe(sensor_time, OBSERVATION_ECEF_POS, ecef_pos, ecef_pos_R);
+  this->kf->observe(sensor_time, OBSERVATION_ECEF_VEL, ecef_vel, ecef_vel_R);
 }
 
 void Localizer::handle_gnss(double current_time, const cereal::GnssMeasurements::Reader& log) {
@@ -430,22 +430,22 @@ void Localizer::handle_gnss(double current_time, const cereal::GnssMeasurements:
   } else if (orientation_reset_count > GPS_ORIENTATION_ERROR_RESET_CNT) {
     LOGE("Locationd vs gnssMeasurement orientation difference too large, kalman reset");
     this->reset_kalman(NAN, initial_pose_ecef_quat, ecef_pos, ecef_vel, ecef_pos_R, ecef_vel_R);
-    this->kf->predict_and_observe(sensor_time, OBSERVATION_ECEF_ORIENTATION_FROM_GPS, { initial_pose_ecef_quat });
+    this->kf->observe(sensor_time, OBSERVATION_ECEF_ORIENTATION_FROM_GPS, initial_pose_ecef_quat);
     this->orientation_reset_count = 0;
   }
 
   this->gps_mode = true;
   this->last_gps_msg = sensor_time;
-  this->kf->predict_and_observe(sensor_time, OBSERVATION_ECEF_POS, { ecef_pos }, { ecef_pos_R });
-  this->kf->predict_and_observe(sensor_time, OBSERVATION_ECEF_VEL, { ecef_vel }, { ecef_vel_R });
+  this->kf->observe(sensor_time, OBSERVATION_ECEF_POS, ecef_pos, ecef_pos_R);
+  this->kf->observe(sensor_time, OBSERVATION_ECEF_VEL, ecef_vel, ecef_vel_R);
 }
 
 void Localizer::handle_car_state(double current_time, const cereal::CarState::Reader& log) {
   this->car_speed = std::abs(log.getVEgo());
   this->standstill = log.getStandstill();
   if (this->standstill) {
-    this->kf->predict_and_observe(current_time, OBSERVATION_NO_ROT, { Vector3d(0.0, 0.0, 0.0) });
-    this->kf->predict_and_observe(current_time, OBSERVATION_NO_ACCEL, { Vector3d(0.0, 0.0, 0.0) });
+    this->kf->observe(current_time, OBSERVATION_NO_ROT, Vector3d(0.0, 0.0, 0.0));
+    this->kf->observe(current_time, OBSERVATION_NO_ACCEL, Vector3d(0.0, 0.0, 0.0));
   }
 }
 
@@ -484,10 +484,10 @@ void Localizer::handle_cam_odo(double current_time, const cereal::CameraOdometry
   rot_calib_std *= 10.0;
   MatrixXdr rot_device_cov = rotate_std(this->device_from_calib, rot_calib_std).array().square().matrix().asDiagonal();
   MatrixXdr trans_device_cov = rotate_std(this->device_from_calib, trans_calib_std).array().square().matrix().asDiagonal();
-  this->kf->predict_and_observe(current_time, OBSERVATION_CAMERA_ODO_ROTATION,
-    { rot_device }, { rot_device_cov });
-  this->kf->predict_and_observe(current_time, OBSERVATION_CAMERA_ODO_TRANSLATION,
-    { trans_device }, { trans_device_cov });
+  this->kf->observe(current_time, OBSERVATION_CAMERA_ODO_ROTATION,
+    rot_device, rot_device_cov);
+  this->kf->observe(current_time, OBSERVATION_CAMERA_ODO_TRANSLATION,
+    trans_device, trans_device_cov);
   this->observation_values_invalid["cameraOdometry"] *= DECAY;
   this->camodo_yawrate_distribution = Vector2d(rot_device[2], rotate_std(this->device_from_calib, rot_calib_std)[2]);
 }
@@ -527,6 +527,12 @@ void Localizer::finite_check(double current_time) {
   }
 }
 
+void Localizer::update_time_to_first_fix(double current_time, bool gpsOK) {
+  if (gpsOK && std::isnan(this->ttff) && !std::isnan(this->first_valid_log_time)) {
+    this->ttff = std::max(1e-3, current_time - this->first_valid_log_time);
+  }
+}
+
 void Localizer::time_check(double current_time) {
   if (std::isnan(this->last_reset_time)) {
     this->last_reset_time = current_time;
@@ -721,10 +727,7 @@ int Localizer::locationd_thread() {
       bool gpsOK = this->is_gps_ok();
       bool sensorsOK = sm.allAliveAndValid({"accelerometer", "gyroscope"});
 
-      // Log time to first fix
-      if (gpsOK && std::isnan(this->ttff) && !std::isnan(this->first_valid_log_time)) {
-        this->ttff = std::max(1e-3, (sm[trigger_msg].getLogMonoTime() * 1e-9) - this->first_valid_log_time);
-      }
+      this->update_time_to_first_fix(sm[trigger_msg].getLogMonoTime() * 1e-9, gpsOK);
 
       MessageBuilder msg_builder;
       kj::ArrayPtr<capnp::byte> bytes = this->get_message_bytes(msg_builder, inputsOK, sensorsOK, gpsOK, filterInitialized);
@@ -741,10 +744,3 @@ int Localizer::locationd_thread() {
   }
   return 0;
 }
-
-int main() {
-  util::set_realtime_priority(5);
-
-  Localizer localizer;
-  return localizer.locationd_thread();
-}
@@ -44,6 +44,7 @@ public:
   void determine_gps_mode(double current_time);
   bool are_inputs_ok();
   void observation_timings_invalid_reset();
+  void update_time_to_first_fix(double current_time, bool gpsOK);
 
   kj::ArrayPtr<capnp::byte> get_message_bytes(MessageBuilder& msg_builder,
     bool inputsOK, bool sensorsOK, bool gpsOK, bool msgValid);
@@ -63,6 +64,7 @@ public:
   void handle_live_calib(double current_time, const cereal::LiveCalibrationData::Reader& log);
 
   void input_fake_gps_observations(double current_time);
+  void configure_gnss_source(const LocalizerGnssSource &source);
 
 private:
   std::unique_ptr<LiveKalman> kf;
@@ -95,6 +97,4 @@ private:
   float gps_vertical_variance_factor;
   double gps_time_offset;
   Eigen::VectorXd camodo_yawrate_distribution = Eigen::Vector2d(0.0, 10.0); // mean, std
-
-  void configure_gnss_source(const LocalizerGnssSource &source);
 };
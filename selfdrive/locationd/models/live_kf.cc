@@ -61,11 +61,11 @@ void LiveKalman::init_state(const VectorXd &state, double filter_time) {
   this->filter->init_state(get_mapvec(state), get_mapmat(covs), filter_time);
 }
 
-VectorXd LiveKalman::get_x() {
+const VectorXd &LiveKalman::get_x() {
   return this->filter->state();
 }
 
-MatrixXdr LiveKalman::get_P() {
+const MatrixXdr &LiveKalman::get_P() {
   return this->filter->covs();
 }
 
@@ -90,6 +90,14 @@ std::optional<Estimate> LiveKalman::predict_and_observe(double t, int kind, cons
   return r;
 }
 
+bool LiveKalman::observe(double t, int kind, const Ref<const VectorXd> &meas) {
+  return this->filter->predict_and_update(t, kind, meas, this->obs_noise.at(kind));
+}
+
+bool LiveKalman::observe(double t, int kind, const Ref<const VectorXd> &meas, const Ref<const MatrixXdr> &R) {
+  return this->filter->predict_and_update(t, kind, meas, R);
+}
+
 void LiveKalman::predict(double t) {
   this->filter->predict(t);
 }
@@ -29,12 +29,15 @@ public:
   void init_state(const Eigen::VectorXd &state, const MatrixXdr &covs, double filter_time);
   void init_state(const Eigen::VectorXd &state, double filter_time);
 
-  Eigen::VectorXd get_x();
-  MatrixXdr get_P();
+  const Eigen::VectorXd &get_x();
+  const MatrixXdr &get_P();
   double get_filter_time();
   std::vector<MatrixXdr> get_R(int kind, int n);
 
   std::optional<Estimate> predict_and_observe(double t, int kind, const std::vector<Eigen::VectorXd> &meas, std::vector<MatrixXdr> R = {});
+  // single measurement versions of predict_and_observe that don't allocate
+  bool observe(double t, int kind, const Eigen::Ref<const Eigen::VectorXd> &meas);
+  bool observe(double t, int kind, const Eigen::Ref<const Eigen::VectorXd> &meas, const Eigen::Ref<const MatrixXdr> &R);
   std::optional<Estimate> predict_and_update_odo_speed(std::vector<Eigen::VectorXd> speed, double t, int kind);
   std::optional<Estimate> predict_and_update_odo_trans(std::vector<Eigen::VectorXd> trans, double t, int kind);
   std::optional<Estimate> predict_and_update_odo_rot(std::vector<Eigen::VectorXd> rot, double t, int kind);
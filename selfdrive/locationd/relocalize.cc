@@ -0,0 +1,283 @@
+// Offline re-localization of recorded routes.
+//
+// Streams each route's rlogs through Localizer as fast as the CPU allows, gating inputs the
+// same way locationd_thread does, and writes the resulting liveLocationKalman messages to
+// <output_dir>/<route_name>--<n>/rlog. Routes are processed in parallel on a thread pool.
+//
+// usage: relocalize [-j threads] [-o output_dir] route_path...
+//   route_path is the local route path without the segment suffix, i.e. its segments are
+//   the directories <route_path>--<n> containing an rlog, rlog.bz2 or rlog.zst
+
+#include <dirent.h>
+#include <getopt.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cereal/services.h"
+#include "selfdrive/locationd/locationd.h"
+#include "tools/replay/util.h"
+
+struct LocationdInput {
+  cereal::Event::Which which;
+  const char *name;
+};
+
+const LocationdInput LOCATIOND_INPUTS[] = {
+  {cereal::Event::GPS_LOCATION, "gpsLocation"},
+  {cereal::Event::GPS_LOCATION_EXTERNAL, "gpsLocationExternal"},
+  {cereal::Event::CAMERA_ODOMETRY, "cameraOdometry"},
+  {cereal::Event::LIVE_CALIBRATION, "liveCalibration"},
+  {cereal::Event::CAR_STATE, "carState"},
+  {cereal::Event::ACCELEROMETER, "accelerometer"},
+  {cereal::Event::GYROSCOPE, "gyroscope"},
+};
+
+// SubMaster's updated/alive/valid bookkeeping, driven by log time instead of sockets
+class LogSubMaster {
+public:
+  LogSubMaster(const std::vector<const char *> &service_list, const std::vector<const char *> &ignore_alive) {
+    for (const char *name : service_list) {
+      bool ignored = std::find_if(ignore_alive.begin(), ignore_alive.end(), [=](auto s) { return strcmp(s, name) == 0; }) != ignore_alive.end();
+      states.push_back({.name = name, .freq = services.at(name).frequency, .ignore_alive = ignored});
+    }
+  }
+
+  void update(uint64_t log_time, const char *name, bool valid) {
+    for (auto &s : states) {
+      s.updated = strcmp(s.name, name) == 0;
+      if (s.updated) {
+        s.valid = valid;
+        s.rcv_time = log_time;
+      }
+      s.alive = s.freq <= 1e-5 || (s.rcv_time > 0 && (log_time - s.rcv_time) * 1e-9 < 10.0 / s.freq);
+    }
+  }
+
+  bool allValid() const {
+    return std::all_of(states.begin(), states.end(), [](auto &s) { return s.valid; });
+  }
+
+  bool allAliveAndValid(const std::vector<const char *> &service_list = {}) const {
+    for (auto &s : states) {
+      bool listed = service_list.empty() || std::find_if(service_list.begin(), service_list.end(), [&](auto n) { return strcmp(n, s.name) == 0; }) != service_list.end();
+      if (listed && !(s.valid && (s.alive || s.ignore_alive))) return false;
+    }
+    return true;
+  }
+
+private:
+  struct State {
+    const char *name;
+    int freq;
+    bool ignore_alive;
+    bool updated = false, alive = false, valid = true;
+    uint64_t rcv_time = 0;
+  };
+  std::vector<State> states;
+};
+
+struct RouteStats {
+  std::string route;
+  int segments = 0;
+  uint64_t events = 0, outputs = 0, bytes = 0;
+  double log_seconds = 0, wall_seconds = 0;
+};
+
+static std::string read_log(const std::string &segment_path) {
+  if (std::string raw = util::read_file(segment_path + "/rlog"); !raw.empty()) {
+    return raw;
+  }
+  if (std::string in = util::read_file(segment_path + "/rlog.zst"); !in.empty()) {
+    return decompressZST(in);
+  }
+  return decompressBZ2(util::read_file(segment_path + "/rlog.bz2"));
+}
+
+static std::vector<std::string> route_segments(const std::string &route_path) {
+  const size_t pos = route_path.find_last_of('/');
+  const std::string dir = pos == std::string::npos ? "." : route_path.substr(0, pos);
+  const std::string prefix = route_path.substr(pos + 1) + "--";
+
+  std::vector<std::pair<int, std::string>> segments;
+  if (DIR *d = opendir(dir.c_str())) {
+    while (struct dirent *entry = readdir(d)) {
+      std::string name = entry->d_name;
+      if (util::starts_with(name, prefix) && name.find_first_not_of("0123456789", prefix.size()) == std::string::npos) {
+        segments.push_back({std::stoi(name.substr(prefix.size())), dir + "/" + name});
+      }
+    }
+    closedir(d);
+  }
+  std::sort(segments.begin(), segments.end());
+
+  std::vector<std::string> paths;
+  for (auto &[_, path] : segments) paths.push_back(path);
+  return paths;
+}
+
+RouteStats relocalize_route(const std::string &route_path, const std::string &output_dir) {
+  const std::string route_name = route_path.substr(route_path.find_last_of('/') + 1);
+  RouteStats stats = {.route = route_name};
+  const double start_ms = millis_since_boot();
+
+  std::unique_ptr<Localizer> localizer;
+  std::unique_ptr<LogSubMaster> sm;
+  bool filter_initialized = false;
+  uint64_t first_log_time = 0, last_log_time = 0;
+
+  for (const std::string &segment_path : route_segments(route_path)) {
+    std::string log = read_log(segment_path);
+    if (log.empty()) {
+      fprintf(stderr, "%s: no rlog, skipping\n", segment_path.c_str());
+      continue;
+    }
+
+    // index the locationd inputs and process them in log time order
+    struct Input {
+      uint64_t mono_time;
+      const char *name;
+      kj::ArrayPtr<const capnp::word> data;
+    };
+    std::vector<Input> inputs;
+    bool ublox = false;
+    kj::ArrayPtr<const capnp::word> words((const capnp::word *)log.data(), log.size() / sizeof(capnp::word));
+    try {
+      while (words.size() > 0) {
+        capnp::FlatArrayMessageReader reader(words);
+        auto event = reader.getRoot<cereal::Event>();
+        auto data = kj::arrayPtr(words.begin(), reader.getEnd());
+        words = kj::arrayPtr(reader.getEnd(), words.end());
+        for (auto &input : LOCATIOND_INPUTS) {
+          if (event.which() == input.which) {
+            inputs.push_back({event.getLogMonoTime(), input.name, data});
+            ublox |= input.which == cereal::Event::GPS_LOCATION_EXTERNAL;
+            break;
+          }
+        }
+      }
+    } catch (const kj::Exception &e) {
+      fprintf(stderr, "%s: corrupt rlog, using %zu events\n", segment_path.c_str(), inputs.size());
+    }
+    std::stable_sort(inputs.begin(), inputs.end(), [](auto &a, auto &b) { return a.mono_time < b.mono_time; });
+
+    if (!localizer) {
+      // the gnss source is decided by the first segment, like the UbloxAvailable param on device
+      const char *gps_location_socket = ublox ? "gpsLocationExternal" : "gpsLocation";
+      localizer = std::make_unique<Localizer>();
+      localizer->configure_gnss_source(ublox ? LocalizerGnssSource::UBLOX : LocalizerGnssSource::QCOM);
+      sm = std::make_unique<LogSubMaster>(std::vector<const char *>{gps_location_socket, "cameraOdometry", "liveCalibration",
+                                                                    "carState", "accelerometer", "gyroscope"},
+                                          std::vector<const char *>{gps_location_socket});
+    }
+
+    const std::string out_dir = output_dir + "/" + segment_path.substr(segment_path.find_last_of('/') + 1);
+    util::create_directories(out_dir, 0775);
+    std::ofstream out(out_dir + "/rlog", std::ios::binary);
+
+    for (const Input &input : inputs) {
+      // the other gps service isn't subscribed to
+      if (strncmp(input.name, "gps", 3) == 0 && strcmp(input.name, ublox ? "gpsLocationExternal" : "gpsLocation") != 0) {
+        continue;
+      }
+
+      capnp::FlatArrayMessageReader reader(input.data);
+      auto event = reader.getRoot<cereal::Event>();
+      sm->update(input.mono_time, input.name, event.getValid());
+      if (first_log_time == 0) first_log_time = input.mono_time;
+      last_log_time = input.mono_time;
+      stats.events++;
+
+      if (filter_initialized) {
+        localizer->observation_timings_invalid_reset();
+        if (event.getValid()) {
+          localizer->handle_msg(event);
+        }
+      } else {
+        filter_initialized = sm->allAliveAndValid();
+      }
+
+      if (strcmp(input.name, "cameraOdometry") == 0) {
+        bool inputsOK = sm->allValid() && localizer->are_inputs_ok();
+        bool gpsOK = localizer->is_gps_ok();
+        bool sensorsOK = sm->allAliveAndValid({"accelerometer", "gyroscope"});
+        localizer->update_time_to_first_fix(input.mono_time * 1e-9, gpsOK);
+
+        MessageBuilder msg;
+        localizer->get_message_bytes(msg, inputsOK, sensorsOK, gpsOK, filter_initialized);
+        msg.getRoot<cereal::Event>().setLogMonoTime(input.mono_time);
+        auto bytes = msg.toBytes();
+        out.write((const char *)bytes.begin(), bytes.size());
+        stats.outputs++;
+        stats.bytes += bytes.size();
+      }
+    }
+    stats.segments++;
+  }
+
+  stats.log_seconds = (last_log_time - first_log_time) * 1e-9;
+  stats.wall_seconds = (millis_since_boot() - start_ms) / 1000.0;
+  return stats;
+}
+
+int main(int argc, char *argv[]) {
+  int num_threads = std::thread::hardware_concurrency();
+  std::string output_dir = "relocalized";
+
+  int opt;
+  while ((opt = getopt(argc, argv, "j:o:")) != -1) {
+    switch (opt) {
+      case 'j': num_threads = std::max(1, atoi(optarg)); break;
+      case 'o': output_dir = optarg; break;
+      default:
+        fprintf(stderr, "usage: %s [-j threads] [-o output_dir] route_path...\n", argv[0]);
+        return 1;
+    }
+  }
+  std::vector<std::string> routes(argv + optind, argv + argc);
+  if (routes.empty()) {
+    fprintf(stderr, "usage: %s [-j threads] [-o output_dir] route_path...\n", argv[0]);
+    return 1;
+  }
+
+  std::mutex lock;
+  std::atomic<size_t> next_route = 0;
+  RouteStats total;
+  const double start_ms = millis_since_boot();
+  auto worker = [&]() {
+    for (size_t i = next_route++; i < routes.size(); i = next_route++) {
+      RouteStats s = relocalize_route(routes[i], output_dir);
+
+      std::lock_guard lk(lock);
+      printf("%s: %d segments, %" PRIu64 " events -> %" PRIu64 " liveLocationKalman in %.2fs (%.0f events/s, %.1fx realtime)\n",
+             s.route.c_str(), s.segments, s.events, s.outputs, s.wall_seconds,
+             s.events / std::max(s.wall_seconds, 1e-9), s.log_seconds / std::max(s.wall_seconds, 1e-9));
+      total.segments += s.segments;
+      total.events += s.events;
+      total.outputs += s.outputs;
+      total.bytes += s.bytes;
+      total.log_seconds += s.log_seconds;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < std::min<int>(num_threads, routes.size()); ++i) {
+    threads.emplace_back(worker);
+  }
+  for (auto &t : threads) t.join();
+
+  total.wall_seconds = (millis_since_boot() - start_ms) / 1000.0;
+  printf("total: %zu routes, %d segments, %" PRIu64 " events, %" PRIu64 " liveLocationKalman (%.2f MB) in %.2fs on %zu threads: "
+         "%.0f events/s, %.1fx realtime\n",
+         routes.size(), total.segments, total.events, total.outputs, total.bytes / 1e6, total.wall_seconds, threads.size(),
+         total.events / std::max(total.wall_seconds, 1e-9), total.log_seconds / std::max(total.wall_seconds, 1e-9));
+  return 0;
+}
@@ -0,0 +1,104 @@
+// Replays the IMU stream of a recorded (uncompressed) rlog through LiveKalman and reports
+// the time and heap allocations per sensor update.
+//
+// usage: bench_live_kf <rlog> [repeats]
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "cereal/messaging/messaging.h"
+#include "common/timing.h"
+#include "common/util.h"
+#include "selfdrive/locationd/models/live_kf.h"
+#include "system/sensord/sensors/constants.h"
+
+static std::atomic<uint64_t> alloc_count = 0;
+
+void *operator new(size_t size) {
+  alloc_count++;
+  if (void *p = std::malloc(size)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+struct SensorSample {
+  double t;
+  int kind;
+  Eigen::Vector3d meas;
+};
+
+std::vector<SensorSample> read_sensor_samples(const std::string &log) {
+  std::vector<SensorSample> samples;
+  kj::ArrayPtr<const capnp::word> words((const capnp::word *)log.data(), log.size() / sizeof(capnp::word));
+  while (words.size() > 0) {
+    capnp::FlatArrayMessageReader reader(words);
+    auto event = reader.getRoot<cereal::Event>();
+    words = kj::arrayPtr(reader.getEnd(), words.end());
+
+    cereal::SensorEventData::Reader sensor;
+    if (event.which() == cereal::Event::ACCELEROMETER) {
+      sensor = event.getAccelerometer();
+    } else if (event.which() == cereal::Event::GYROSCOPE) {
+      sensor = event.getGyroscope();
+    } else {
+      continue;
+    }
+
+    // same conversion as Localizer::handle_sensor
+    const double t = 1e-9 * sensor.getTimestamp();
+    if (sensor.getSensor() == SENSOR_GYRO_UNCALIBRATED && sensor.getType() == SENSOR_TYPE_GYROSCOPE_UNCALIBRATED) {
+      auto v = sensor.getGyroUncalibrated().getV();
+      samples.push_back({t, OBSERVATION_PHONE_GYRO, Eigen::Vector3d(-v[2], -v[1], -v[0])});
+    } else if (sensor.getSensor() == SENSOR_ACCELEROMETER && sensor.getType() == SENSOR_TYPE_ACCELEROMETER) {
+      auto v = sensor.getAcceleration().getV();
+      samples.push_back({t, OBSERVATION_PHONE_ACCEL, Eigen::Vector3d(-v[2], -v[1], -v[0])});
+    }
+  }
+  return samples;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <rlog> [repeats]\n", argv[0]);
+    return 1;
+  }
+  const int repeats = argc > 2 ? std::max(1, atoi(argv[2])) : 10;
+
+  std::vector<SensorSample> samples = read_sensor_samples(util::read_file(argv[1]));
+  // the first REWIND_TO_KEEP samples only warm up the filter, so there has to be more to time
+  if (samples.size() <= REWIND_TO_KEEP) {
+    fprintf(stderr, "%zu IMU samples in %s, need more than %d\n", samples.size(), argv[1], REWIND_TO_KEEP);
+    return 1;
+  }
+
+  LiveKalman kf;
+  uint64_t updates = 0, allocs = 0;
+  double total_ms = 0;
+  for (int i = 0; i < repeats; ++i) {
+    kf.init_state(kf.get_initial_x(), kf.get_initial_P(), samples[0].t);
+    // warm up the rewind buffer's observation storage
+    for (int j = 0; j < std::min<int>(samples.size(), REWIND_TO_KEEP); ++j) {
+      kf.observe(samples[j].t, samples[j].kind, samples[j].meas);
+    }
+
+    const uint64_t start_allocs = alloc_count;
+    const double start_ms = millis_since_boot();
+    for (int j = REWIND_TO_KEEP; j < samples.size(); ++j) {
+      kf.observe(samples[j].t, samples[j].kind, samples[j].meas);
+    }
+    total_ms += millis_since_boot() - start_ms;
+    allocs += alloc_count - start_allocs;
+    updates += std::max<int>(samples.size() - REWIND_TO_KEEP, 0);
+  }
+
+  printf("%zu IMU samples x %d: %.3f us/update, %.3f heap allocations/update\n",
+         samples.size(), repeats, total_ms * 1000.0 / updates, (double)allocs / updates);
+  return 0;
+}
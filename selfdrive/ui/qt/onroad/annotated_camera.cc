@@ -10,6 +10,27 @@
 #include "selfdrive/ui/qt/util.h"
 
 // Window that shows camera view and variety of info drawn on top
+const QBrush &CachedGradient::get(int h, const QGradientStops &s) {
+  if (h != height || s != stops) {
+    QLinearGradient gradient(0, h, 0, 0);
+    gradient.setStops(s);
+    brush = QBrush(gradient);
+    height = h;
+    stops = s;
+  }
+  return brush;
+}
+
+static QGradientStops fade_stops(QColor color, float alpha_0, float alpha_5, float alpha_1) {
+  QGradientStops stops;
+  const std::pair<float, float> alphas[] = {{0.0f, alpha_0}, {0.5f, alpha_5}, {1.0f, alpha_1}};
+  for (auto [pos, alpha] : alphas) {
+    color.setAlphaF(alpha);
+    stops.append({pos, color});
+  }
+  return stops;
+}
+
 AnnotatedCameraWidget::AnnotatedCameraWidget(VisionStreamType type, QWidget* parent) : fps_filter(UI_FREQ, 3, 1. / UI_FREQ), CameraWidget("camerad", type, true, parent) {
   pm = std::make_unique<PubMaster, const std::initializer_list<const char *>>({"uiDebug"});
 
@@ -124,10 +145,13 @@ void AnnotatedCameraWidget::drawHud(QPainter &p) {
   QPen pendingLimitPenColor = pendingLimitTimer.isValid() && pendingLimitTimer.elapsed() % 1000 <= 500 ? QPen(redColor(), 6) : QPen(blackColor(), 6);
 
   // Header gradient
-  QLinearGradient bg(0, UI_HEADER_HEIGHT - (UI_HEADER_HEIGHT / 2.5), 0, UI_HEADER_HEIGHT);
-  bg.setColorAt(0, QColor::fromRgbF(0, 0, 0, 0.45));
-  bg.setColorAt(1, QColor::fromRgbF(0, 0, 0, 0));
-  p.fillRect(0, 0, width(), UI_HEADER_HEIGHT, bg);
+  static const QBrush header_bg = [] {
+    QLinearGradient bg(0, UI_HEADER_HEIGHT - (UI_HEADER_HEIGHT / 2.5), 0, UI_HEADER_HEIGHT);
+    bg.setColorAt(0, QColor::fromRgbF(0, 0, 0, 0.45));
+    bg.setColorAt(1, QColor::fromRgbF(0, 0, 0, 0));
+    return QBrush(bg);
+  }();
+  p.fillRect(0, 0, width(), UI_HEADER_HEIGHT, header_bg);
 
   QString mtscSpeedStr = (mtscSpeed > 1) ? QString::number(std::nearbyint(fmin(speed, mtscSpeed))) + speedUnit : "–";
   QString newSpeedLimitStr = (unconfirmedSpeedLimit > 1) ? QString::number(std::nearbyint(unconfirmedSpeedLimit)) : "–";
@@ -473,8 +497,8 @@ void AnnotatedCameraWidget::drawLaneLines(QPainter &painter, const UIState *s, f
   }
 
   // paint path
-  QLinearGradient bg(0, height(), 0, 0);
   if (experimentalMode || scene.acceleration_path || scene.rainbow_path) {
+    QLinearGradient bg(0, height(), 0, 0);
     // The first half of track_vertices are the points for the right side of the path
     // and the indices match the positions of accel from uiPlan
     const auto &acceleration = sm["modelV2"].getModelV2().getAcceleration().getX();
@@ -518,22 +542,19 @@ void AnnotatedCameraWidget::drawLaneLines(QPainter &painter, const UIState *s, f
         i += (i + 2) < max_len ? 1 : 0;
       }
     }
+    painter.setBrush(bg);
 
   } else if (!useStockColors) {
-    QColor color = scene.path_color;
-    bg.setColorAt(0.0f, color);
-    color.setAlphaF(1.0f);
-    bg.setColorAt(0.5f, color);
-    color.setAlphaF(0.1f);
-    bg.setColorAt(1.0f, color);
+    painter.setBrush(path_gradient.get(height(), fade_stops(scene.path_color, scene.path_color.alphaF(), 1.0f, 0.1f)));
 
   } else {
-    bg.setColorAt(0.0, QColor::fromHslF(148 / 360., 0.94, 0.51, 0.4));
-    bg.setColorAt(0.5, QColor::fromHslF(112 / 360., 1.0, 0.68, 0.35));
-    bg.setColorAt(1.0, QColor::fromHslF(112 / 360., 1.0, 0.68, 0.0));
+    painter.setBrush(path_gradient.get(height(), {
+      {0.0, QColor::fromHslF(148 / 360., 0.94, 0.51, 0.4)},
+      {0.5, QColor::fromHslF(112 / 360., 1.0, 0.68, 0.35)},
+      {1.0, QColor::fromHslF(112 / 360., 1.0, 0.68, 0.0)},
+    }));
   }
 
-  painter.setBrush(bg);
   painter.drawPolygon(scene.track_vertices);
 
   if (scene.show_stopping_point && scene.red_light && scene.track_vertices.length() > 1) {
@@ -557,13 +578,7 @@ void AnnotatedCameraWidget::drawLaneLines(QPainter &painter, const UIState *s, f
 
   // Paint blindspot path
   if (scene.blind_spot_path) {
-    QLinearGradient bs(0, height(), 0, 0);
-
-    bs.setColorAt(0.0f, QColor::fromHslF(0 / 360.0f, 0.75f, 0.5f, 0.6f));
-    bs.setColorAt(0.5f, QColor::fromHslF(0 / 360.0f, 0.75f, 0.5f, 0.4f));
-    bs.setColorAt(1.0f, QColor::fromHslF(0 / 360.0f, 0.75f, 0.5f, 0.2f));
-
-    painter.setBrush(bs);
+    painter.setBrush(blind_spot_gradient.get(height(), fade_stops(QColor::fromHslF(0 / 360.0f, 0.75f, 0.5f), 0.6f, 0.4f, 0.2f)));
     if (blindSpotLeft) {
       painter.drawPolygon(scene.track_adjacent_vertices[4]);
     }
@@ -574,23 +589,14 @@ void AnnotatedCameraWidget::drawLaneLines(QPainter &painter, const UIState *s, f
 
   // Paint adjacent lane paths
   if ((scene.adjacent_path || scene.adjacent_path_metrics) && scene.lane_width_left != 0 && scene.lane_width_right != 0) {
-    QLinearGradient ap(0, height(), 0, 0);
-
-    std::function<void(float)> setAdjacentPathColors = [&](float hue) {
-      ap.setColorAt(0.0f, QColor::fromHslF(hue / 360.0f, 0.75f, 0.5f, 0.6f));
-      ap.setColorAt(0.5f, QColor::fromHslF(hue / 360.0f, 0.75f, 0.5f, 0.4f));
-      ap.setColorAt(1.0f, QColor::fromHslF(hue / 360.0f, 0.75f, 0.5f, 0.2f));
-    };
-
-    std::function<void(const QPolygonF&, float, bool)> drawAdjacentLane = [&](const QPolygonF &lane, float laneWidth, bool isBlindSpot) {
-      if (isBlindSpot) {
-        setAdjacentPathColors(0.0f);
-      } else {
-        float hue = 120.0f * (1 - fmin(fabs(laneWidth - laneDetectionWidth) / (laneDetectionWidth / 2), 1));
-        setAdjacentPathColors(hue);
+    std::function<void(const QPolygonF&, float, bool, CachedGradient&)> drawAdjacentLane = [&](const QPolygonF &lane, float laneWidth, bool isBlindSpot, CachedGradient &gradient) {
+      float hue = 0.0f;
+      if (!isBlindSpot) {
+        // whole degrees, so the cached gradient survives small changes in lane width
+        hue = std::round(120.0f * (1 - fmin(fabs(laneWidth - laneDetectionWidth) / (laneDetectionWidth / 2), 1)));
       }
 
-      painter.setBrush(ap);
+      painter.setBrush(gradient.get(height(), fade_stops(QColor::fromHslF(hue / 360.0f, 0.75f, 0.5f), 0.6f, 0.4f, 0.2f)));
       painter.drawPolygon(lane);
 
       if (scene.adjacent_path_metrics) {
@@ -603,45 +609,37 @@ void AnnotatedCameraWidget::drawLaneLines(QPainter &painter, const UIState *s, f
       }
     };
 
-    drawAdjacentLane(scene.track_adjacent_vertices[4], scene.lane_width_left, blindSpotLeft);
-    drawAdjacentLane(scene.track_adjacent_vertices[5], scene.lane_width_right, blindSpotRight);
+    drawAdjacentLane(scene.track_adjacent_vertices[4], scene.lane_width_left, blindSpotLeft, adjacent_gradients[0]);
+    drawAdjacentLane(scene.track_adjacent_vertices[5], scene.lane_width_right, blindSpotRight, adjacent_gradients[1]);
   }
 
   // Paint path edges
-  QLinearGradient pe(0, height(), 0, 0);
-
-  std::function<void(QLinearGradient&, const QColor&)> setPathEdgeColors = [&](QLinearGradient &gradient, QColor baseColor) {
-    baseColor.setAlphaF(1.0f);
-    gradient.setColorAt(0.0f, baseColor);
-    baseColor.setAlphaF(0.5f);
-    gradient.setColorAt(0.5f, baseColor);
-    baseColor.setAlphaF(0.1f);
-    gradient.setColorAt(1.0f, baseColor);
-  };
-
+  QGradientStops pe;
   if (scene.always_on_lateral_enabled) {
-    setPathEdgeColors(pe, bg_colors[STATUS_ALWAYS_ON_LATERAL_ENABLED]);
+    pe = fade_stops(bg_colors[STATUS_ALWAYS_ON_LATERAL_ENABLED], 1.0f, 0.5f, 0.1f);
   } else if (conditionalStatus == 1) {
-    setPathEdgeColors(pe, bg_colors[STATUS_CONDITIONAL_OVERRIDDEN]);
+    pe = fade_stops(bg_colors[STATUS_CONDITIONAL_OVERRIDDEN], 1.0f, 0.5f, 0.1f);
   } else if (experimentalMode) {
-    setPathEdgeColors(pe, bg_colors[STATUS_EXPERIMENTAL_MODE_ACTIVE]);
+    pe = fade_stops(bg_colors[STATUS_EXPERIMENTAL_MODE_ACTIVE], 1.0f, 0.5f, 0.1f);
   } else if (trafficMode) {
-    setPathEdgeColors(pe, bg_colors[STATUS_TRAFFIC_MODE_ACTIVE]);
+    pe = fade_stops(bg_colors[STATUS_TRAFFIC_MODE_ACTIVE], 1.0f, 0.5f, 0.1f);
   } else if (modelLength > scene.upcoming_maneuver_distance && scene.upcoming_maneuver_distance > 1) {
-    setPathEdgeColors(pe, bg_colors[STATUS_NAVIGATION_ACTIVE]);
+    pe = fade_stops(bg_colors[STATUS_NAVIGATION_ACTIVE], 1.0f, 0.5f, 0.1f);
   } else if (!useStockColors) {
-    setPathEdgeColors(pe, scene.path_edges_color);
+    pe = fade_stops(scene.path_edges_color, 1.0f, 0.5f, 0.1f);
   } else {
-    pe.setColorAt(0.0f, QColor::fromHslF(148 / 360.0f, 0.94f, 0.51f, 1.0f));
-    pe.setColorAt(0.5f, QColor::fromHslF(112 / 360.0f, 1.00f, 0.68f, 0.5f));
-    pe.setColorAt(1.0f, QColor::fromHslF(112 / 360.0f, 1.00f, 0.68f, 0.1f));
+    pe = {
+      {0.0f, QColor::fromHslF(148 / 360.0f, 0.94f, 0.51f, 1.0f)},
+      {0.5f, QColor::fromHslF(112 / 360.0f, 1.00f, 0.68f, 0.5f)},
+      {1.0f, QColor::fromHslF(112 / 360.0f, 1.00f, 0.68f, 0.1f)},
+    };
   }
 
   QPainterPath path;
   path.addPolygon(scene.track_vertices);
   path.addPolygon(scene.track_edge_vertices);
 
-  painter.setBrush(pe);
+  painter.setBrush(path_edge_gradient.get(height(), pe));
   painter.drawPath(path);
 
   painter.restore();
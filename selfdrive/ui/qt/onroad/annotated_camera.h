@@ -8,6 +8,16 @@
 
 #include "selfdrive/frogpilot/screenrecorder/screenrecorder.h"
 
+// A vertical gradient from the bottom to the top of the widget, rebuilt only when its
+// stops or the height change.
+struct CachedGradient {
+  const QBrush &get(int height, const QGradientStops &stops);
+
+  QBrush brush;
+  QGradientStops stops;
+  int height = -1;
+};
+
 class PedalIcons : public QWidget {
   Q_OBJECT
 
@@ -210,4 +220,9 @@ protected:
 
   double prev_draw_t = 0;
   FirstOrderFilter fps_filter;
+
+  CachedGradient path_gradient;
+  CachedGradient blind_spot_gradient;
+  CachedGradient adjacent_gradients[2];
+  CachedGradient path_edge_gradient;
 };
@@ -0,0 +1,140 @@
+// Replays the model and plan messages of a recorded rlog (raw, .bz2 or .zst) through the onroad
+// UI and renders the lane lines, path and lead markers into an offscreen image. Reports the
+// time per frame spent projecting the model geometry and drawing it.
+//
+// usage: ui_render_bench <rlog> [repeats]
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <QApplication>
+#include <QImage>
+#include <QPainter>
+
+#include "cereal/messaging/messaging.h"
+#include "common/timing.h"
+#include "common/util.h"
+#include "selfdrive/ui/qt/onroad/annotated_camera.h"
+#include "selfdrive/ui/qt/util.h"
+#include "selfdrive/ui/ui.h"
+#include "tools/replay/util.h"
+
+using Frame = std::vector<std::pair<std::string, cereal::Event::Reader>>;
+
+class RenderBench : public AnnotatedCameraWidget {
+public:
+  RenderBench() : AnnotatedCameraWidget(VISION_STREAM_ROAD) {}
+
+  void setup(const QSize &size) {
+    resize(size);
+    updateCalibration(DEFAULT_CALIBRATION);
+    updateFrameMat();
+  }
+
+  // same order as AnnotatedCameraWidget::paintGL
+  void renderFrame(QPainter &painter, UIState *s, double &geometry_ms, double &draw_ms) {
+    const SubMaster &sm = *(s->sm);
+    const auto model = sm["modelV2"].getModelV2();
+    const auto radar_state = sm["radarState"].getRadarState();
+    const float v_ego = sm["carState"].getCarState().getVEgo();
+
+    double t = millis_since_boot();
+    update_model(s, model, sm["uiPlan"].getUiPlan());
+    update_leads(s, radar_state, model.getPosition());
+    double t2 = millis_since_boot();
+    geometry_ms += t2 - t;
+
+    painter.setPen(Qt::NoPen);
+    drawLaneLines(painter, s, v_ego);
+    if (radar_state.getLeadOne().getStatus()) {
+      drawLead(painter, radar_state.getLeadOne(), s->scene.lead_vertices[0], v_ego, s->scene.lead_marker_color);
+    }
+    draw_ms += millis_since_boot() - t2;
+  }
+};
+
+static const char *service_name(cereal::Event::Which which) {
+  switch (which) {
+    case cereal::Event::MODEL_V2: return "modelV2";
+    case cereal::Event::UI_PLAN: return "uiPlan";
+    case cereal::Event::RADAR_STATE: return "radarState";
+    case cereal::Event::LIVE_CALIBRATION: return "liveCalibration";
+    case cereal::Event::CAR_STATE: return "carState";
+    case cereal::Event::FROGPILOT_PLAN: return "frogpilotPlan";
+    default: return nullptr;
+  }
+}
+
+// one entry per modelV2 message, together with everything the UI received since the previous one
+std::vector<Frame> read_frames(const std::string &log, std::vector<std::unique_ptr<capnp::FlatArrayMessageReader>> &readers) {
+  std::vector<Frame> frames;
+  Frame pending;
+  kj::ArrayPtr<const capnp::word> words((const capnp::word *)log.data(), log.size() / sizeof(capnp::word));
+  while (words.size() > 0) {
+    auto &reader = readers.emplace_back(std::make_unique<capnp::FlatArrayMessageReader>(words));
+    auto event = reader->getRoot<cereal::Event>();
+    words = kj::arrayPtr(reader->getEnd(), words.end());
+
+    if (const char *name = service_name(event.which())) {
+      pending.emplace_back(name, event);
+      if (event.which() == cereal::Event::MODEL_V2) {
+        frames.push_back(std::move(pending));
+        pending.clear();
+      }
+    } else {
+      readers.pop_back();
+    }
+  }
+  return frames;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <rlog> [repeats]\n", argv[0]);
+    return 1;
+  }
+  const int repeats = argc > 2 ? atoi(argv[2]) : 5;
+  setenv("QT_QPA_PLATFORM", "offscreen", 0);
+
+  const std::string file = argv[1];
+  std::string log = util::read_file(file);
+  if (util::ends_with(file, ".bz2")) {
+    log = decompressBZ2(log);
+  } else if (util::ends_with(file, ".zst")) {
+    log = decompressZST(log);
+  }
+  std::vector<std::unique_ptr<capnp::FlatArrayMessageReader>> readers;
+  std::vector<Frame> frames = read_frames(log, readers);
+  if (frames.empty()) {
+    fprintf(stderr, "no modelV2 messages in %s\n", argv[1]);
+    return 1;
+  }
+
+  initApp(argc, argv);
+  QApplication app(argc, argv);
+  UIState *s = uiState();
+
+  RenderBench widget;
+  widget.setup(QSize(2160, 1080));
+  QImage image(widget.size(), QImage::Format_ARGB32_Premultiplied);
+
+  double geometry_ms = 0, draw_ms = 0;
+  for (int i = 0; i < repeats; ++i) {
+    for (const Frame &frame : frames) {
+      s->sm->update_msgs(frame.back().second.getLogMonoTime(), frame);
+      image.fill(Qt::black);
+      QPainter painter(&image);
+      painter.setRenderHint(QPainter::Antialiasing);
+      widget.renderFrame(painter, s, geometry_ms, draw_ms);
+    }
+  }
+
+  const size_t n = frames.size() * repeats;
+  printf("%zu frames x %d: %.3f ms/frame geometry, %.3f ms/frame draw\n",
+         frames.size(), repeats, geometry_ms / n, draw_ms / n);
+  return 0;
+}
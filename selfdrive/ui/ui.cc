@@ -16,25 +16,119 @@
 #define BACKLIGHT_DT 0.05
 #define BACKLIGHT_TS 10.00
 
-// Projects a point in car to space to the corresponding point in full frame
-// image space.
-static bool calib_frame_to_full_frame(const UIState *s, float in_x, float in_y, float in_z, QPointF *out) {
+// Projection from the calibrated car frame to full frame image space: intrinsics and
+// calibration folded into one matrix, followed by the affine car_space_transform.
+// Built once per update, then applied to every point in one pass.
+struct CalibProjection {
+  float m[9];
+  float m11, m12, m21, m22, dx, dy;
+  float clip_x0, clip_y0, clip_x1, clip_y1;
+};
+
+static CalibProjection calib_projection(const UIState *s) {
   const float margin = 500.0f;
-  const QRectF clip_region{-margin, -margin, s->fb_w + 2 * margin, s->fb_h + 2 * margin};
-
-  const vec3 pt = (vec3){{in_x, in_y, in_z}};
-  const vec3 Ep = matvecmul3(s->scene.wide_cam ? s->scene.view_from_wide_calib : s->scene.view_from_calib, pt);
-  const vec3 KEp = matvecmul3(s->scene.wide_cam ? ECAM_INTRINSIC_MATRIX : FCAM_INTRINSIC_MATRIX, Ep);
+  const mat3 KE = matmul3(s->scene.wide_cam ? ECAM_INTRINSIC_MATRIX : FCAM_INTRINSIC_MATRIX,
+                          s->scene.wide_cam ? s->scene.view_from_wide_calib : s->scene.view_from_calib);
+  const QTransform &t = s->car_space_transform;
+  CalibProjection p = {
+    .m11 = (float)t.m11(), .m12 = (float)t.m12(), .m21 = (float)t.m21(), .m22 = (float)t.m22(),
+    .dx = (float)t.dx(), .dy = (float)t.dy(),
+    .clip_x0 = -margin, .clip_y0 = -margin, .clip_x1 = s->fb_w + margin, .clip_y1 = s->fb_h + margin,
+  };
+  std::copy(std::begin(KE.v), std::end(KE.v), p.m);
+  return p;
+}
 
-  // Project.
-  QPointF point = s->car_space_transform.map(QPointF{KEp.v[0] / KEp.v[2], KEp.v[1] / KEp.v[2]});
-  if (clip_region.contains(point)) {
-    *out = point;
-    return true;
+// Projects n points given as separate x/y/z arrays. valid[i] is 0 when the point lands
+// outside the clip region. The loop is branch-free so the compiler can vectorize it.
+static void project_points(const CalibProjection &p, int n, const float *x, const float *y, const float *z,
+                           float *out_x, float *out_y, uint8_t *valid) {
+  for (int i = 0; i < n; ++i) {
+    const float u = p.m[0] * x[i] + p.m[1] * y[i] + p.m[2] * z[i];
+    const float v = p.m[3] * x[i] + p.m[4] * y[i] + p.m[5] * z[i];
+    const float w = p.m[6] * x[i] + p.m[7] * y[i] + p.m[8] * z[i];
+    const float px = u / w, py = v / w;
+    const float qx = p.m11 * px + p.m21 * py + p.dx;
+    const float qy = p.m12 * px + p.m22 * py + p.dy;
+    out_x[i] = qx;
+    out_y[i] = qy;
+    valid[i] = (qx >= p.clip_x0) & (qx <= p.clip_x1) & (qy >= p.clip_y0) & (qy <= p.clip_y1);
   }
-  return false;
 }
 
+// Collects the left and right edge points of several lines, projects all of them in a
+// single pass and writes the polygons into the caller's buffers. The scratch arrays and
+// the polygons keep their capacity between updates, so steady state doesn't allocate.
+class LineProjector {
+public:
+  void add(const cereal::XYZTData::Reader &line, float y_off, float z_off, QPolygonF *pvd, int max_idx, bool allow_invert) {
+    const auto line_x = line.getX(), line_y = line.getY(), line_z = line.getZ();
+    const int begin = x.size();
+    for (int i = 0; i <= max_idx; i++) {
+      // highly negative x positions  are drawn above the frame and cause flickering, clip to zy plane of camera
+      if (line_x[i] < 0) continue;
+
+      // left and right points are interleaved
+      x.insert(x.end(), {line_x[i], line_x[i]});
+      y.insert(y.end(), {line_y[i] - y_off, line_y[i] + y_off});
+      z.insert(z.end(), {line_z[i] + z_off, line_z[i] + z_off});
+    }
+    lines.push_back({pvd, begin, (int)x.size() - begin, allow_invert});
+  }
+
+  void project(const UIState *s) {
+    const int n = x.size();
+    px.resize(n);
+    py.resize(n);
+    valid.resize(n);
+    project_points(calib_projection(s), n, x.data(), y.data(), z.data(), px.data(), py.data(), valid.data());
+
+    for (const Line &l : lines) {
+      // keep the pairs where both sides are visible
+      accepted.clear();
+      for (int i = l.begin; i < l.begin + l.count; i += 2) {
+        if (!valid[i] || !valid[i + 1]) continue;
+        // For wider lines the drawn polygon will "invert" when going over a hill and cause artifacts
+        if (!l.allow_invert && !accepted.empty() && py[i] > py[accepted.back()]) continue;
+        accepted.push_back(i);
+      }
+
+      // right side from far to near, then left side from near to far
+      const int m = accepted.size();
+      l.pvd->resize(2 * m);
+      QPointF *out = l.pvd->data();
+      for (int j = 0; j < m; ++j) {
+        const int i = accepted[j];
+        out[m + j] = QPointF(px[i], py[i]);
+        out[m - 1 - j] = QPointF(px[i + 1], py[i + 1]);
+      }
+    }
+    lines.clear();
+    x.clear();
+    y.clear();
+    z.clear();
+  }
+
+private:
+  struct Line {
+    QPolygonF *pvd;
+    int begin, count;
+    bool allow_invert;
+  };
+  std::vector<Line> lines;
+  std::vector<float> x, y, z, px, py;
+  std::vector<uint8_t> valid;
+  std::vector<int> accepted;
+};
+
+static LineProjector line_projector;
+
+// update_radar_tracks' projection buffers, which keep their capacity between updates
+static struct {
+  std::vector<float> x, y, z, px, py;
+  std::vector<uint8_t> valid;
+} track_points;
+
 int get_path_length_idx(const cereal::XYZTData::Reader &line, const float path_height) {
   const auto line_x = line.getX();
   int max_idx = 0;
@@ -55,11 +149,24 @@ void update_leads(UIState *s, const cereal::RadarState::Reader &radar_state, con
     &cereal::RadarState::Reader::getLeadRight,
   };
 
+  float x[4] = {}, y[4] = {}, z[4] = {}, px[4], py[4];
+  uint8_t status[4], valid[4];
   for (int i = 0; i < 4; ++i) {
     auto lead_data = (radar_state.*get_lead_data[i])();
-    if (lead_data.getStatus()) {
-      float z = line.getZ()[get_path_length_idx(line, lead_data.getDRel())];
-      calib_frame_to_full_frame(s, lead_data.getDRel(), -lead_data.getYRel(), z + path_offset_z, &s->scene.lead_vertices[i]);
+    status[i] = lead_data.getStatus();
+    if (status[i]) {
+      x[i] = lead_data.getDRel();
+      y[i] = -lead_data.getYRel();
+      z[i] = line.getZ()[get_path_length_idx(line, lead_data.getDRel())] + path_offset_z;
+    } else {
+      x[i] = 1;  // keep the unused lanes finite
+    }
+  }
+
+  project_points(calib_projection(s), 4, x, y, z, px, py, valid);
+  for (int i = 0; i < 4; ++i) {
+    if (status[i] && valid[i]) {
+      s->scene.lead_vertices[i] = QPointF(px[i], py[i]);
     }
   }
 }
@@ -70,47 +177,28 @@ void update_radar_tracks(UIState *s, const capnp::List<cereal::LiveTracks>::Read
   SubMaster &sm = *(s->sm);
   float path_offset_z = sm["liveCalibration"].getLiveCalibration().getHeight()[0];
 
-  std::size_t num_tracks = tracks_msg.size();
-  s->scene.live_radar_tracks.reserve(num_tracks);
-
-  for (std::size_t i = 0; i < num_tracks; i++) {
+  const int num_tracks = tracks_msg.size();
+  auto &[x, y, z, px, py, valid] = track_points;
+  for (auto v : {&x, &y, &z, &px, &py}) v->resize(num_tracks);
+  valid.resize(num_tracks);
+  for (int i = 0; i < num_tracks; i++) {
     cereal::LiveTracks::Reader track = tracks_msg[i];
+    x[i] = track.getDRel();
+    y[i] = -track.getYRel();
+    z[i] = line.getZ()[get_path_length_idx(line, x[i])] + path_offset_z;
+  }
 
-    float dRel = track.getDRel();
-    float yRel = track.getYRel();
-    float z = line.getZ()[get_path_length_idx(line, dRel)];
-
-    QPointF calibrated_point;
-    if (calib_frame_to_full_frame(s, dRel, -yRel, z + path_offset_z, &calibrated_point)) {
+  project_points(calib_projection(s), num_tracks, x.data(), y.data(), z.data(), px.data(), py.data(), valid.data());
+  s->scene.live_radar_tracks.reserve(num_tracks);
+  for (int i = 0; i < num_tracks; i++) {
+    if (valid[i]) {
       RadarTrackData t;
-      t.calibrated_point = calibrated_point;
+      t.calibrated_point = QPointF(px[i], py[i]);
       s->scene.live_radar_tracks.push_back(t);
     }
   }
 }
 
-void update_line_data(const UIState *s, const cereal::XYZTData::Reader &line,
-                      float y_off, float z_off, QPolygonF *pvd, int max_idx, bool allow_invert=true) {
-  const auto line_x = line.getX(), line_y = line.getY(), line_z = line.getZ();
-  QPointF left, right;
-  pvd->clear();
-  for (int i = 0; i <= max_idx; i++) {
-    // highly negative x positions  are drawn above the frame and cause flickering, clip to zy plane of camera
-    if (line_x[i] < 0) continue;
-
-    bool l = calib_frame_to_full_frame(s, line_x[i], line_y[i] - y_off, line_z[i] + z_off, &left);
-    bool r = calib_frame_to_full_frame(s, line_x[i], line_y[i] + y_off, line_z[i] + z_off, &right);
-    if (l && r) {
-      // For wider lines the drawn polygon will "invert" when going over a hill and cause artifacts
-      if (!allow_invert && pvd->size() && left.y() > pvd->back().y()) {
-        continue;
-      }
-      pvd->push_back(left);
-      pvd->push_front(right);
-    }
-  }
-}
-
 void update_model(UIState *s,
                   const cereal::ModelDataV2::Reader &model,
                   const cereal::UiPlan::Reader &plan) {
@@ -133,7 +221,7 @@ void update_model(UIState *s,
   int max_idx = get_path_length_idx(lane_lines[0], max_distance);
   for (int i = 0; i < std::size(scene.lane_line_vertices); i++) {
     scene.lane_line_probs[i] = lane_line_probs[i];
-    update_line_data(s, lane_lines[i], (scene.model_ui ? scene.lane_line_width : 0.025) * scene.lane_line_probs[i], 0, &scene.lane_line_vertices[i], max_idx);
+    line_projector.add(lane_lines[i], (scene.model_ui ? scene.lane_line_width : 0.025) * scene.lane_line_probs[i], 0, &scene.lane_line_vertices[i], max_idx, true);
   }
 
   // update road edges
@@ -141,12 +229,12 @@ void update_model(UIState *s,
   const auto road_edge_stds = model.getRoadEdgeStds();
   for (int i = 0; i < std::size(scene.road_edge_vertices); i++) {
     scene.road_edge_stds[i] = road_edge_stds[i];
-    update_line_data(s, road_edges[i], scene.model_ui ? scene.road_edge_width : 0.025, 0, &scene.road_edge_vertices[i], max_idx);
+    line_projector.add(road_edges[i], scene.model_ui ? scene.road_edge_width : 0.025, 0, &scene.road_edge_vertices[i], max_idx, true);
   }
 
   // Update adjacent paths
   for (int i = 4; i <= 5; i++) {
-    update_line_data(s, lane_lines[i], (i == 4 ? scene.lane_width_left : scene.lane_width_right) / 2.0f, 0, &scene.track_adjacent_vertices[i], max_idx, false);
+    line_projector.add(lane_lines[i], (i == 4 ? scene.lane_width_left : scene.lane_width_right) / 2.0f, 0, &scene.track_adjacent_vertices[i], max_idx, false);
   }
 
   // update path
@@ -177,10 +265,13 @@ void update_model(UIState *s,
     }
   }
   max_idx = get_path_length_idx(plan_position, max_distance);
-  update_line_data(s, plan_position, scene.model_ui ? path_width * (1 - (scene.path_edge_width / 100.0f)) : 0.9, path_offset_z, &scene.track_vertices, max_idx, false);
+  line_projector.add(plan_position, scene.model_ui ? path_width * (1 - (scene.path_edge_width / 100.0f)) : 0.9, path_offset_z, &scene.track_vertices, max_idx, false);
 
   // Update path edges
-  update_line_data(s, plan_position, scene.model_ui ? path_width : 0, path_offset_z, &scene.track_edge_vertices, max_idx, false);
+  line_projector.add(plan_position, scene.model_ui ? path_width : 0, path_offset_z, &scene.track_edge_vertices, max_idx, false);
+
+  // project all of the above at once
+  line_projector.project(s);
 }
 
 void update_dmonitoring(UIState *s, const cereal::DriverStateV2::Reader &driverstate, float dm_fade_state, bool is_rhd) {
@@ -315,7 +315,8 @@ public:
   QTransform car_space_transform;
 
   // FrogPilot variables
-  Params params_memory{"/dev/shm/params"};
+  // read every frame, so served from memory and invalidated via inotify
+  Params params_memory{"/dev/shm/params", true};
 
   WifiManager *wifi = nullptr;
 
@@ -385,8 +386,6 @@ void update_model(UIState *s,
                   const cereal::UiPlan::Reader &plan);
 void update_dmonitoring(UIState *s, const cereal::DriverStateV2::Reader &driverstate, float dm_fade_state, bool is_rhd);
 void update_leads(UIState *s, const cereal::RadarState::Reader &radar_state, const cereal::XYZTData::Reader &line);
-void update_line_data(const UIState *s, const cereal::XYZTData::Reader &line,
-                      float y_off, float z_off, QPolygonF *pvd, int max_idx, bool allow_invert);
 
 // FrogPilot functions
 void ui_update_frogpilot_params(UIState *s);
@@ -23,6 +23,7 @@ from typing import cast
 from collections.abc import Callable
 
 import requests
+import zstandard
 from jsonrpc import JSONRPCResponseManager, dispatcher
 from websocket import (ABNF, WebSocket, WebSocketException, WebSocketTimeoutException,
                        create_connection)
@@ -35,6 +36,7 @@ from openpilot.common.file_helpers import CallbackReader
 from openpilot.common.params import Params
 from openpilot.common.realtime import set_core_affinity
 from openpilot.system.hardware import HARDWARE, PC
+from openpilot.system.loggerd.uploader import strip_compression_extension
 from openpilot.system.loggerd.xattr_cache import getxattr, setxattr
 from openpilot.common.swaglog import cloudlog
 from openpilot.system.version import get_build_metadata
@@ -103,10 +105,10 @@ cancelled_uploads: set[str] = set()
 cur_upload_items: dict[int, UploadItem | None] = {}
 
 
-def strip_bz2_extension(fn: str) -> str:
-  if fn.endswith('.bz2'):
-    return fn[:-4]
-  return fn
+COMPRESSORS = {
+  '.bz2': bz2.compress,
+  '.zst': lambda dat: zstandard.ZstdCompressor().compress(dat),
+}
 
 
 class AbortTransferException(Exception):
@@ -283,16 +285,16 @@ def _do_upload(upload_item: UploadItem, callback: Callable = None) -> requests.R
   path = upload_item.path
   compress = False
 
-  # If file does not exist, but does exist without the .bz2 extension we will compress on the fly
-  if not os.path.exists(path) and os.path.exists(strip_bz2_extension(path)):
-    path = strip_bz2_extension(path)
+  # If file does not exist, but does exist without the .bz2 or .zst extension we will compress on the fly
+  if not os.path.exists(path) and os.path.exists(strip_compression_extension(path)):
+    path = strip_compression_extension(path)
     compress = True
 
   with open(path, "rb") as f:
     content = f.read()
     if compress:
       cloudlog.event("athena.upload_handler.compress", fn=path, fn_orig=upload_item.path)
-      content = bz2.compress(content)
+      content = COMPRESSORS[upload_item.path[len(path):]](content)
 
   with io.BytesIO(content) as data:
     return requests.put(upload_item.url,
@@ -388,7 +390,7 @@ def uploadFilesToUrls(files_data: list[UploadFileDict]) -> UploadFilesToUrlRespo
       continue
 
     path = os.path.join(Paths.log_root(), file.fn)
-    if not os.path.exists(path) and not os.path.exists(strip_bz2_extension(path)):
+    if not os.path.exists(path) and not os.path.exists(strip_compression_extension(path)):
       failed.append(file.fn)
       continue
 
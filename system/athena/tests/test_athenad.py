@@ -174,17 +174,18 @@ class TestAthenadMethods:
     assert resp, 'list empty!'
     assert len(resp) == len(expected)
 
-  def test_strip_bz2_extension(self):
-    fn = self._create_file('qlog.bz2')
-    if fn.endswith('.bz2'):
-      assert athenad.strip_bz2_extension(fn) == fn[:-4]
-
-  @pytest.mark.parametrize("compress", [True, False])
-  def test_do_upload(self, host, compress):
+  @pytest.mark.parametrize("ext", [".bz2", ".zst"])
+  def test_strip_compression_extension(self, ext):
+    fn = self._create_file('qlog' + ext)
+    assert athenad.strip_compression_extension(fn) == fn[:-4]
+    assert athenad.strip_compression_extension(fn[:-4]) == fn[:-4]
+
+  @pytest.mark.parametrize("ext", [".bz2", ".zst", ""])
+  def test_do_upload(self, host, ext):
     # random bytes to ensure rather large object post-compression
     fn = self._create_file('qlog', data=os.urandom(10000 * 1024))
 
-    upload_fn = fn + ('.bz2' if compress else '')
+    upload_fn = fn + ext
     item = athenad.UploadItem(path=upload_fn, url="http://localhost:1238", headers={}, created_at=int(time.time()*1000), id='')
     with pytest.raises(requests.exceptions.ConnectionError):
       athenad._do_upload(item)
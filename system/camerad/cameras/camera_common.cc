@@ -134,7 +134,10 @@ bool CameraBuf::acquire() {
 }
 
 void CameraBuf::queue(size_t buf_idx) {
-  safe_queue.push(buf_idx);
+  if (!safe_queue.try_push(buf_idx)) {
+    const uint32_t dropped = ++dropped_frames;
+    LOGE("processing thread is behind, dropping frame in buffer %zu (%u dropped)", buf_idx, dropped);
+  }
 }
 
 // common functions
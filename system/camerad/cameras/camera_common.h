@@ -1,6 +1,7 @@
 #pragma once
 
 #include <fcntl.h>
+#include <atomic>
 #include <memory>
 #include <thread>
 
@@ -53,7 +54,7 @@ private:
   ImgProc *imgproc = nullptr;
   VisionStreamType stream_type;
   int cur_buf_idx;
-  SafeQueue<int> safe_queue;
+  SpscQueue<int, 16> safe_queue;  // filled by the camera event thread, drained by the processing thread
   int frame_buf_count;
 
 public:
@@ -64,6 +65,7 @@ public:
   std::unique_ptr<VisionBuf[]> camera_bufs;
   std::unique_ptr<FrameMetadata[]> camera_bufs_metadata;
   int rgb_width, rgb_height;
+  std::atomic<uint32_t> dropped_frames = 0;  // frames not processed because the queue was full
 
   CameraBuf() = default;
   ~CameraBuf();
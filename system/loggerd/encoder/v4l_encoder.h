@@ -20,11 +20,12 @@ private:
   int segment_num = -1;
   int counter = 0;
 
-  SafeQueue<VisionIpcBufExtra> extras;
+  SpscQueue<VisionIpcBufExtra, 16> extras;  // one per frame between encode_frame and its output buffer
 
   static void dequeue_handler(V4LEncoder *e);
   std::thread dequeue_handler_thread;
 
   VisionBuf buf_out[BUF_OUT_COUNT];
-  SafeQueue<unsigned int> free_buf_in;
+  MpscQueue<unsigned int, 8> free_buf_in;
+  static_assert(BUF_IN_COUNT <= decltype(free_buf_in)::capacity());
 };
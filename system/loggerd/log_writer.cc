@@ -0,0 +1,198 @@
+#include "system/loggerd/log_writer.h"
+
+#include <zstd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <utility>
+
+#include "common/swaglog.h"
+#include "common/timing.h"
+#include "common/util.h"
+
+LogWriterThread::LogWriterThread(size_t max_pending_bytes) : max_pending_bytes(max_pending_bytes) {
+  thread = std::thread(&LogWriterThread::writerThread, this);
+}
+
+LogWriterThread::~LogWriterThread() {
+  {
+    std::unique_lock lk(lock);
+    exit = true;
+  }
+  work_cv.notify_one();
+  thread.join();
+}
+
+void LogWriterThread::push(Job &&job) {
+  {
+    std::unique_lock lk(lock);
+    // only writes count against the queue, the payload of the other jobs is a path
+    const bool is_write = job.type == JobType::WRITE || job.type == JobType::WRITE_ZSTD;
+    const size_t size = is_write ? job.data.size() : 0;
+    if (size > 0 && stats.pending_bytes > 0 && stats.pending_bytes + size > max_pending_bytes) {
+      // storage can't keep up: block the producer rather than dropping data
+      double start_ms = millis_since_boot();
+      space_cv.wait(lk, [&] { return stats.pending_bytes == 0 || stats.pending_bytes + size <= max_pending_bytes; });
+      stats.stalls++;
+      stats.stall_ms += millis_since_boot() - start_ms;
+    }
+    stats.pending_bytes += size;
+    stats.max_pending_bytes = std::max(stats.max_pending_bytes, stats.pending_bytes);
+    queue.push_back(std::move(job));
+  }
+  work_cv.notify_one();
+}
+
+void LogWriterThread::write(FILE *file, std::string &&chunk, bool compress, bool abort_on_error) {
+  if (!chunk.empty()) {
+    push({compress ? JobType::WRITE_ZSTD : JobType::WRITE, file, std::move(chunk), abort_on_error});
+  }
+}
+
+void LogWriterThread::close(FILE *file, bool abort_on_error) {
+  push({JobType::CLOSE, file, {}, abort_on_error});
+}
+
+void LogWriterThread::remove(const std::string &path) {
+  push({JobType::REMOVE, nullptr, path});
+}
+
+void LogWriterThread::flush() {
+  std::unique_lock lk(lock);
+  idle_cv.wait(lk, [this] { return queue.empty() && !busy; });
+}
+
+LogWriterThread::Stats LogWriterThread::getStats() {
+  std::unique_lock lk(lock);
+  return stats;
+}
+
+LogWriterThread::Stats LogWriterThread::resetStats() {
+  std::unique_lock lk(lock);
+  Stats ret = stats;
+  stats = {.pending_bytes = stats.pending_bytes, .max_pending_bytes = stats.pending_bytes};
+  return ret;
+}
+
+void LogWriterThread::writerThread() {
+  util::set_thread_name("loggerd_writer");
+  ZSTD_CCtx *cctx = ZSTD_createCCtx();
+  assert(cctx);
+
+  std::unique_lock lk(lock);
+  while (true) {
+    work_cv.wait(lk, [this] { return exit || !queue.empty(); });
+    if (queue.empty()) break;  // only exit once everything queued is on disk
+
+    Job job = std::move(queue.front());
+    queue.pop_front();
+    busy = true;
+    lk.unlock();
+
+    double start_ms = millis_since_boot();
+    size_t written = 0;
+    if (job.type == JobType::WRITE) {
+      written = writeFile(job.file, job.data.data(), job.data.size(), job.abort_on_error);
+    } else if (job.type == JobType::WRITE_ZSTD) {
+      written = writeCompressed(cctx, job.file, job.data, job.abort_on_error);
+    } else if (job.type == JobType::CLOSE) {
+      if (auto it = seek_tables.find(job.file); it != seek_tables.end()) {
+        writeSeekTable(job.file, it->second, job.abort_on_error);
+        seek_tables.erase(it);
+      }
+      util::safe_fflush(job.file);
+      int err = fclose(job.file);
+      if (err != 0) {
+        LOGE("failed to close file.errno=%d", errno);
+        assert(!job.abort_on_error);
+      }
+    } else {
+      std::remove(job.data.c_str());
+    }
+    double write_ms = millis_since_boot() - start_ms;
+
+    lk.lock();
+    busy = false;
+    if (job.type == JobType::WRITE || job.type == JobType::WRITE_ZSTD) {
+      stats.bytes_in += job.data.size();
+      stats.bytes_written += written;
+      stats.writes++;
+      stats.max_write_ms = std::max(stats.max_write_ms, write_ms);
+      stats.pending_bytes -= job.data.size();
+      space_cv.notify_all();
+    }
+    if (queue.empty()) {
+      idle_cv.notify_all();
+    }
+  }
+  ZSTD_freeCCtx(cctx);
+}
+
+// with abort_on_error false a short write is logged, e.g. on a full disk
+size_t LogWriterThread::writeFile(FILE *file, const void *data, size_t size, bool abort_on_error) {
+  size_t written = util::safe_fwrite(data, 1, size, file);
+  if (written != size) {
+    LOGE("failed to write file.errno=%d", errno);
+    assert(!abort_on_error);
+  }
+  return written;
+}
+
+size_t LogWriterThread::writeCompressed(ZSTD_CCtx *cctx, FILE *file, const std::string &data, bool abort_on_error) {
+  std::string frame(ZSTD_compressBound(data.size()), '\0');
+  size_t size = ZSTD_compressCCtx(cctx, frame.data(), frame.size(), data.data(), data.size(), LOG_ZSTD_LEVEL);
+  assert(!ZSTD_isError(size));
+
+  size_t written = writeFile(file, frame.data(), size, abort_on_error);
+  seek_tables[file].emplace_back(size, data.size());
+  return written;
+}
+
+// https://github.com/facebook/zstd/blob/dev/contrib/seekable_format/zstd_seekable_compression_format.md
+size_t LogWriterThread::writeSeekTable(FILE *file, const std::vector<std::pair<uint32_t, uint32_t>> &frames, bool abort_on_error) {
+  const uint32_t skippable_magic = 0x184D2A5E, seekable_magic = 0x8F92EAB1;
+  const uint32_t frame_size = frames.size() * 8 + 9;
+
+  std::string table;
+  auto append_u32 = [&table](uint32_t v) { table.append((const char *)&v, sizeof(v)); };  // little endian
+  append_u32(skippable_magic);
+  append_u32(frame_size);
+  for (auto &[compressed_size, decompressed_size] : frames) {
+    append_u32(compressed_size);
+    append_u32(decompressed_size);
+  }
+  append_u32(frames.size());
+  table.push_back('\0');  // descriptor: no checksums
+  append_u32(seekable_magic);
+
+  return writeFile(file, table.data(), table.size(), abort_on_error);
+}
+
+BufferedLogFile::BufferedLogFile(const std::string &path, LogWriterThread *writer, size_t chunk_size, bool compress,
+                                 bool abort_on_error)
+  : writer(writer), chunk_size(chunk_size), compress(compress), abort_on_error(abort_on_error) {
+  file = util::safe_fopen(path.c_str(), "wb");
+  assert(file != nullptr);
+  buf.reserve(chunk_size);
+}
+
+BufferedLogFile::~BufferedLogFile() {
+  flush();
+  writer->close(file, abort_on_error);
+}
+
+void BufferedLogFile::write(const void *data, size_t size) {
+  buf.append((const char *)data, size);
+  if (buf.size() >= chunk_size) {
+    flush();
+  }
+}
+
+void BufferedLogFile::flush() {
+  if (!buf.empty()) {
+    writer->write(file, std::move(buf), compress, abort_on_error);
+    buf = std::string();
+    buf.reserve(chunk_size);
+  }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct ZSTD_CCtx_s;
+
+// LogWriterThread moves all filesystem writes for loggerd off the thread that drains
+// the sockets. Producers hand over coalesced chunks; when more than max_pending_bytes
+// are queued the producer blocks (log data is never dropped) and the stall is counted.
+//
+// Compressed chunks are written as independent zstd frames, and a seek table in the
+// zstd seekable format is appended when the file is closed, so readers can locate
+// and decompress frames in parallel.
+class LogWriterThread {
+public:
+  struct Stats {
+    uint64_t bytes_in = 0;           // bytes handed over by producers
+    uint64_t bytes_written = 0;      // bytes written to storage, after compression
+    uint64_t writes = 0;             // chunks written to storage
+    uint64_t stalls = 0;             // times a producer blocked on a full queue
+    double stall_ms = 0;             // total time producers spent blocked
+    double max_write_ms = 0;         // slowest single chunk write
+    size_t pending_bytes = 0;
+    size_t max_pending_bytes = 0;    // high-water mark of queued bytes
+  };
+
+  LogWriterThread(size_t max_pending_bytes = 32 * 1024 * 1024);
+  ~LogWriterThread();
+  // with abort_on_error false a failed write or close is logged and the data is lost
+  void write(FILE *file, std::string &&chunk, bool compress = false, bool abort_on_error = true);
+  void close(FILE *file, bool abort_on_error = true);
+  void remove(const std::string &path);
+  void flush();
+  Stats getStats();
+  Stats resetStats();
+
+private:
+  enum class JobType { WRITE, WRITE_ZSTD, CLOSE, REMOVE };
+  struct Job {
+    JobType type;
+    FILE *file;
+    std::string data;
+    bool abort_on_error = true;
+  };
+  void push(Job &&job);
+  void writerThread();
+  size_t writeFile(FILE *file, const void *data, size_t size, bool abort_on_error);
+  size_t writeCompressed(ZSTD_CCtx_s *cctx, FILE *file, const std::string &data, bool abort_on_error);
+  size_t writeSeekTable(FILE *file, const std::vector<std::pair<uint32_t, uint32_t>> &frames, bool abort_on_error);
+
+  const size_t max_pending_bytes;
+  std::mutex lock;
+  std::condition_variable work_cv, space_cv, idle_cv;
+  std::deque<Job> queue;
+  bool busy = false, exit = false;
+  Stats stats;
+  // (compressed, decompressed) size of each frame written to a compressed file
+  std::unordered_map<FILE *, std::vector<std::pair<uint32_t, uint32_t>>> seek_tables;
+  std::thread thread;
+};
+
+const int LOG_ZSTD_LEVEL = 3;
+
+// BufferedLogFile coalesces small writes into chunks and queues them on a LogWriterThread.
+// The file is closed on the writer thread once all of its chunks are on disk.
+// Chunks only end between write() calls, so with compression every zstd frame
+// starts and ends on a message boundary.
+class BufferedLogFile {
+public:
+  BufferedLogFile(const std::string &path, LogWriterThread *writer, size_t chunk_size = 256 * 1024, bool compress = false,
+                  bool abort_on_error = true);
+  ~BufferedLogFile();
+  void write(const void *data, size_t size);
+  void flush();
+
+private:
+  FILE *file = nullptr;
+  LogWriterThread *writer;
+  const size_t chunk_size;
+  const bool compress;
+  const bool abort_on_error;
+  std::string buf;
+};
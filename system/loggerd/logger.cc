@@ -121,7 +121,7 @@ static void log_sentinel(LoggerState *log, SentinelType type, int exit_signal =
   log->write(msg.toBytes(), true);
 }
 
-LoggerState::LoggerState(const std::string &log_root) {
+LoggerState::LoggerState(const std::string &log_root, bool compress) : compress(compress) {
   route_name = logger_get_identifier("RouteCount");
   route_path = log_root + "/" + route_name;
   init_data = logger_build_init_data();
@@ -130,26 +130,42 @@ LoggerState::LoggerState(const std::string &log_root) {
 LoggerState::~LoggerState() {
   if (rlog) {
     log_sentinel(this, SentinelType::END_OF_ROUTE, exit_signal);
-    std::remove(lock_file.c_str());
+    closeSegment();
   }
 }
 
+void LoggerState::closeSegment() {
+  rlog.reset();
+  qlog.reset();
+  // the lock is removed on the writer thread, after the logs are closed
+  log_writer.remove(lock_file);
+}
+
+void LoggerState::flush() {
+  if (rlog) {
+    rlog->flush();
+    qlog->flush();
+  }
+  log_writer.flush();
+}
+
 bool LoggerState::next() {
   if (rlog) {
     log_sentinel(this, SentinelType::END_OF_SEGMENT);
-    std::remove(lock_file.c_str());
+    closeSegment();
   }
 
   segment_path = route_path + "--" + std::to_string(++part);
   bool ret = util::create_directories(segment_path, 0775);
   assert(ret == true);
 
-  const std::string rlog_path = segment_path + "/rlog";
-  lock_file = rlog_path + ".lock";
+  lock_file = segment_path + "/rlog.lock";
   std::ofstream{lock_file};
 
-  rlog.reset(new RawFile(rlog_path));
-  qlog.reset(new RawFile(segment_path + "/qlog"));
+  // compressed logs are seekable zstd, one frame per chunk of whole messages
+  const std::string ext = compress ? ".zst" : "";
+  rlog.reset(new BufferedLogFile(segment_path + "/rlog" + ext, &log_writer, LOG_CHUNK_SIZE, compress));
+  qlog.reset(new BufferedLogFile(segment_path + "/qlog" + ext, &log_writer, LOG_CHUNK_SIZE, compress));
 
   // log init data & sentinel type.
   write(init_data.asBytes(), true);
@@ -7,6 +7,7 @@
 #include "cereal/messaging/messaging.h"
 #include "common/util.h"
 #include "system/hardware/hw.h"
+#include "system/loggerd/log_writer.h"
 
 class RawFile {
  public:
@@ -31,10 +32,12 @@ class RawFile {
 
 typedef cereal::Sentinel::SentinelType SentinelType;
 
+const size_t LOG_CHUNK_SIZE = 256 * 1024;
+
 
 class LoggerState {
 public:
-  LoggerState(const std::string& log_root = Path::log_root());
+  LoggerState(const std::string& log_root = Path::log_root(), bool compress = false);
   ~LoggerState();
   bool next();
   void write(uint8_t* data, size_t size, bool in_qlog);
@@ -43,12 +46,17 @@ public:
   inline const std::string& routeName() const { return route_name; }
   inline void write(kj::ArrayPtr<kj::byte> bytes, bool in_qlog) { write(bytes.begin(), bytes.size(), in_qlog); }
   inline void setExitSignal(int signal) { exit_signal = signal; }
+  inline LogWriterThread *writer() { return &log_writer; }
+  void flush();
 
 protected:
   int part = -1, exit_signal = 0;
+  bool compress = false;
   std::string route_path, route_name, segment_path, lock_file;
   kj::Array<capnp::word> init_data;
-  std::unique_ptr<RawFile> rlog, qlog;
+  LogWriterThread log_writer;  // must outlive rlog/qlog
+  std::unique_ptr<BufferedLogFile> rlog, qlog;
+  void closeSegment();
 };
 
 kj::Array<capnp::word> logger_build_init_data();
@@ -14,7 +14,7 @@
 ExitHandler do_exit;
 
 struct LoggerdState {
-  LoggerState logger;
+  LoggerState logger{Path::log_root(), Params().getBool("RecordZstdLogs")};
   std::atomic<double> last_camera_seen_tms;
   std::atomic<int> ready_to_rotate;  // count of encoders ready to rotate
   int max_waiting = 0;
@@ -116,7 +116,7 @@ int handle_encoder_msg(LoggerdState *s, Message *msg, std::string &name, struct
           assert(encoder_info.filename != NULL);
           re.writer.reset(new VideoWriter(s->logger.segmentPath().c_str(),
             encoder_info.filename, idx.getType() != cereal::EncodeIndex::Type::FULL_H_E_V_C,
-            edata.getWidth(), edata.getHeight(), encoder_info.fps, idx.getType()));
+            edata.getWidth(), edata.getHeight(), encoder_info.fps, idx.getType(), s->logger.writer()));
           // write the header
           auto header = edata.getHeader();
           re.writer->write((uint8_t *)header.begin(), header.size(), idx.getTimestampEof()/1000, true, false);
@@ -174,6 +174,17 @@ int handle_encoder_msg(LoggerdState *s, Message *msg, std::string &name, struct
   return bytes_count;
 }
 
+void log_writer_stats(LoggerdState *s) {
+  auto stats = s->logger.writer()->resetStats();
+  if (stats.stalls > 0) {
+    LOGW("writer stalled %" PRIu64 " times for %.2f ms, max write %.2f ms, max pending %zu KB",
+         stats.stalls, stats.stall_ms, stats.max_write_ms, stats.max_pending_bytes / 1024);
+  } else {
+    LOGD("writer: %" PRIu64 " writes, %.2f KB, max write %.2f ms, pending %zu KB (max %zu KB)",
+         stats.writes, stats.bytes_written * 0.001, stats.max_write_ms, stats.pending_bytes / 1024, stats.max_pending_bytes / 1024);
+  }
+}
+
 void handle_user_flag(LoggerdState *s) {
   static int prev_segment = -1;
   if (s->logger.segment() == prev_segment) return;
@@ -273,6 +284,7 @@ void loggerd_thread() {
         if ((++msg_count % 1000) == 0) {
           double seconds = (millis_since_boot() - start_ts) / 1000.0;
           LOGD("%" PRIu64 " messages, %.2f msg/sec, %.2f KB/sec", msg_count, msg_count / seconds, bytes_count * 0.001 / seconds);
+          log_writer_stats(&s);
         }
 
         count++;
@@ -287,8 +299,12 @@ void loggerd_thread() {
   LOGW("closing logger");
   s.logger.setExitSignal(do_exit.signal);
 
+  // close the video files while the logger's writer thread is still alive
+  remote_encoders.clear();
+
   if (do_exit.power_failure) {
     LOGE("power failure");
+    s.logger.flush();
     sync();
     LOGE("sync done");
   }
@@ -1,18 +1,45 @@
+#include <zstd.h>
+
+#include <chrono>
+#include <cinttypes>
+#include <thread>
+
 #include "catch2/catch.hpp"
+#include "common/timing.h"
 #include "system/loggerd/logger.h"
 
 typedef cereal::Sentinel::SentinelType SentinelType;
 
-void verify_segment(const std::string &route_path, int segment, int max_segment, int required_event_cnt) {
+std::string decompress_zst(const std::string &in) {
+  std::string out;
+  std::string buf(ZSTD_DStreamOutSize(), '\0');
+  ZSTD_DCtx *dctx = ZSTD_createDCtx();
+  ZSTD_inBuffer input = {in.data(), in.size(), 0};
+  while (input.pos < input.size) {
+    ZSTD_outBuffer output = {buf.data(), buf.size(), 0};
+    size_t ret = ZSTD_decompressStream(dctx, &output, &input);
+    REQUIRE(!ZSTD_isError(ret));
+    out.append(buf.data(), output.pos);
+  }
+  ZSTD_freeDCtx(dctx);
+  return out;
+}
+
+void verify_segment(const std::string &route_path, int segment, int max_segment, int required_event_cnt, bool compressed = false) {
   const std::string segment_path = route_path + "--" + std::to_string(segment);
   SentinelType begin_sentinel = segment == 0 ? SentinelType::START_OF_ROUTE : SentinelType::START_OF_SEGMENT;
   SentinelType end_sentinel = segment == max_segment - 1 ? SentinelType::END_OF_ROUTE : SentinelType::END_OF_SEGMENT;
 
   REQUIRE(!util::file_exists(segment_path + "/rlog.lock"));
   for (const char *fn : {"/rlog", "/qlog"}) {
-    const std::string log_file = segment_path + fn;
+    const std::string log_file = segment_path + fn + (compressed ? ".zst" : "");
     std::string log = util::read_file(log_file);
     REQUIRE(!log.empty());
+    if (compressed) {
+      // one frame per chunk of whole messages, followed by the seek table
+      REQUIRE(ZSTD_findFrameCompressedSize(log.data(), log.size()) < log.size());
+      log = decompress_zst(log);
+    }
     int event_cnt = 0, i = 0;
     kj::ArrayPtr<const capnp::word> words((capnp::word *)log.data(), log.size() / sizeof(capnp::word));
     while (words.size() > 0) {
@@ -53,22 +80,138 @@ void write_msg(LoggerState *logger) {
 }
 
 TEST_CASE("logger") {
+  const bool compressed = GENERATE(false, true);
   const int segment_cnt = 100;
+  const int msg_cnt = compressed ? 10000 : 1;  // enough to span several zstd frames
   const std::string log_root = "/tmp/test_logger";
   system(("rm " + log_root + " -rf").c_str());
   std::string route_name;
   {
-    LoggerState logger(log_root);
+    LoggerState logger(log_root, compressed);
     route_name = logger.routeName();
     for (int i = 0; i < segment_cnt; ++i) {
       REQUIRE(logger.next());
       REQUIRE(util::file_exists(logger.segmentPath() + "/rlog.lock"));
       REQUIRE(logger.segment() == i);
-      write_msg(&logger);
+      for (int j = 0; j < msg_cnt; ++j) {
+        write_msg(&logger);
+      }
     }
     logger.setExitSignal(1);
   }
   for (int i = 0; i < segment_cnt; ++i) {
-    verify_segment(log_root + "/" + route_name, i, segment_cnt, 1);
+    verify_segment(log_root + "/" + route_name, i, segment_cnt, msg_cnt, compressed);
+  }
+}
+
+// a FILE whose writes take at least delay_us, to simulate slow storage
+struct SlowFile {
+  std::string data;
+  int delay_us;
+};
+
+FILE *open_slow_file(SlowFile *f) {
+  cookie_io_functions_t funcs = {};
+  funcs.write = [](void *cookie, const char *buf, size_t size) -> ssize_t {
+    auto f = (SlowFile *)cookie;
+    std::this_thread::sleep_for(std::chrono::microseconds(f->delay_us));
+    f->data.append(buf, size);
+    return size;
+  };
+  return fopencookie(f, "w", funcs);
+}
+
+TEST_CASE("LogWriterThread") {
+  SlowFile slow_file = {.delay_us = 2000};
+  const size_t chunk_size = 4096;
+  const int chunk_cnt = 200;
+  std::string expected;
+  LogWriterThread::Stats stats;
+  {
+    LogWriterThread writer(chunk_size * 4);
+    FILE *f = open_slow_file(&slow_file);
+    setvbuf(f, nullptr, _IONBF, 0);
+    for (int i = 0; i < chunk_cnt; ++i) {
+      std::string chunk(chunk_size, 'a' + (i % 26));
+      expected += chunk;
+      writer.write(f, std::move(chunk));
+      REQUIRE(writer.getStats().pending_bytes <= chunk_size * 4);
+    }
+    writer.close(f);
+    writer.flush();
+    stats = writer.getStats();
   }
+  // slow storage must block the producer instead of dropping data
+  REQUIRE(slow_file.data == expected);
+  REQUIRE(stats.bytes_written == expected.size());
+  REQUIRE(stats.writes == chunk_cnt);
+  REQUIRE(stats.pending_bytes == 0);
+  REQUIRE(stats.max_pending_bytes <= chunk_size * 4);
+  REQUIRE(stats.stalls > 0);
+}
+
+TEST_CASE("LogWriterThread write errors") {
+  // a full disk: video writes may fail without taking loggerd down
+  LogWriterThread writer;
+  FILE *f = fopen("/dev/full", "wb");
+  REQUIRE(f != nullptr);
+  setvbuf(f, nullptr, _IONBF, 0);
+  writer.write(f, std::string(4096, 'a'), false, false);
+  // compressed frames and the seek table written on close go through the same path
+  writer.write(f, std::string(4096, 'b'), true, false);
+  writer.close(f, false);
+  writer.remove("/tmp/test_logger_no_such_lock");
+  writer.flush();
+
+  auto stats = writer.getStats();
+  REQUIRE(stats.writes == 2);
+  REQUIRE(stats.bytes_written == 0);
+  // only writes are counted as pending
+  REQUIRE(stats.pending_bytes == 0);
+}
+
+TEST_CASE("logger write latency under fsync-heavy load", "[.][benchmark]") {
+  const std::string log_root = "/tmp/test_logger_bench";
+  system(("rm " + log_root + " -rf").c_str());
+  util::create_directories(log_root, 0775);
+
+  // compete for the disk with a workload that constantly writes and fsyncs
+  std::atomic<bool> exit = false;
+  std::thread load_thread([&]() {
+    std::string buf(1024 * 1024, 'x');
+    int fd = open((log_root + "/load").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0664);
+    while (!exit) {
+      (void)::write(fd, buf.data(), buf.size());
+      fsync(fd);
+    }
+    close(fd);
+  });
+
+  MessageBuilder msg;
+  auto can = msg.initEvent().initCan(64);
+  auto bytes = msg.toBytes();
+
+  double max_ms = 0, total_ms = 0;
+  const int msg_cnt = 200000;
+  LogWriterThread::Stats stats;
+  {
+    LoggerState logger(log_root);
+    logger.next();
+    for (int i = 0; i < msg_cnt; ++i) {
+      double start_ms = millis_since_boot();
+      logger.write(bytes.asBytes(), i % 10 == 0);
+      double ms = millis_since_boot() - start_ms;
+      max_ms = std::max(max_ms, ms);
+      total_ms += ms;
+    }
+    logger.flush();
+    stats = logger.writer()->getStats();
+  }
+  exit = true;
+  load_thread.join();
+
+  printf("%d messages, %.2f MB: avg write %.4f ms, max write %.2f ms\n",
+         msg_cnt, stats.bytes_written / 1e6, total_ms / msg_cnt, max_ms);
+  printf("writer: %" PRIu64 " chunk writes, max chunk write %.2f ms, %" PRIu64 " stalls (%.2f ms), max pending %zu KB\n",
+         stats.writes, stats.max_write_ms, stats.stalls, stats.stall_ms, stats.max_pending_bytes / 1024);
 }
@@ -7,7 +7,7 @@ from pathlib import Path
 from openpilot.system.hardware.hw import Paths
 
 from openpilot.common.swaglog import cloudlog
-from openpilot.system.loggerd.uploader import main, UPLOAD_ATTR_NAME, UPLOAD_ATTR_VALUE
+from openpilot.system.loggerd.uploader import main, strip_compression_extension, MAX_UPLOAD_SIZES, UPLOAD_ATTR_NAME, UPLOAD_ATTR_VALUE
 
 from openpilot.system.loggerd.tests.loggerd_tests_common import UploaderTestCase
 
@@ -86,6 +86,11 @@ class TestUploader(UploaderTestCase):
 
     assert log_handler.upload_order == exp_order, "Files uploaded in wrong order"
 
+  def test_max_upload_size_compressed(self):
+    for name in ("qlog", "qlog.bz2", "qlog.zst"):
+      assert MAX_UPLOAD_SIZES.get(strip_compression_extension(name)) == MAX_UPLOAD_SIZES["qlog"]
+    assert strip_compression_extension("rlog.zst") not in MAX_UPLOAD_SIZES
+
   def test_upload_with_wrong_xattr(self):
     self.gen_files(lock=False, xattr=b'0')
 
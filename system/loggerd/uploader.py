@@ -27,6 +27,7 @@ NetworkType = log.DeviceState.NetworkType
 UPLOAD_ATTR_NAME = 'user.upload'
 UPLOAD_ATTR_VALUE = b'1'
 
+# keyed on the name without the compression extension
 MAX_UPLOAD_SIZES = {
   "qlog": 25*1e6,  # can't be too restrictive here since we use qlogs to find
                    # bugs, including ones that can cause massive log sizes
@@ -49,6 +50,12 @@ class FakeResponse:
     self.request = FakeRequest()
 
 
+def strip_compression_extension(fn: str) -> str:
+  for ext in (".bz2", ".zst"):
+    if fn.endswith(ext):
+      return fn[:-len(ext)]
+  return fn
+
 def get_directory_sort(d: str) -> list[str]:
   # ensure old format is sorted sooner
   o = ["0", ] if d.startswith("2024-") else ["1", ]
@@ -89,7 +96,7 @@ class Uploader:
     self.last_filename = ""
 
     self.immediate_folders = ["crash/", "boot/"]
-    self.immediate_priority = {"qlog": 0, "qlog.bz2": 0, "qcamera.ts": 1}
+    self.immediate_priority = {"qlog": 0, "qlog.bz2": 0, "qlog.zst": 0, "qcamera.ts": 1}
 
   def list_upload_files(self, metered: bool) -> Iterator[tuple[str, str, str]]:
     r = self.params.get("AthenadRecentlyViewedRoutes", encoding="utf8")
@@ -178,7 +185,7 @@ class Uploader:
     if sz == 0:
       # tag files of 0 size as uploaded
       success = True
-    elif name in MAX_UPLOAD_SIZES and sz > MAX_UPLOAD_SIZES[name]:
+    elif sz > MAX_UPLOAD_SIZES.get(strip_compression_extension(name), float('inf')):
       cloudlog.event("uploader_too_large", key=key, fn=fn, sz=sz)
       success = True
     else:
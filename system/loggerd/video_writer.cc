@@ -5,8 +5,9 @@
 #include "common/swaglog.h"
 #include "common/util.h"
 
-VideoWriter::VideoWriter(const char *path, const char *filename, bool remuxing, int width, int height, int fps, cereal::EncodeIndex::Type codec)
-  : remuxing(remuxing) {
+VideoWriter::VideoWriter(const char *path, const char *filename, bool remuxing, int width, int height, int fps, cereal::EncodeIndex::Type codec,
+                         LogWriterThread *writer)
+  : remuxing(remuxing), writer(writer) {
   vid_path = util::string_format("%s/%s", path, filename);
   lock_path = util::string_format("%s/%s.lock", path, filename);
 
@@ -44,6 +45,9 @@ VideoWriter::VideoWriter(const char *path, const char *filename, bool remuxing,
     int err = avio_open(&this->ofmt_ctx->pb, this->vid_path.c_str(), AVIO_FLAG_WRITE);
     assert(err >= 0);
 
+  } else if (writer) {
+    // like the direct path, a failed write (e.g. a full disk) is logged rather than fatal
+    this->buffered_of.reset(new BufferedLogFile(this->vid_path, writer, 1024 * 1024, false, false));
   } else {
     this->of = util::safe_fopen(this->vid_path.c_str(), "wb");
     assert(this->of);
@@ -51,7 +55,9 @@ VideoWriter::VideoWriter(const char *path, const char *filename, bool remuxing,
 }
 
 void VideoWriter::write(uint8_t *data, int len, long long timestamp, bool codecconfig, bool keyframe) {
-  if (of && data) {
+  if (buffered_of && data) {
+    buffered_of->write(data, len);
+  } else if (of && data) {
     size_t written = util::safe_fwrite(data, 1, len, of);
     if (written != len) {
       LOGE("failed to write file.errno=%d", errno);
@@ -103,10 +109,18 @@ VideoWriter::~VideoWriter() {
     err = avio_closep(&this->ofmt_ctx->pb);
     if (err != 0) LOGE("avio_closep failed %d", err);
     avformat_free_context(this->ofmt_ctx);
+  } else if (this->buffered_of) {
+    this->buffered_of.reset();
   } else {
     util::safe_fflush(this->of);
     fclose(this->of);
     this->of = nullptr;
   }
-  unlink(this->lock_path.c_str());
+
+  if (this->writer) {
+    // unlock once the writer thread has closed the file
+    this->writer->remove(this->lock_path);
+  } else {
+    unlink(this->lock_path.c_str());
+  }
 }
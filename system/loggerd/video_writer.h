@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <string>
 
 extern "C" {
@@ -8,15 +9,19 @@ extern "C" {
 }
 
 #include "cereal/messaging/messaging.h"
+#include "system/loggerd/log_writer.h"
 
 class VideoWriter {
 public:
-  VideoWriter(const char *path, const char *filename, bool remuxing, int width, int height, int fps, cereal::EncodeIndex::Type codec);
+  VideoWriter(const char *path, const char *filename, bool remuxing, int width, int height, int fps, cereal::EncodeIndex::Type codec,
+              LogWriterThread *writer = nullptr);
   void write(uint8_t *data, int len, long long timestamp, bool codecconfig, bool keyframe);
   ~VideoWriter();
 private:
   std::string vid_path, lock_path;
   FILE *of = nullptr;
+  LogWriterThread *writer = nullptr;
+  std::unique_ptr<BufferedLogFile> buffered_of;
 
   AVCodecContext *codec_ctx;
   AVFormatContext *ofmt_ctx;
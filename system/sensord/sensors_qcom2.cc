@@ -1,7 +1,7 @@
 #include <sys/resource.h>
 
 #include <chrono>
-#include <thread>
+#include <memory>
 #include <vector>
 #include <map>
 #include <poll.h>
@@ -10,7 +10,7 @@
 #include "cereal/services.h"
 #include "cereal/messaging/messaging.h"
 #include "common/i2c.h"
-#include "common/ratekeeper.h"
+#include "common/scheduler.h"
 #include "common/swaglog.h"
 #include "common/timing.h"
 #include "common/util.h"
@@ -91,15 +91,10 @@ void interrupt_loop(std::vector<std::tuple<Sensor *, std::string>> sensors) {
   }
 }
 
-void polling_loop(Sensor *sensor, std::string msg_name) {
-  PubMaster pm({msg_name.c_str()});
-  RateKeeper rk(msg_name, services.at(msg_name).frequency);
-  while (!do_exit) {
-    MessageBuilder msg;
-    if (sensor->get_event(msg) && sensor->is_data_valid(nanos_since_boot())) {
-      pm.send(msg_name.c_str(), msg);
-    }
-    rk.keepTime();
+void poll_sensor(PubMaster &pm, Sensor *sensor, const std::string &msg_name) {
+  MessageBuilder msg;
+  if (sensor->get_event(msg) && sensor->is_data_valid(nanos_since_boot())) {
+    pm.send(msg_name.c_str(), msg);
   }
 }
 
@@ -118,8 +113,9 @@ int sensor_loop(I2CBus *i2c_bus_imu) {
     {new MMC5603NJ_Magn(i2c_bus_imu), "magnetometer"},
   };
 
-  // Initialize sensors
-  std::vector<std::thread> threads;
+  // Initialize sensors, the ones without an interrupt are polled at their service rate from one thread
+  PeriodicScheduler polling("sensord_polling");
+  std::vector<std::unique_ptr<PubMaster>> polling_pms;
   for (auto &[sensor, msg_name] : sensors_init) {
     int err = sensor->init();
     if (err < 0) {
@@ -127,9 +123,13 @@ int sensor_loop(I2CBus *i2c_bus_imu) {
     }
 
     if (!sensor->has_interrupt_enabled()) {
-      threads.emplace_back(polling_loop, sensor, msg_name);
+      PubMaster *pm = polling_pms.emplace_back(std::make_unique<PubMaster>(std::vector<const char *>{msg_name.c_str()})).get();
+      polling.add(msg_name, services.at(msg_name).frequency, [pm, sensor = sensor, name = msg_name]() {
+        poll_sensor(*pm, sensor, name);
+      });
     }
   }
+  polling.start();
 
   // increase interrupt quality by pinning interrupt and process to core 1
   setpriority(PRIO_PROCESS, 0, -18);
@@ -142,13 +142,9 @@ int sensor_loop(I2CBus *i2c_bus_imu) {
   }
   std::system(util::string_format("sudo su -c 'echo 1 > %s'", irq_path.c_str()).c_str());
 
-  // thread for reading events via interrupts
-  threads.emplace_back(&interrupt_loop, std::ref(sensors_init));
-
-  // wait for all threads to finish
-  for (auto &t : threads) {
-    t.join();
-  }
+  // reading events via interrupts until exit
+  interrupt_loop(sensors_init);
+  polling.stop();
 
   for (auto &[sensor, msg_name] : sensors_init) {
     sensor->shutdown();
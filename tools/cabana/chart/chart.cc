@@ -1,6 +1,7 @@
 #include "tools/cabana/chart/chart.h"
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
 
 #include <QActionGroup>
@@ -219,6 +220,10 @@ void ChartView::updatePlotArea(int left_pos, bool force) {
     x_label_size += QSizeF{5, 5};
     chart()->setPlotArea(rect().adjusted(align_to + left, adjust_top + top, -x_label_size.width() / 2 - right, -x_label_size.height() - bottom));
     chart()->layout()->invalidate();
+    // the number of points to show depends on the plot width
+    for (auto &s : sigs) {
+      updateSeriesData(s);
+    }
     resetChartCache();
   }
 }
@@ -249,6 +254,9 @@ void ChartView::updatePlot(double cur, double min, double max) {
   cur_sec = cur;
   if (min != axis_x->min() || max != axis_x->max()) {
     axis_x->setRange(min, max);
+    for (auto &s : sigs) {
+      updateSeriesData(s);
+    }
     updateAxisY();
     updateSeriesPoints();
     // update tooltip
@@ -283,20 +291,21 @@ void ChartView::updateSeriesPoints() {
   }
 }
 
-void ChartView::appendCanEvents(const cabana::Signal *sig, const std::vector<const CanEvent *> &events,
-                                std::vector<QPointF> &vals, std::vector<QPointF> &step_vals) {
+void ChartView::appendCanEvents(const MessageId &msg_id, const cabana::Signal *sig, const std::vector<const CanEvent *> &events,
+                                std::vector<QPointF> &vals) {
   vals.reserve(vals.size() + events.capacity());
-  step_vals.reserve(step_vals.size() + events.capacity() * 2);
 
-  double value = 0;
+  // events is a run of can->events(msg_id), whose decoded values are cached by the stream
+  const auto &all_events = can->events(msg_id);
+  const auto values = can->signalValues(msg_id, sig);
+  size_t i = std::distance(all_events.begin(), std::lower_bound(all_events.begin(), all_events.end(), events.front()->mono_time, CompareCanEvent()));
   const uint64_t begin_mono_time = can->routeStartTime() * 1e9;
   for (const CanEvent *e : events) {
-    if (sig->getValue(e->dat, e->size, &value)) {
+    while (i < all_events.size() && all_events[i] != e) ++i;
+    if (i == all_events.size()) break;
+    if (const double value = (*values)[i]; !std::isnan(value)) {
       const double ts = (e->mono_time - std::min(e->mono_time, begin_mono_time)) / 1e9;
       vals.emplace_back(ts, value);
-      if (!step_vals.empty())
-        step_vals.emplace_back(ts, step_vals.back().y());
-      step_vals.emplace_back(ts, value);
     }
   }
 }
@@ -306,27 +315,33 @@ void ChartView::updateSeries(const cabana::Signal *sig, const MessageEventsMap *
     if (!sig || s.sig == sig) {
       if (!msg_new_events) {
         s.vals.clear();
-        s.step_vals.clear();
       }
       auto events = msg_new_events ? msg_new_events : &can->eventsMap();
       auto it = events->find(s.msg_id);
-      if (it == events->end() || it->second.empty()) continue;
+      if (it == events->end() || it->second.empty()) {
+        if (!msg_new_events) s.lod.build(s.vals);
+        updateSeriesData(s);
+        continue;
+      }
 
+      size_t changed_from = s.vals.size();
       if (s.vals.empty() || (it->second.back()->mono_time / 1e9 - can->routeStartTime()) > s.vals.back().x()) {
-        appendCanEvents(s.sig, it->second, s.vals, s.step_vals);
+        appendCanEvents(s.msg_id, s.sig, it->second, s.vals);
       } else {
-        std::vector<QPointF> vals, step_vals;
-        appendCanEvents(s.sig, it->second, vals, step_vals);
-        s.vals.insert(std::lower_bound(s.vals.begin(), s.vals.end(), vals.front().x(), xLessThan),
-                      vals.begin(), vals.end());
-        s.step_vals.insert(std::lower_bound(s.step_vals.begin(), s.step_vals.end(), step_vals.front().x(), xLessThan),
-                           step_vals.begin(), step_vals.end());
+        std::vector<QPointF> vals;
+        appendCanEvents(s.msg_id, s.sig, it->second, vals);
+        if (!vals.empty()) {
+          auto pos = std::lower_bound(s.vals.begin(), s.vals.end(), vals.front().x(), xLessThan);
+          changed_from = std::distance(s.vals.begin(), pos);
+          s.vals.insert(pos, vals.begin(), vals.end());
+        }
       }
 
       if (!can->liveStreaming()) {
         s.segment_tree.build(s.vals);
       }
-      s.series->replace(QVector<QPointF>::fromStdVector(series_type == SeriesType::StepLine ? s.step_vals : s.vals));
+      s.lod.update(s.vals, changed_from);
+      updateSeriesData(s);
     }
   }
   updateAxisY();
@@ -334,6 +349,29 @@ void ChartView::updateSeries(const cabana::Signal *sig, const MessageEventsMap *
   QMetaObject::invokeMethod(this, &ChartView::resetChartCache, Qt::QueuedConnection);
 }
 
+// Hand QtCharts only the visible range, reduced to about two points per pixel
+void ChartView::updateSeriesData(SigItem &s) {
+  auto first = std::lower_bound(s.vals.cbegin(), s.vals.cend(), axis_x->min(), xLessThan);
+  auto last = std::lower_bound(first, s.vals.cend(), axis_x->max(), xLessThan);
+  // include the neighbours outside the range so lines run to the plot edges
+  if (first != s.vals.cbegin()) --first;
+  if (last != s.vals.cend()) ++last;
+
+  const size_t max_points = 2 * std::max<qreal>(chart()->plotArea().width(), 100) * devicePixelRatioF();
+  s.lod.decimate(s.vals, first - s.vals.cbegin(), last - s.vals.cbegin(), max_points, series_points);
+
+  if (series_type == SeriesType::StepLine && !series_points.empty()) {
+    std::vector<QPointF> step_points;
+    step_points.reserve(series_points.size() * 2);
+    for (const QPointF &pt : series_points) {
+      if (!step_points.empty()) step_points.emplace_back(pt.x(), step_points.back().y());
+      step_points.push_back(pt);
+    }
+    series_points.swap(step_points);
+  }
+  s.series->replace(QVector<QPointF>::fromStdVector(series_points));
+}
+
 // auto zoom on yaxis
 void ChartView::updateAxisY() {
   if (sigs.empty()) return;
@@ -848,7 +886,7 @@ void ChartView::setSeriesType(SeriesType type) {
     }
     for (auto &s : sigs) {
       s.series = createSeries(series_type, s.sig->color);
-      s.series->replace(QVector<QPointF>::fromStdVector(series_type == SeriesType::StepLine ? s.step_vals : s.vals));
+      updateSeriesData(s);
     }
     updateSeriesPoints();
     updateTitle();
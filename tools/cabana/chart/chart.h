@@ -45,9 +45,9 @@ public:
     const cabana::Signal *sig = nullptr;
     QXYSeries *series = nullptr;
     std::vector<QPointF> vals;
-    std::vector<QPointF> step_vals;
     QPointF track_pt{};
     SegmentTree segment_tree;
+    MinMaxPyramid lod;
     double min = 0;
     double max = 0;
   };
@@ -64,8 +64,8 @@ private slots:
   void signalRemoved(const cabana::Signal *sig) { removeIf([=](auto &s) { return s.sig == sig; }); }
 
 private:
-  void appendCanEvents(const cabana::Signal *sig, const std::vector<const CanEvent *> &events,
-                       std::vector<QPointF> &vals, std::vector<QPointF> &step_vals);
+  void appendCanEvents(const MessageId &msg_id, const cabana::Signal *sig, const std::vector<const CanEvent *> &events,
+                       std::vector<QPointF> &vals);
   void createToolButtons();
   void addSeries(QXYSeries *series);
   void contextMenuEvent(QContextMenuEvent *event) override;
@@ -95,6 +95,7 @@ private:
   QXYSeries *createSeries(SeriesType type, QColor color);
   void setSeriesColor(QXYSeries *, QColor color);
   void updateSeriesPoints();
+  void updateSeriesData(SigItem &s);
   void removeIf(std::function<bool(const SigItem &)> predicate);
   inline void clearTrackPoints() { for (auto &s : sigs) s.track_pt = {}; }
 
@@ -110,6 +111,7 @@ private:
   QGraphicsProxyWidget *manage_btn_proxy;
   TipLabel *tip_label;
   std::vector<SigItem> sigs;
+  std::vector<QPointF> series_points;  // scratch buffer for updateSeriesData
   double cur_sec = 0;
   SeriesType series_type = SeriesType::Line;
   bool is_scrubbing = false;
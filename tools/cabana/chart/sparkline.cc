@@ -1,6 +1,7 @@
 #include "tools/cabana/chart/sparkline.h"
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
 #include <QPainter>
 
@@ -19,9 +20,9 @@ void Sparkline::update(const MessageId &msg_id, const cabana::Signal *sig, doubl
   }
 
   points.clear();
-  double value = 0;
+  const auto values = can->signalValues(msg_id, sig);
   for (auto it = first; it != last; ++it) {
-    if (sig->getValue((*it)->dat, (*it)->size, &value)) {
+    if (const double value = (*values)[it - msgs.cbegin()]; !std::isnan(value)) {
       points.emplace_back(((*it)->mono_time - (*first)->mono_time) / 1e9, value);
     }
   }
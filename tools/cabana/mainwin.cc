@@ -88,8 +88,10 @@ void MainWindow::createActions() {
   file_menu->addAction(tr("Open Stream..."), this, &MainWindow::openStream);
   close_stream_act = file_menu->addAction(tr("Close stream"), this, &MainWindow::closeStream);
   export_to_csv_act = file_menu->addAction(tr("Export to CSV..."), this, &MainWindow::exportToCSV);
+  export_to_columnar_act = file_menu->addAction(tr("Export Signals to Columnar File..."), this, &MainWindow::exportToColumnar);
   close_stream_act->setEnabled(false);
   export_to_csv_act->setEnabled(false);
+  export_to_columnar_act->setEnabled(false);
   file_menu->addSeparator();
 
   file_menu->addAction(tr("New DBC File"), [this]() { newFile(); }, QKeySequence::New);
@@ -285,6 +287,19 @@ void MainWindow::exportToCSV() {
   }
 }
 
+void MainWindow::exportToColumnar() {
+  ExportColumnarDlg dlg(this);
+  if (dlg.exec() != QDialog::Accepted) return;
+
+  QString dir = QString("%1/%2.cabcol").arg(settings.last_dir).arg(can->routeName());
+  QString fn = QFileDialog::getSaveFileName(this, tr("Export signals to columnar file"), dir, tr("Cabana columnar (*.cabcol)"));
+  if (!fn.isEmpty()) {
+    if (utils::exportToColumnar(this, fn, dlg.selection(), dlg.beginSec(), dlg.endSec())) {
+      statusBar()->showMessage(tr("Exported signals to %1").arg(fn), 2000);
+    }
+  }
+}
+
 void MainWindow::newFile(SourceSet s) {
   closeFile(s);
   dbc()->open(s, "", "");
@@ -360,6 +375,7 @@ void MainWindow::streamStarted() {
   bool has_stream = dynamic_cast<DummyStream *>(can) == nullptr;
   close_stream_act->setEnabled(has_stream);
   export_to_csv_act->setEnabled(has_stream);
+  export_to_columnar_act->setEnabled(has_stream);
   tools_menu->setEnabled(has_stream);
   createDockWidgets();
 
@@ -703,3 +719,31 @@ bool HelpOverlay::eventFilter(QObject *obj, QEvent *event) {
 void HelpOverlay::mouseReleaseEvent(QMouseEvent *event) {
   close();
 }
+
+// ExportColumnarDlg
+
+ExportColumnarDlg::ExportColumnarDlg(QWidget *parent) : SignalSelector(tr("Export Signals to Columnar File"), parent) {
+  QHBoxLayout *range_layout = new QHBoxLayout();
+  range_layout->addWidget(new QLabel(tr("Time range")));
+  for (auto spin : {&begin_spin, &end_spin}) {
+    range_layout->addWidget(*spin = new QDoubleSpinBox(this));
+    (*spin)->setRange(0, std::max(0.0, can->totalSeconds()));
+    (*spin)->setDecimals(2);
+    (*spin)->setSuffix(" s");
+  }
+  end_spin->setValue(end_spin->maximum());
+  QObject::connect(begin_spin, qOverload<double>(&QDoubleSpinBox::valueChanged), end_spin, &QDoubleSpinBox::setMinimum);
+  QObject::connect(end_spin, qOverload<double>(&QDoubleSpinBox::valueChanged), begin_spin, &QDoubleSpinBox::setMaximum);
+  ((QGridLayout *)layout())->addLayout(range_layout, 3, 0);
+  setToolTip(tr("Leave the selected signals empty to export all signals"));
+}
+
+utils::SignalSelection ExportColumnarDlg::selection() {
+  utils::SignalSelection ret;
+  for (auto item : seletedItems()) {
+    auto it = std::find_if(ret.begin(), ret.end(), [&](auto &s) { return s.first == item->msg_id; });
+    if (it == ret.end()) it = ret.insert(ret.end(), {item->msg_id, {}});
+    it->second.push_back(item->sig);
+  }
+  return ret;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QDockWidget>
+#include <QDoubleSpinBox>
 #include <QJsonDocument>
 #include <QMainWindow>
 #include <QMenu>
@@ -15,6 +16,7 @@
 #include "tools/cabana/messageswidget.h"
 #include "tools/cabana/videowidget.h"
 #include "tools/cabana/tools/findsimilarbits.h"
+#include "tools/cabana/utils/export.h"
 
 class MainWindow : public QMainWindow {
   Q_OBJECT
@@ -30,6 +32,7 @@ public slots:
   void openStream();
   void closeStream();
   void exportToCSV();
+  void exportToColumnar();
   void changingStream();
   void streamStarted();
 
@@ -96,6 +99,7 @@ protected:
   QMenu *tools_menu = nullptr;
   QAction *close_stream_act = nullptr;
   QAction *export_to_csv_act = nullptr;
+  QAction *export_to_columnar_act = nullptr;
   QAction *save_dbc = nullptr;
   QAction *save_dbc_as = nullptr;
   QAction *copy_dbc_to_clipboard = nullptr;
@@ -116,3 +120,17 @@ protected:
   void mouseReleaseEvent(QMouseEvent *event) override;
   bool eventFilter(QObject *obj, QEvent *event) override;
 };
+
+// Signals and time range of a columnar export, no selected signals exports all of them
+class ExportColumnarDlg : public SignalSelector {
+public:
+  ExportColumnarDlg(QWidget *parent);
+  utils::SignalSelection selection();
+  double beginSec() const { return begin_spin->value(); }
+  // the end of a live stream keeps moving, an unchanged end exports up to the last event
+  double endSec() const { return end_spin->value() < end_spin->maximum() ? end_spin->value() : std::numeric_limits<double>::max(); }
+
+private:
+  QDoubleSpinBox *begin_spin;
+  QDoubleSpinBox *end_spin;
+};
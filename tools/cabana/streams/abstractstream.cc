@@ -1,16 +1,21 @@
 #include "tools/cabana/streams/abstractstream.h"
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include <utility>
 
 #include <QApplication>
+#include <QtConcurrent>
 #include "common/timing.h"
 #include "tools/cabana/settings.h"
 
-static const int EVENT_NEXT_BUFFER_SIZE = 6 * 1024 * 1024;  // 6MB
-
 AbstractStream *can = nullptr;
 
+namespace {
+double calc_freq(const MessageId &msg_id, double current_sec);
+}  // namespace
+
 StreamNotifier *StreamNotifier::instance() {
   static StreamNotifier notifier;
   return &notifier;
@@ -18,13 +23,17 @@ StreamNotifier *StreamNotifier::instance() {
 
 AbstractStream::AbstractStream(QObject *parent) : QObject(parent) {
   assert(parent != nullptr);
-  event_buffer_ = std::make_unique<MonotonicBuffer>(EVENT_NEXT_BUFFER_SIZE);
+  event_buffer_ = std::make_unique<EventBuffer>();
 
   QObject::connect(QApplication::instance(), &QCoreApplication::aboutToQuit, this, &AbstractStream::stop);
   QObject::connect(this, &AbstractStream::privateUpdateLastMsgsSignal, this, &AbstractStream::updateLastMessages, Qt::QueuedConnection);
   QObject::connect(this, &AbstractStream::seekedTo, this, &AbstractStream::updateLastMsgsTo);
   QObject::connect(dbc(), &DBCManager::DBCFileChanged, this, &AbstractStream::updateMasks);
   QObject::connect(dbc(), &DBCManager::maskUpdated, this, &AbstractStream::updateMasks);
+  // entries check the signal definition on use, these only release memory
+  QObject::connect(dbc(), &DBCManager::DBCFileChanged, this, [this]() { signal_values_.clear(); });
+  QObject::connect(dbc(), &DBCManager::msgRemoved, this, [this](MessageId id) { signal_values_.remove(id); });
+  QObject::connect(dbc(), &DBCManager::signalRemoved, this, [this](const cabana::Signal *sig) { signal_values_.remove(sig); });
   QObject::connect(this, &AbstractStream::streamStarted, [this]() {
     emit StreamNotifier::instance()->changingStream();
     delete can;
@@ -126,31 +135,116 @@ const CanData &AbstractStream::lastMessage(const MessageId &id) {
   return it != last_msgs.end() ? it->second : empty_data;
 }
 
+// Counts the bit changes between consecutive frames like CanData::compute. Masks are
+// applied when the counts are restored: a masked bit is never counted by compute, so its
+// count is zero either way.
+static void countBitChanges(const CanEvent *prev, const CanEvent *cur, std::vector<std::array<uint32_t, 8>> &counts) {
+  if (!prev || cur->size != counts.size()) {
+    // a new frame size restarts change tracking
+    counts.assign(cur->size, {});
+    return;
+  }
+  for (int i = 0; i < cur->size; ++i) {
+    if (const uint8_t diff = prev->dat[i] ^ cur->dat[i]) {
+      for (int bit = 0; bit < 8; ++bit) {
+        if (diff & (1u << bit)) ++counts[i][7 - bit];
+      }
+    }
+  }
+}
+
+// extends the snapshots of the messages with new events, from their tails
+void AbstractStream::updateSeekSnapshots(const std::vector<MessageId> &ids) {
+  std::vector<std::pair<const std::vector<const CanEvent *> *, SeekSnapshots *>> work;
+  for (const auto &id : ids) {
+    const auto &ev = events_.at(id);
+    auto &s = seek_snapshots_[id];
+    if (s.tail.count < ev.size()) work.push_back({&ev, &s});
+  }
+  QtConcurrent::blockingMap(work, [](auto &w) {
+    const auto &ev = *w.first;
+    auto &s = *w.second;
+    if (s.tail.count == 0) {
+      s.first_interval = ev[0]->mono_time / SEEK_SNAPSHOT_INTERVAL;
+    }
+    for (size_t i = s.tail.count; i < ev.size(); ++i) {
+      // a snapshot is taken once an event after its time is seen, later events can't change it
+      while ((s.first_interval + s.snapshots.size() + 1) * SEEK_SNAPSHOT_INTERVAL < ev[i]->mono_time) {
+        s.snapshots.push_back(s.tail);
+      }
+      countBitChanges(i > 0 ? ev[i - 1] : nullptr, ev[i], s.tail.bit_change_counts);
+      s.tail.count = i + 1;
+    }
+  });
+}
+
 // it is thread safe to update data in updateLastMsgsTo.
 // updateLastMsgsTo is always called in UI thread.
 void AbstractStream::updateLastMsgsTo(double sec) {
   current_sec_ = sec;
-  uint64_t last_ts = (sec + routeStartTime()) * 1e9;
+  const uint64_t last_ts = (sec + routeStartTime()) * 1e9;
+
+  // restore the nearest snapshot before sec and replay the events since, in parallel
+  struct SeekState {
+    const MessageId *id;
+    const std::vector<const CanEvent *> *events;
+    size_t count;
+    std::vector<std::array<uint32_t, 8>> bit_change_counts;
+  };
+  std::vector<SeekState> states;
+  states.reserve(events_.size());
+  for (const auto &[id, ev] : events_) {
+    states.push_back({.id = &id, .events = &ev});
+  }
+  QtConcurrent::blockingMap(states, [&](SeekState &state) {
+    static const SeekSnapshot empty_snapshot;
+    const auto &ev = *state.events;
+    const auto &s = seek_snapshots_.at(*state.id);
+    const SeekSnapshot *from = &empty_snapshot;
+    if (const uint64_t n = last_ts / SEEK_SNAPSHOT_INTERVAL; n > s.first_interval) {
+      // the tail when no event comes after the last snapshot
+      from = n - s.first_interval - 1 < s.snapshots.size() ? &s.snapshots[n - s.first_interval - 1] : &s.tail;
+    }
+    state.count = from->count;
+    state.bit_change_counts = from->bit_change_counts;
+    for (; state.count < ev.size() && ev[state.count]->mono_time <= last_ts; ++state.count) {
+      countBitChanges(state.count > 0 ? ev[state.count - 1] : nullptr, ev[state.count], state.bit_change_counts);
+    }
+  });
+
   std::unordered_map<MessageId, CanData> msgs;
   msgs.reserve(events_.size());
+  {
+    std::lock_guard lk(mutex_);
+    for (const auto &[id_ptr, ev_ptr, count, bit_change_counts] : states) {
+      if (count == 0) continue;
 
-  for (const auto &[id, ev] : events_) {
-    auto it = std::upper_bound(ev.begin(), ev.end(), last_ts, CompareCanEvent());
-    if (it != ev.begin()) {
-      auto prev = std::prev(it);
-      double ts = (*prev)->mono_time / 1e9 - routeStartTime();
+      const MessageId &id = *id_ptr;
+      const CanEvent *prev = (*ev_ptr)[count - 1];
       auto &m = msgs[id];
-      double freq = 0;
-      // Keep suppressed bits.
-      if (auto old_m = messages_.find(id); old_m != messages_.end()) {
-        freq = old_m->second.freq;
-        m.last_changes.reserve(old_m->second.last_changes.size());
-        std::transform(old_m->second.last_changes.cbegin(), old_m->second.last_changes.cend(),
-                       std::back_inserter(m.last_changes),
-                       [](const auto &change) { return CanData::ByteLastChange{.suppressed = change.suppressed}; });
+      // the state CanData::compute starts from, without searching the events again
+      m.ts = prev->mono_time / 1e9 - routeStartTime();
+      m.count = count;
+      m.dat.assign(prev->dat, prev->dat + prev->size);
+      m.colors.assign(prev->size, QColor(0, 0, 0, 0));
+      m.last_changes.assign(prev->size, {.ts = m.ts});
+      m.last_freq_update_ts = seconds_since_boot();
+      const auto old_m = messages_.find(id);
+      m.freq = old_m != messages_.end() ? old_m->second.freq : calc_freq(id, m.ts);
+
+      const auto mask = masks_.find(id);
+      for (size_t i = 0; i < m.last_changes.size() && i < bit_change_counts.size(); ++i) {
+        auto &last_change = m.last_changes[i];
+        // Keep suppressed bits.
+        last_change.suppressed = old_m != messages_.end() && i < old_m->second.last_changes.size() &&
+                                 old_m->second.last_changes[i].suppressed;
+        if (last_change.suppressed) continue;
+
+        const uint8_t mask_byte = mask != masks_.end() && i < mask->second.size() ? mask->second[i] : 0;
+        for (int j = 0; j < 8; ++j) {
+          last_change.bit_change_counts[j] = ((mask_byte >> (7 - j)) & 1) ? 0 : bit_change_counts[i][j];
+        }
       }
-      m.compute(id, (*prev)->dat, (*prev)->size, ts, getSpeed(), {}, freq);
-      m.count = std::distance(ev.begin(), prev) + 1;
     }
   }
 
@@ -165,12 +259,16 @@ void AbstractStream::updateLastMsgsTo(double sec) {
 
 const CanEvent *AbstractStream::newEvent(uint64_t mono_time, const cereal::CanData::Reader &c) {
   auto dat = c.getDat();
-  CanEvent *e = (CanEvent *)event_buffer_->allocate(sizeof(CanEvent) + sizeof(uint8_t) * dat.size());
-  e->src = c.getSrc();
-  e->address = c.getAddress();
+  return newEvent(mono_time, c.getSrc(), c.getAddress(), (const uint8_t *)dat.begin(), dat.size());
+}
+
+const CanEvent *AbstractStream::newEvent(uint64_t mono_time, uint8_t src, uint32_t address, const uint8_t *dat, uint8_t size) {
+  CanEvent *e = event_buffer_->allocate(mono_time, size);
+  e->src = src;
+  e->address = address;
   e->mono_time = mono_time;
-  e->size = dat.size();
-  memcpy(e->dat, (uint8_t *)dat.begin(), e->size);
+  e->size = size;
+  memcpy(e->dat, dat, size);
   return e;
 }
 
@@ -184,13 +282,24 @@ void AbstractStream::mergeEvents(const std::vector<const CanEvent *> &events) {
   }
 
   if (!events.empty()) {
+    std::vector<MessageId> merged_ids;
     for (const auto &[id, new_e] : msg_events) {
       if (!new_e.empty()) {
         auto &e = events_[id];
         auto pos = std::upper_bound(e.cbegin(), e.cend(), new_e.front()->mono_time, CompareCanEvent());
+        // the snapshots at or after the inserted events are taken again
+        if (auto s = seek_snapshots_.find(id); s != seek_snapshots_.end() && (size_t)(pos - e.cbegin()) < s->second.tail.count) {
+          auto &[first_interval, snapshots, tail] = s->second;
+          while (!snapshots.empty() && (first_interval + snapshots.size()) * SEEK_SNAPSHOT_INTERVAL >= new_e.front()->mono_time) {
+            snapshots.pop_back();
+          }
+          tail = snapshots.empty() ? SeekSnapshot{} : snapshots.back();
+        }
         e.insert(pos, new_e.cbegin(), new_e.cend());
+        merged_ids.push_back(id);
       }
     }
+    updateSeekSnapshots(merged_ids);
     auto pos = std::upper_bound(all_events_.cbegin(), all_events_.cend(), events.front()->mono_time, CompareCanEvent());
     all_events_.insert(pos, events.cbegin(), events.cend());
     emit eventsMerged(msg_events);
@@ -198,6 +307,131 @@ void AbstractStream::mergeEvents(const std::vector<const CanEvent *> &events) {
   lastest_event_ts = all_events_.empty() ? 0 : all_events_.back()->mono_time;
 }
 
+std::shared_ptr<void> AbstractStream::holdEvents() {
+  ++events_held_;
+  return std::shared_ptr<void>(nullptr, [this](void *) {
+    if (--events_held_ == 0) emit eventsReleased();
+  });
+}
+
+void AbstractStream::dropEvents(uint64_t begin_ts, uint64_t end_ts) {
+  auto erase_range = [=](std::vector<const CanEvent *> &e) {
+    auto first = std::lower_bound(e.begin(), e.end(), begin_ts, CompareCanEvent());
+    e.erase(first, std::lower_bound(first, e.end(), end_ts, CompareCanEvent()));
+  };
+
+  const size_t prev_size = all_events_.size();
+  erase_range(all_events_);
+  if (all_events_.size() == prev_size) return;
+
+  for (auto &[_, e] : events_) {
+    erase_range(e);
+  }
+  // cached values and snapshots refer to events by index
+  signal_values_.clear();
+  seek_snapshots_.clear();
+  std::vector<MessageId> ids;
+  ids.reserve(events_.size());
+  for (const auto &[id, _] : events_) ids.push_back(id);
+  updateSeekSnapshots(ids);
+  lastest_event_ts = all_events_.empty() ? 0 : all_events_.back()->mono_time;
+  emit eventsDropped();
+}
+
+// EventBuffer
+
+CanEvent *EventBuffer::allocate(uint64_t mono_time, uint8_t size) {
+  const size_t bytes = (sizeof(CanEvent) + size + alignof(CanEvent) - 1) & ~(alignof(CanEvent) - 1);
+  std::lock_guard lk(mutex);
+  if (chunks.empty() || chunks.back().used + bytes > CHUNK_SIZE) {
+    chunks.push_back({.data = std::unique_ptr<uint8_t[]>(new uint8_t[CHUNK_SIZE])});
+  }
+  auto &chunk = chunks.back();
+  CanEvent *e = (CanEvent *)(chunk.data.get() + chunk.used);
+  chunk.used += bytes;
+  chunk.max_mono_time = std::max(chunk.max_mono_time, mono_time);
+  return e;
+}
+
+void EventBuffer::release(uint64_t before_ts) {
+  std::lock_guard lk(mutex);
+  // the last chunk is still being filled
+  while (chunks.size() > 1 && chunks.front().max_mono_time < before_ts) {
+    chunks.pop_front();
+  }
+}
+
+// SignalValueCache
+
+static void decodeSignal(const cabana::Signal &sig, const CanEvent *const *events, size_t count, double *out) {
+  double value = 0;
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = sig.getValue(events[i]->dat, events[i]->size, &value) ? value : std::numeric_limits<double>::quiet_NaN();
+  }
+}
+
+SignalValueCache::Values SignalValueCache::get(const MessageId &id, const cabana::Signal *sig, const std::vector<const CanEvent *> &events) {
+  std::lock_guard lk(mutex);
+  auto &entry = entries[id][sig];
+  const bool same_def = entry.values && entry.def == *sig && entry.def.multiplexor == sig->multiplexor &&
+                        (!sig->multiplexor || (entry.multiplexor && *entry.multiplexor == *sig->multiplexor));
+
+  size_t from = 0;
+  if (same_def) {
+    const size_t n = entry.values->size();
+    if (n == events.size() && (n == 0 || events[n - 1] == entry.last_event)) {
+      return entry.values;
+    }
+    // keep the decoded prefix if events were only appended
+    if (n > 0 && n < events.size() && events[n - 1] == entry.last_event) {
+      from = n;
+    }
+  }
+
+  std::shared_ptr<std::vector<double>> values;
+  if (from == 0) {
+    values = std::make_shared<std::vector<double>>(events.size());
+  } else {
+    // extend in place unless a reader still holds the old values
+    values = entry.values.use_count() == 1 ? entry.values : std::make_shared<std::vector<double>>(*entry.values);
+    values->resize(events.size());
+  }
+
+  const size_t CHUNK_SIZE = 64 * 1024;
+  if (events.size() - from <= CHUNK_SIZE) {
+    decodeSignal(*sig, events.data() + from, events.size() - from, values->data() + from);
+  } else {
+    std::vector<size_t> chunks;
+    for (size_t i = from; i < events.size(); i += CHUNK_SIZE) chunks.push_back(i);
+    QtConcurrent::blockingMap(chunks, [&](size_t begin) {
+      decodeSignal(*sig, events.data() + begin, std::min(CHUNK_SIZE, events.size() - begin), values->data() + begin);
+    });
+  }
+
+  entry.def = *sig;
+  entry.multiplexor = sig->multiplexor ? std::make_optional(*sig->multiplexor) : std::nullopt;
+  entry.last_event = events.empty() ? nullptr : events.back();
+  entry.values = values;
+  return entry.values;
+}
+
+void SignalValueCache::remove(const MessageId &id) {
+  std::lock_guard lk(mutex);
+  entries.erase(id);
+}
+
+void SignalValueCache::remove(const cabana::Signal *sig) {
+  std::lock_guard lk(mutex);
+  for (auto &[_, sigs] : entries) {
+    sigs.erase(sig);
+  }
+}
+
+void SignalValueCache::clear() {
+  std::lock_guard lk(mutex);
+  entries.clear();
+}
+
 namespace {
 
 enum Color { GREYISH_BLUE, CYAN, RED};
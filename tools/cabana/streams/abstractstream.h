@@ -1,8 +1,10 @@
 #pragma once
 
 #include <array>
+#include <deque>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <set>
 #include <unordered_map>
 #include <vector>
@@ -57,6 +59,49 @@ struct BusConfig {
 
 typedef std::unordered_map<MessageId, std::vector<const CanEvent *>> MessageEventsMap;
 
+// Storage for CanEvents in fixed-size chunks, filled in arrival order. Live streams keep
+// a bounded window of events, so a chunk can be freed once all of its events are older
+// than the window. Thread safe, events are allocated in the stream thread.
+class EventBuffer {
+public:
+  CanEvent *allocate(uint64_t mono_time, uint8_t size);
+  // frees the chunks holding only events before ts, the caller must have dropped them
+  void release(uint64_t before_ts);
+
+private:
+  struct Chunk {
+    std::unique_ptr<uint8_t[]> data;
+    size_t used = 0;
+    uint64_t max_mono_time = 0;
+  };
+  static constexpr size_t CHUNK_SIZE = 4 * 1024 * 1024;
+  std::mutex mutex;
+  std::deque<Chunk> chunks;
+};
+
+// Decoded values of a signal, one per event of its message, shared by charts, sparklines,
+// the history log and exports. Decoded lazily in parallel chunks on first use; new events
+// at the end are decoded incrementally, and an entry is rebuilt if the signal definition
+// or the earlier events changed. NaN marks events where a multiplexed signal isn't present.
+class SignalValueCache {
+public:
+  using Values = std::shared_ptr<const std::vector<double>>;
+  Values get(const MessageId &id, const cabana::Signal *sig, const std::vector<const CanEvent *> &events);
+  void remove(const MessageId &id);
+  void remove(const cabana::Signal *sig);
+  void clear();
+
+private:
+  struct Entry {
+    cabana::Signal def;
+    std::optional<cabana::Signal> multiplexor;
+    const CanEvent *last_event = nullptr;
+    std::shared_ptr<std::vector<double>> values;
+  };
+  std::mutex mutex;
+  std::unordered_map<MessageId, std::unordered_map<const cabana::Signal *, Entry>> entries;
+};
+
 class AbstractStream : public QObject {
   Q_OBJECT
 
@@ -83,6 +128,13 @@ public:
   inline const std::vector<const CanEvent *> &allEvents() const { return all_events_; }
   const CanData &lastMessage(const MessageId &id);
   const std::vector<const CanEvent *> &events(const MessageId &id) const;
+  inline SignalValueCache::Values signalValues(const MessageId &id, const cabana::Signal *sig) {
+    return signal_values_.get(id, sig, events(id));
+  }
+  // Background readers of allEvents() and events() hold them while they run: merging and
+  // dropping events is deferred until the last hold is released.
+  std::shared_ptr<void> holdEvents();
+  inline bool eventsHeld() const { return events_held_ > 0; }
 
   size_t suppressHighlighted();
   void clearSuppressed();
@@ -95,6 +147,8 @@ signals:
   void seekedTo(double sec);
   void streamStarted();
   void eventsMerged(const MessageEventsMap &events_map);
+  void eventsDropped();
+  void eventsReleased();
   void msgsReceived(const std::set<MessageId> *new_msgs, bool has_new_ids);
   void sourcesUpdated(const SourceSet &s);
   void privateUpdateLastMsgsSignal();
@@ -105,7 +159,11 @@ public:
 protected:
   void mergeEvents(const std::vector<const CanEvent *> &events);
   const CanEvent *newEvent(uint64_t mono_time, const cereal::CanData::Reader &c);
+  const CanEvent *newEvent(uint64_t mono_time, uint8_t src, uint32_t address, const uint8_t *dat, uint8_t size);
   void updateEvent(const MessageId &id, double sec, const uint8_t *data, uint8_t size);
+  // removes the events in [begin_ts, end_ts) from memory, for streams that only keep a window
+  void dropEvents(uint64_t begin_ts, uint64_t end_ts);
+  void releaseEvents(uint64_t before_ts) { event_buffer_->release(before_ts); }
   uint64_t lastEventMonoTime() const { return lastest_event_ts; }
 
   std::vector<const CanEvent *> all_events_;
@@ -116,10 +174,28 @@ private:
   void updateLastMessages();
   void updateLastMsgsTo(double sec);
   void updateMasks();
+  void updateSeekSnapshots(const std::vector<MessageId> &ids);
+
+  // Message state every SEEK_SNAPSHOT_INTERVAL of mono time, extended as events are merged,
+  // so a seek restores the nearest snapshot and only replays the events since. Events
+  // inserted before the end only invalidate the snapshots after them.
+  struct SeekSnapshot {
+    uint32_t count = 0;
+    std::vector<std::array<uint32_t, 8>> bit_change_counts;  // unmasked
+  };
+  struct SeekSnapshots {
+    uint64_t first_interval = 0;  // snapshots[j] holds the events up to (first_interval + j + 1) intervals
+    std::vector<SeekSnapshot> snapshots;
+    SeekSnapshot tail;  // after the first tail.count events
+  };
+  static constexpr uint64_t SEEK_SNAPSHOT_INTERVAL = 10 * 1e9;
 
   MessageEventsMap events_;
+  std::unordered_map<MessageId, SeekSnapshots> seek_snapshots_;
+  SignalValueCache signal_values_;
   std::unordered_map<MessageId, CanData> last_msgs;
-  std::unique_ptr<MonotonicBuffer> event_buffer_;
+  std::unique_ptr<EventBuffer> event_buffer_;
+  int events_held_ = 0;
 
   // Members accessed in multiple threads. (mutex protected)
   std::mutex mutex_;
@@ -1,9 +1,14 @@
 #include "tools/cabana/streams/livestream.h"
 
+#include <QDebug>
+#include <QTemporaryFile>
 #include <QThread>
 #include <algorithm>
 #include <fstream>
 #include <memory>
+#include <string>
+
+#include <zstd.h>
 
 #include "common/timing.h"
 #include "common/util.h"
@@ -31,7 +36,86 @@ struct LiveStream::Logger {
   uint64_t start_ts;
 };
 
+// Events older than the retention window, zstd compressed in chunks in a temporary file.
+// Chunk records: [uint64 mono_time][uint32 address][uint8 src][uint8 size][dat]
+struct LiveStream::Spill {
+  static constexpr size_t CHUNK_SIZE = 4 * 1024 * 1024;  // uncompressed
+
+  struct Chunk {
+    uint64_t begin_ts, end_ts;  // first and last event
+    qint64 offset;
+    size_t size;
+  };
+
+  bool write(std::vector<const CanEvent *>::const_iterator first, std::vector<const CanEvent *>::const_iterator last) {
+    if (!file.isOpen() && !file.open()) return false;
+
+    std::string raw;
+    while (first != last) {
+      const uint64_t begin_ts = (*first)->mono_time;
+      raw.clear();
+      for (; first != last && raw.size() < CHUNK_SIZE; ++first) {
+        const CanEvent *e = *first;
+        raw.append((const char *)&e->mono_time, sizeof(e->mono_time));
+        raw.append((const char *)&e->address, sizeof(e->address));
+        raw.append((const char *)&e->src, sizeof(e->src));
+        raw.append((const char *)&e->size, sizeof(e->size));
+        raw.append((const char *)e->dat, e->size);
+      }
+      std::string out(ZSTD_compressBound(raw.size()), '\0');
+      size_t size = ZSTD_compress(out.data(), out.size(), raw.data(), raw.size(), 1);
+      if (ZSTD_isError(size)) return false;
+
+      const qint64 offset = file.size();
+      if (!file.seek(offset) || file.write(out.data(), size) != (qint64)size) return false;
+      chunks.push_back({.begin_ts = begin_ts, .end_ts = (*std::prev(first))->mono_time, .offset = offset, .size = size});
+    }
+    return true;
+  }
+
+  // decodes the spilled events in [begin_ts, end_ts) into paged_buffer
+  std::vector<const CanEvent *> read(uint64_t begin_ts, uint64_t end_ts) {
+    std::vector<const CanEvent *> events;
+    paged_buffer = std::make_unique<MonotonicBuffer>(CHUNK_SIZE);
+    for (const auto &c : chunks) {
+      if (c.end_ts < begin_ts || c.begin_ts >= end_ts) continue;
+
+      std::string compressed(c.size, '\0');
+      if (!file.seek(c.offset) || file.read(compressed.data(), c.size) != (qint64)c.size) break;
+      const std::string raw = decompressZST(compressed);
+      for (size_t pos = 0; pos + 14 <= raw.size();) {
+        uint64_t mono_time;
+        uint32_t address;
+        memcpy(&mono_time, &raw[pos], sizeof(mono_time));
+        memcpy(&address, &raw[pos + 8], sizeof(address));
+        const uint8_t src = raw[pos + 12], size = raw[pos + 13];
+        if (pos + 14 + size > raw.size()) break;  // truncated or corrupt chunk
+        if (mono_time >= begin_ts && mono_time < end_ts) {
+          CanEvent *e = (CanEvent *)paged_buffer->allocate(sizeof(CanEvent) + size);
+          e->src = src;
+          e->address = address;
+          e->mono_time = mono_time;
+          e->size = size;
+          memcpy(e->dat, &raw[pos + 14], size);
+          events.push_back(e);
+        }
+        pos += 14 + size;
+      }
+    }
+    return events;
+  }
+
+  QTemporaryFile file;
+  std::vector<Chunk> chunks;
+  uint64_t end_ts = 0;  // events before this are on disk
+  // the spilled range currently paged back in
+  uint64_t paged_begin_ts = 0;
+  uint64_t paged_end_ts = 0;
+  std::unique_ptr<MonotonicBuffer> paged_buffer;
+};
+
 LiveStream::LiveStream(QObject *parent) : AbstractStream(parent) {
+  spill = std::make_unique<Spill>();
   if (settings.log_livestream) {
     logger = std::make_unique<Logger>();
   }
@@ -86,16 +170,37 @@ void LiveStream::handleEvent(kj::ArrayPtr<capnp::word> data) {
   }
 }
 
+// called in streamThread
+void LiveStream::handleFrames(const std::vector<CanFrame> &frames) {
+  if (frames.empty()) return;
+
+  if (logger) {
+    MessageBuilder msg;
+    auto evt = msg.initEvent();
+    evt.setLogMonoTime(frames.front().mono_time);
+    auto can_data = evt.initCan(frames.size());
+    for (size_t i = 0; i < frames.size(); ++i) {
+      can_data[i].setAddress(frames[i].address);
+      can_data[i].setSrc(frames[i].src);
+      can_data[i].setDat(kj::arrayPtr(frames[i].dat, frames[i].size));
+    }
+    logger->write(capnp::messageToFlatArray(msg));
+  }
+
+  std::lock_guard lk(lock);
+  for (const auto &f : frames) {
+    received_events_.push_back(newEvent(f.mono_time, f.src, f.address, f.dat, f.size));
+  }
+}
+
 void LiveStream::timerEvent(QTimerEvent *event) {
   if (event->timerId() == timer_id) {
-    {
-      // merge events received from live stream thread.
-      std::lock_guard lk(lock);
-      mergeEvents(received_events_);
-      received_events_.clear();
-    }
+    // received events wait in received_events_ until background readers are done
+    if (eventsHeld()) return;
+
+    mergeReceivedEvents();
     if (!all_events_.empty()) {
-      begin_event_ts = all_events_.front()->mono_time;
+      dropExpiredEvents();
       updateEvents();
       return;
     }
@@ -103,6 +208,23 @@ void LiveStream::timerEvent(QTimerEvent *event) {
   QObject::timerEvent(event);
 }
 
+// merges the events received from the stream thread
+void LiveStream::mergeReceivedEvents() {
+  {
+    std::lock_guard lk(lock);
+    // frames arriving after their time was spilled are dropped
+    received_events_.erase(std::remove_if(received_events_.begin(), received_events_.end(),
+                                          [end_ts = spill->end_ts](auto e) { return e->mono_time < end_ts; }),
+                           received_events_.end());
+    mergeEvents(received_events_);
+    received_events_.clear();
+  }
+  if (!all_events_.empty()) {
+    // the first event may be dropped later, but the route keeps its start time
+    begin_event_ts = begin_event_ts ? std::min(begin_event_ts, all_events_.front()->mono_time) : all_events_.front()->mono_time;
+  }
+}
+
 void LiveStream::updateEvents() {
   static double prev_speed = 1.0;
 
@@ -121,6 +243,10 @@ void LiveStream::updateEvents() {
   uint64_t last_ts = post_last_event && speed_ == 1.0
                        ? all_events_.back()->mono_time
                        : first_event_ts + (nanos_since_boot() - first_update_ts) * speed_;
+  // keep paging in while playing back spilled events
+  if (spill->paged_end_ts && last_ts >= spill->paged_end_ts && spill->paged_end_ts < spill->end_ts) {
+    pageIn(std::min(last_ts, spill->end_ts - 1));
+  }
   auto first = std::upper_bound(all_events_.cbegin(), all_events_.cend(), current_event_ts, CompareCanEvent());
   auto last = std::upper_bound(first, all_events_.cend(), last_ts, CompareCanEvent());
 
@@ -133,8 +259,60 @@ void LiveStream::updateEvents() {
   emit privateUpdateLastMsgsSignal();
 }
 
+// Keeps the last max_cached_minutes of events in memory. Older events are written to the
+// spill file and dropped in steps of a tenth of the window, so the erase at the front of
+// the event vectors is amortized over many appends.
+void LiveStream::dropExpiredEvents() {
+  const uint64_t retention = settings.max_cached_minutes * 60 * 1e9;
+  const uint64_t last_ts = all_events_.back()->mono_time;
+  // paged in events all come before spill->end_ts
+  auto first = std::lower_bound(all_events_.cbegin(), all_events_.cend(), spill->end_ts, CompareCanEvent());
+  if (first == all_events_.cend() || last_ts - (*first)->mono_time < retention * 1.1) return;
+
+  const uint64_t cutoff = last_ts - retention;
+  auto last = std::lower_bound(first, all_events_.cend(), cutoff, CompareCanEvent());
+  if (!spill->write(first, last)) {
+    qWarning() << "failed to write expired events to" << spill->file.fileName();
+  }
+  const uint64_t begin_ts = std::exchange(spill->end_ts, cutoff);
+  dropEvents(begin_ts, cutoff);
+
+  // the released chunks may also hold late frames that aren't merged yet. They are dropped
+  // first, and the stream thread can't allocate into the chunks while they are released.
+  std::lock_guard lk(lock);
+  received_events_.erase(std::remove_if(received_events_.begin(), received_events_.end(),
+                                        [cutoff](auto e) { return e->mono_time < cutoff; }),
+                         received_events_.end());
+  releaseEvents(cutoff);
+}
+
+// Loads the spilled events around ts back into memory, so seeking before the retention
+// window still shows them in charts and the history log.
+void LiveStream::pageIn(uint64_t ts) {
+  if (ts >= spill->paged_begin_ts && ts < spill->paged_end_ts) return;
+
+  pageOut();
+  const uint64_t half_window = settings.max_cached_minutes * 60 * 1e9 / 2;
+  spill->paged_begin_ts = ts > half_window ? ts - half_window : 0;
+  spill->paged_end_ts = std::min(ts + half_window, spill->end_ts);
+  mergeEvents(spill->read(spill->paged_begin_ts, spill->paged_end_ts));
+}
+
+void LiveStream::pageOut() {
+  if (spill->paged_end_ts == 0) return;
+
+  dropEvents(spill->paged_begin_ts, spill->paged_end_ts);
+  spill->paged_buffer.reset();
+  spill->paged_begin_ts = spill->paged_end_ts = 0;
+}
+
 void LiveStream::seekTo(double sec) {
   sec = std::max(0.0, sec);
+  if (const uint64_t ts = sec * 1e9 + begin_event_ts; ts < spill->end_ts) {
+    pageIn(ts);
+  } else {
+    pageOut();
+  }
   first_update_ts = nanos_since_boot();
   current_event_ts = first_event_ts = std::min<uint64_t>(sec * 1e9 + begin_event_ts, lastEventMonoTime());
   post_last_event = (first_event_ts == lastEventMonoTime());
@@ -7,6 +7,15 @@
 
 #include "tools/cabana/streams/abstractstream.h"
 
+// A frame decoded by the stream itself, dat is only valid during handleFrames()
+struct CanFrame {
+  uint64_t mono_time;
+  uint32_t address;
+  uint8_t src;
+  uint8_t size;
+  const uint8_t *dat;
+};
+
 class LiveStream : public AbstractStream {
   Q_OBJECT
 
@@ -26,6 +35,13 @@ public:
 protected:
   virtual void streamThread() = 0;
   void handleEvent(kj::ArrayPtr<capnp::word> event);
+  // for sources that read raw frames, builds the CanEvents without a capnp round trip
+  void handleFrames(const std::vector<CanFrame> &frames);
+  // the steps of the update timer, see timerEvent()
+  void mergeReceivedEvents();
+  void dropExpiredEvents();
+  void pageIn(uint64_t ts);
+  void pageOut();
 
 private:
   void startUpdateTimer();
@@ -50,4 +66,6 @@ private:
 
   struct Logger;
   std::unique_ptr<Logger> logger;
+  struct Spill;
+  std::unique_ptr<Spill> spill;
 };
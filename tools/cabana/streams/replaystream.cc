@@ -28,6 +28,9 @@ static bool event_filter(const Event *e, void *opaque) {
 }
 
 void ReplayStream::mergeSegments() {
+  // picked up again once background readers release the events
+  if (eventsHeld()) return;
+
   for (auto &[n, seg] : replay->segments()) {
     if (seg && seg->isLoaded() && !processed_segments.count(n)) {
       processed_segments.insert(n);
@@ -55,6 +58,7 @@ bool ReplayStream::loadRoute(const QString &route, const QString &data_dir, uint
   replay->installEventFilter(event_filter, this);
   QObject::connect(replay.get(), &Replay::seekedTo, this, &AbstractStream::seekedTo);
   QObject::connect(replay.get(), &Replay::segmentsMerged, this, &ReplayStream::mergeSegments);
+  QObject::connect(this, &AbstractStream::eventsReleased, this, &ReplayStream::mergeSegments);
   QObject::connect(replay.get(), &Replay::qLogLoaded, this, &ReplayStream::qLogLoaded, Qt::QueuedConnection);
   return replay->load();
 }
@@ -1,68 +1,158 @@
 #include "tools/cabana/streams/socketcanstream.h"
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
 #include <QDebug>
+#include <QDir>
+#include <QFile>
 #include <QFormLayout>
 #include <QHBoxLayout>
 #include <QMessageBox>
 #include <QPushButton>
 #include <QThread>
 
-SocketCanStream::SocketCanStream(QObject *parent, SocketCanStreamConfig config_) : config(config_), LiveStream(parent) {
-  if (!available()) {
-    throw std::runtime_error("SocketCAN plugin not available");
+#ifdef __linux__
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#endif
+
+#include "common/timing.h"
+
+const int SOCKETCAN_BATCH_SIZE = 64;
+
+#ifdef __linux__
+struct SocketCanReader::Buffers {
+  canfd_frame frames[SOCKETCAN_BATCH_SIZE];
+  iovec iov[SOCKETCAN_BATCH_SIZE];
+  char control[SOCKETCAN_BATCH_SIZE][CMSG_SPACE(sizeof(scm_timestamping))];
+  mmsghdr msgs[SOCKETCAN_BATCH_SIZE];
+};
+#else
+struct SocketCanReader::Buffers {};
+#endif
+
+SocketCanReader::SocketCanReader() : buffers(std::make_unique<Buffers>()) {}
+
+SocketCanReader::~SocketCanReader() {
+  if (fd >= 0) ::close(fd);
+}
+
+bool SocketCanReader::open(const QString &device, int timeout_ms) {
+#ifdef __linux__
+  fd = socket(PF_CAN, SOCK_RAW | SOCK_CLOEXEC, CAN_RAW);
+  if (fd < 0) return false;
+
+  // classic frames still arrive as CAN_MTU sized reads with FD enabled
+  const int enable = 1;
+  setsockopt(fd, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable));
+  const int timestamping = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+  setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &timestamping, sizeof(timestamping));
+  // recvmmsg blocks until this timeout, so the stream thread can notice interruption requests
+  timeval tv = {.tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  ifreq ifr = {};
+  strncpy(ifr.ifr_name, device.toStdString().c_str(), IFNAMSIZ - 1);
+  sockaddr_can addr = {.can_family = AF_CAN};
+  if (ioctl(fd, SIOCGIFINDEX, &ifr) < 0 || (addr.can_ifindex = ifr.ifr_ifindex, bind(fd, (sockaddr *)&addr, sizeof(addr))) < 0) {
+    ::close(fd);
+    fd = -1;
+    return false;
   }
 
-  qDebug() << "Connecting to SocketCAN device" << config.device;
-  if (!connect()) {
-    throw std::runtime_error("Failed to connect to SocketCAN device");
+  for (int i = 0; i < SOCKETCAN_BATCH_SIZE; ++i) {
+    buffers->iov[i] = {.iov_base = &buffers->frames[i], .iov_len = sizeof(canfd_frame)};
+    buffers->msgs[i].msg_hdr = {.msg_iov = &buffers->iov[i], .msg_iovlen = 1};
   }
+  frames.reserve(SOCKETCAN_BATCH_SIZE);
+  // kernel timestamps are CLOCK_REALTIME, they are moved onto the boot clock the other streams use
+  boot_offset = nanos_since_boot() - nanos_since_epoch();
+  return true;
+#else
+  return false;
+#endif
 }
 
-bool SocketCanStream::available() {
-  return QCanBus::instance()->plugins().contains("socketcan");
+const std::vector<CanFrame> &SocketCanReader::read() {
+  frames.clear();
+#ifdef __linux__
+  for (int i = 0; i < SOCKETCAN_BATCH_SIZE; ++i) {
+    buffers->msgs[i].msg_hdr.msg_control = buffers->control[i];
+    buffers->msgs[i].msg_hdr.msg_controllen = sizeof(buffers->control[i]);
+  }
+  const int n = recvmmsg(fd, buffers->msgs, SOCKETCAN_BATCH_SIZE, MSG_WAITFORONE, nullptr);
+  if (n <= 0) return frames;
+
+  for (int i = 0; i < n; ++i) {
+    const canfd_frame &f = buffers->frames[i];
+    msghdr &hdr = buffers->msgs[i].msg_hdr;
+    if ((buffers->msgs[i].msg_len != CAN_MTU && buffers->msgs[i].msg_len != CANFD_MTU) || (f.can_id & (CAN_ERR_FLAG | CAN_RTR_FLAG))) {
+      continue;
+    }
+
+    uint64_t mono_time = 0;
+    for (cmsghdr *c = CMSG_FIRSTHDR(&hdr); c; c = CMSG_NXTHDR(&hdr, c)) {
+      if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SO_TIMESTAMPING) {
+        const auto *ts = (const scm_timestamping *)CMSG_DATA(c);
+        mono_time = ts->ts[0].tv_sec * 1000000000ULL + ts->ts[0].tv_nsec + boot_offset;
+      }
+    }
+    frames.push_back({
+      .mono_time = mono_time ? mono_time : nanos_since_boot(),
+      .address = f.can_id & ((f.can_id & CAN_EFF_FLAG) ? CAN_EFF_MASK : CAN_SFF_MASK),
+      .src = 0,
+      .size = std::min<uint8_t>(f.len, CANFD_MAX_DLEN),
+      .dat = f.data,
+    });
+  }
+#endif
+  return frames;
 }
 
-bool SocketCanStream::connect() {
-  // Connecting might generate some warnings about missing socketcan/libsocketcan libraries
-  // These are expected and can be ignored, we don't need the advanced features of libsocketcan
-  QString errorString;
-  device.reset(QCanBus::instance()->createDevice("socketcan", config.device, &errorString));
+QStringList SocketCanReader::devices() {
+  // interfaces of type ARPHRD_CAN
+  QStringList devices;
+  for (const auto &name : QDir("/sys/class/net").entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+    QFile type("/sys/class/net/" + name + "/type");
+    if (type.open(QIODevice::ReadOnly) && type.readAll().trimmed() == "280") {
+      devices.push_back(name);
+    }
+  }
+  return devices;
+}
 
-  if (!device) {
-    qDebug() << "Failed to create SocketCAN device" << errorString;
-    return false;
+SocketCanStream::SocketCanStream(QObject *parent, SocketCanStreamConfig config_) : config(config_), LiveStream(parent) {
+  if (!available()) {
+    throw std::runtime_error("SocketCAN not available");
   }
 
-  if (!device->connectDevice()) {
-    qDebug() << "Failed to connect to device";
-    return false;
+  qDebug() << "Connecting to SocketCAN device" << config.device;
+  if (!reader.open(config.device)) {
+    throw std::runtime_error("Failed to connect to SocketCAN device");
   }
+}
 
-  return true;
+bool SocketCanStream::available() {
+#ifdef __linux__
+  int fd = socket(PF_CAN, SOCK_RAW | SOCK_CLOEXEC, CAN_RAW);
+  if (fd >= 0) ::close(fd);
+  return fd >= 0;
+#else
+  return false;
+#endif
 }
 
 void SocketCanStream::streamThread() {
   while (!QThread::currentThread()->isInterruptionRequested()) {
-    QThread::msleep(1);
-
-    auto frames = device->readAllFrames();
-    if (frames.size() == 0) continue;
-
-    MessageBuilder msg;
-    auto evt = msg.initEvent();
-    auto canData = evt.initCan(frames.size());
-
-    for (uint i = 0; i < frames.size(); i++) {
-      if (!frames[i].isValid()) continue;
-
-      canData[i].setAddress(frames[i].frameId());
-      canData[i].setSrc(0);
-
-      auto payload = frames[i].payload();
-      canData[i].setDat(kj::arrayPtr((uint8_t*)payload.data(), payload.size()));
-    }
-
-    handleEvent(capnp::messageToFlatArray(msg));
+    handleFrames(reader.read());
   }
 }
 
@@ -98,9 +188,7 @@ OpenSocketCanWidget::OpenSocketCanWidget(AbstractStream **stream) : AbstractOpen
 
 void OpenSocketCanWidget::refreshDevices() {
   device_edit->clear();
-  for (auto device : QCanBus::instance()->availableDevices(QStringLiteral("socketcan"))) {
-    device_edit->addItem(device.name());
-  }
+  device_edit->addItems(SocketCanReader::devices());
 }
 
 
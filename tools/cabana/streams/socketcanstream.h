@@ -1,10 +1,8 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
-#include <QtSerialBus/QCanBus>
-#include <QtSerialBus/QCanBusDevice>
-#include <QtSerialBus/QCanBusDeviceInfo>
 #include <QComboBox>
 
 #include "tools/cabana/streams/livestream.h"
@@ -13,6 +11,26 @@ struct SocketCanStreamConfig {
   QString device = ""; // TODO: support multiple devices/buses at once
 };
 
+// Raw AF_CAN socket with CAN-FD frames enabled. Frames are received in batches with
+// recvmmsg and stamped with the kernel receive time.
+class SocketCanReader {
+public:
+  SocketCanReader();
+  ~SocketCanReader();
+  bool open(const QString &device, int timeout_ms = 100);
+  // Blocks until at least one frame arrives or the timeout passes, and returns every frame
+  // queued so far (empty on timeout). The data stays valid until the next call.
+  const std::vector<CanFrame> &read();
+  static QStringList devices();
+
+private:
+  int fd = -1;
+  uint64_t boot_offset = 0;
+  struct Buffers;
+  std::unique_ptr<Buffers> buffers;
+  std::vector<CanFrame> frames;
+};
+
 class SocketCanStream : public LiveStream {
   Q_OBJECT
 public:
@@ -27,10 +45,9 @@ public:
 
 protected:
   void streamThread() override;
-  bool connect();
 
   SocketCanStreamConfig config = {};
-  std::unique_ptr<QCanBusDevice> device;
+  SocketCanReader reader;
 };
 
 class OpenSocketCanWidget : public AbstractOpenStreamWidget {
@@ -1,9 +1,31 @@
 
 #undef INFO
 #include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <zstd.h>
+
+#ifdef __linux__
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#endif
+
+#include <array>
+#include <thread>
 
 #include "catch2/catch.hpp"
+#include "common/timing.h"
 #include "tools/cabana/dbc/dbcmanager.h"
+#include "tools/cabana/settings.h"
+#include "tools/cabana/streams/abstractstream.h"
+#include "tools/cabana/streams/socketcanstream.h"
+#include "tools/cabana/utils/export.h"
+#include "tools/cabana/utils/util.h"
 
 const std::string TEST_RLOG_URL = "https://commadataci.blob.core.windows.net/openpilotci/0c94aa1e1296d7c6/2021-05-05--19-48-37/0/rlog.bz2";
 
@@ -155,3 +177,327 @@ TEST_CASE("parse_opendbc") {
   INFO(errors.join("\n").toStdString());
   REQUIRE(errors.empty());
 }
+
+TEST_CASE("MinMaxPyramid") {
+  std::vector<QPointF> vals;
+  for (int i = 0; i < 10000; ++i) {
+    vals.emplace_back(i / 100.0, std::sin(i / 50.0) * 100 + (i % 7));
+  }
+  auto range_minmax = [](const std::vector<QPointF> &pts) {
+    auto [lo, hi] = std::minmax_element(pts.begin(), pts.end(), [](auto &a, auto &b) { return a.y() < b.y(); });
+    return std::make_pair(lo->y(), hi->y());
+  };
+
+  MinMaxPyramid lod;
+  // build incrementally, as charts do while segments load
+  for (size_t from = 0; from < vals.size(); from += 1234) {
+    std::vector<QPointF> part(vals.begin(), vals.begin() + std::min(vals.size(), from + 1234));
+    lod.update(part, from);
+  }
+
+  std::vector<QPointF> out;
+  SECTION("exact when zoomed in") {
+    lod.decimate(vals, 100, 300, 400, out);
+    REQUIRE(out == std::vector<QPointF>(vals.begin() + 100, vals.begin() + 300));
+  }
+  SECTION("bounded and extrema preserving when zoomed out") {
+    lod.decimate(vals, 0, vals.size(), 500, out);
+    REQUIRE(out.size() <= 500);
+    REQUIRE(range_minmax(out) == range_minmax(vals));
+    REQUIRE(std::is_sorted(out.begin(), out.end(), [](auto &a, auto &b) { return a.x() < b.x(); }));
+
+    MinMaxPyramid rebuilt;
+    rebuilt.build(vals);
+    std::vector<QPointF> out2;
+    rebuilt.decimate(vals, 0, vals.size(), 500, out2);
+    REQUIRE(out == out2);
+  }
+}
+
+TEST_CASE("SignalValueCache") {
+  cabana::Signal sig;
+  sig.start_bit = 0;
+  sig.size = 8;
+  sig.is_signed = false;
+  sig.is_little_endian = true;
+  sig.min = 0;
+  sig.max = 255;
+  updateMsbLsb(sig);
+
+  std::vector<std::unique_ptr<uint8_t[]>> buffers;
+  std::vector<const CanEvent *> events;
+  auto add_events = [&](int count) {
+    for (int i = 0; i < count; ++i) {
+      auto &buf = buffers.emplace_back(new uint8_t[sizeof(CanEvent) + 8]());
+      auto e = (CanEvent *)buf.get();
+      e->mono_time = events.size();
+      e->size = 8;
+      e->dat[0] = events.size() % 256;
+      events.push_back(e);
+    }
+  };
+  auto check = [&](const SignalValueCache::Values &values) {
+    REQUIRE(values->size() == events.size());
+    for (size_t i = 0; i < events.size(); ++i) {
+      double value = 0;
+      sig.getValue(events[i]->dat, events[i]->size, &value);
+      REQUIRE((*values)[i] == value);
+    }
+  };
+
+  SignalValueCache cache;
+  const MessageId id = {.source = 0, .address = 0x100};
+  add_events(200000);  // more than one chunk
+  auto values = cache.get(id, &sig, events);
+  check(values);
+  REQUIRE(cache.get(id, &sig, events) == values);
+
+  // appended events extend the cached values, readers keep their snapshot
+  add_events(1000);
+  auto extended = cache.get(id, &sig, events);
+  check(extended);
+  REQUIRE(values->size() == 200000);
+
+  // a changed definition is decoded again
+  sig.factor = 2;
+  check(cache.get(id, &sig, events));
+}
+
+TEST_CASE("EventBuffer") {
+  EventBuffer buffer;
+  std::vector<CanEvent *> events;
+  for (uint64_t i = 0; i < 1000000; ++i) {  // several chunks
+    CanEvent *e = buffer.allocate(i, 8);
+    e->mono_time = i;
+    e->size = 8;
+    memcpy(e->dat, &i, sizeof(i));
+    events.push_back(e);
+  }
+
+  // events after the cutoff stay valid, and new events keep filling the last chunk
+  buffer.release(events.size() / 2);
+  for (uint64_t i = events.size() / 2; i < events.size(); ++i) {
+    uint64_t v;
+    memcpy(&v, events[i]->dat, sizeof(v));
+    REQUIRE((events[i]->mono_time == i && v == i));
+  }
+  buffer.release(UINT64_MAX);
+  CanEvent *e = buffer.allocate(events.size(), 8);
+  REQUIRE(events.back()->mono_time == events.size() - 1);
+  REQUIRE((uint8_t *)e > (uint8_t *)events.back());
+}
+
+const uint64_t SEC = 1e9;
+
+class TestLiveStream : public LiveStream {
+public:
+  TestLiveStream(QObject *parent) : LiveStream(parent) {}
+  QString routeName() const override { return "test"; }
+  using LiveStream::dropExpiredEvents;
+  using LiveStream::mergeReceivedEvents;
+  using LiveStream::pageIn;
+  using LiveStream::pageOut;
+
+  // 1 kHz of 64 byte frames in [begin_ts, end_ts), holding their mono_time
+  void receive(uint64_t begin_ts, uint64_t end_ts) {
+    std::vector<CanFrame> frames;
+    std::vector<std::array<uint8_t, 64>> dat((end_ts - begin_ts) / 1000000);
+    for (size_t i = 0; i < dat.size(); ++i) {
+      const uint64_t ts = begin_ts + i * 1000000;
+      memcpy(dat[i].data(), &ts, sizeof(ts));
+      frames.push_back({.mono_time = ts, .address = 0x100, .src = 0, .size = 64, .dat = dat[i].data()});
+    }
+    handleFrames(frames);
+  }
+
+protected:
+  void streamThread() override {}
+};
+
+TEST_CASE("LiveStream retention") {
+  settings.max_cached_minutes = 1;
+  settings.log_livestream = false;
+  QObject parent;
+  auto stream = new TestLiveStream(&parent);
+
+  // every event in memory is intact, and the events in [begin_ts, end_ts) are all there
+  auto check_events = [&](uint64_t begin_ts, uint64_t end_ts) {
+    const auto &events = stream->allEvents();
+    for (auto e : events) {
+      uint64_t v;
+      memcpy(&v, e->dat, sizeof(v));
+      REQUIRE((e->address == 0x100 && e->size == 64 && v == e->mono_time));
+    }
+    auto first = std::lower_bound(events.cbegin(), events.cend(), begin_ts, CompareCanEvent());
+    auto last = std::lower_bound(first, events.cend(), end_ts, CompareCanEvent());
+    REQUIRE((uint64_t)(last - first) == (end_ts - begin_ts) / 1000000);
+    REQUIRE(stream->events({.source = 0, .address = 0x100}).size() == events.size());
+  };
+
+  // same steps as the update timer, several event buffer chunks are released on the way
+  for (uint64_t sec = 1; sec <= 300; ++sec) {
+    stream->receive(sec * SEC, (sec + 1) * SEC);
+    stream->mergeReceivedEvents();
+    stream->dropExpiredEvents();
+  }
+  const uint64_t front_ts = stream->allEvents().front()->mono_time;
+  REQUIRE(front_ts >= 235 * SEC);  // less than 1.1 windows
+  REQUIRE(front_ts <= 241 * SEC);
+  check_events(front_ts, 301 * SEC);
+
+  SECTION("unmerged frames are dropped before their chunk is released") {
+    stream->receive(301 * SEC, 330 * SEC);
+    stream->mergeReceivedEvents();
+    stream->receive(front_ts - SEC, front_ts);  // late, and before the spilled time
+    stream->receive(330 * SEC, 400 * SEC);
+    stream->dropExpiredEvents();
+    stream->mergeReceivedEvents();
+    const uint64_t cutoff = 330 * SEC - 1000000 - 60 * SEC;
+    REQUIRE(stream->allEvents().front()->mono_time == cutoff);
+    check_events(cutoff, 400 * SEC);
+  }
+
+  SECTION("spilled events are paged back in and out") {
+    const size_t in_memory = stream->allEvents().size();
+    stream->pageIn(100 * SEC);
+    check_events(70 * SEC, 130 * SEC);  // half a window around ts
+    check_events(front_ts, 301 * SEC);
+    REQUIRE(stream->allEvents().size() == in_memory + 60000);
+
+    stream->pageIn(10 * SEC);
+    check_events(1 * SEC, 40 * SEC);
+    REQUIRE(stream->allEvents().front()->mono_time == 1 * SEC);
+    REQUIRE(stream->allEvents().size() == in_memory + 39000);
+
+    stream->pageOut();
+    REQUIRE(stream->allEvents().front()->mono_time == front_ts);
+    REQUIRE(stream->allEvents().size() == in_memory);
+  }
+}
+
+TEST_CASE("writeColumnar") {
+  cabana::Signal sig;
+  sig.name = "SPEED";
+  sig.start_bit = 7;
+  sig.size = 16;
+  sig.is_signed = false;
+  sig.is_little_endian = false;
+  sig.factor = 0.01;
+  sig.min = 0;
+  sig.max = 655.35;
+  updateMsbLsb(sig);
+
+  const int rows = utils::COLUMNAR_ROW_GROUP_SIZE * 2 + 100;  // more than one row group
+  std::vector<std::unique_ptr<uint8_t[]>> buffers;
+  utils::ColumnarTable table = {.id = {.source = 0, .address = 0x123}, .name = "WHEEL_SPEEDS"};
+  for (int i = 0; i < rows; ++i) {
+    auto &buf = buffers.emplace_back(new uint8_t[sizeof(CanEvent) + 8]());
+    auto e = (CanEvent *)buf.get();
+    e->mono_time = 1e9 + i * 1e7;
+    e->size = 8;
+    e->dat[0] = (i >> 8) & 0xff;
+    e->dat[1] = i & 0xff;
+    table.events.push_back(e);
+  }
+  table.sigs.push_back({sig, std::nullopt});
+
+  const QString fn = QDir::tempPath() + "/test_cabana_columnar.cabcol";
+  REQUIRE(utils::writeColumnar(fn, {table}, 1e9));
+
+  QFile file(fn);
+  REQUIRE(file.open(QIODevice::ReadOnly));
+  const QByteArray data = file.readAll();
+  REQUIRE(data.startsWith("CABCOL01"));
+  REQUIRE(data.endsWith("CABCOL01"));
+  uint64_t footer_size = 0;
+  memcpy(&footer_size, data.data() + data.size() - 16, sizeof(footer_size));
+  auto footer = QJsonDocument::fromJson(data.mid(data.size() - 16 - footer_size, footer_size)).object();
+
+  auto t = footer["tables"].toArray()[0].toObject();
+  REQUIRE(t["name"].toString() == "WHEEL_SPEEDS");
+  REQUIRE(t["rows"].toInt() == rows);
+  auto columns = t["columns"].toArray();
+  REQUIRE(columns.size() == 2);
+
+  auto read_column = [&](const QJsonObject &column) {
+    std::vector<double> values;
+    for (auto chunk : column["chunks"].toArray()) {
+      auto c = chunk.toObject();
+      std::vector<double> v(c["rows"].toInt());
+      size_t size = ZSTD_decompress(v.data(), v.size() * sizeof(double), data.data() + c["offset"].toInt(), c["size"].toInt());
+      REQUIRE(size == v.size() * sizeof(double));
+      values.insert(values.end(), v.begin(), v.end());
+    }
+    return values;
+  };
+  auto time = read_column(columns[0].toObject());
+  auto speed = read_column(columns[1].toObject());
+  REQUIRE(time.size() == rows);
+  REQUIRE(speed.size() == rows);
+  for (int i = 0; i < rows; ++i) {
+    REQUIRE(time[i] == Approx(i * 0.01));
+    REQUIRE(speed[i] == Approx((i & 0xffff) * 0.01));
+  }
+  file.remove();
+}
+
+#ifdef __linux__
+// needs a virtual CAN interface with FD enabled:
+//   ip link add dev vcan0 type vcan && ip link set vcan0 mtu 72 && ip link set up vcan0
+TEST_CASE("SocketCanReader") {
+  SocketCanReader reader;
+  if (!reader.open("vcan0")) {
+    WARN("vcan0 not available, skipping");
+    return;
+  }
+
+  int tx = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+  REQUIRE(tx >= 0);
+  const int enable = 1;
+  setsockopt(tx, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable));
+  ifreq ifr = {};
+  strcpy(ifr.ifr_name, "vcan0");
+  REQUIRE(ioctl(tx, SIOCGIFINDEX, &ifr) == 0);
+  sockaddr_can addr = {.can_family = AF_CAN, .can_ifindex = ifr.ifr_ifindex};
+  REQUIRE(bind(tx, (sockaddr *)&addr, sizeof(addr)) == 0);
+
+  // 20k frames in 1s, alternating classic, extended id and FD frames
+  const int num_frames = 20000;
+  auto make_frame = [](int i) {
+    canfd_frame f = {};
+    f.can_id = i % 3 == 1 ? (0x18daf100 + i % 256) | CAN_EFF_FLAG : i % 0x7ff;
+    f.len = i % 3 == 2 ? 64 : 8;
+    for (int j = 0; j < f.len; ++j) f.data[j] = i + j;
+    return f;
+  };
+  const uint64_t start_ts = nanos_since_boot();
+  std::thread generator([&]() {
+    for (int i = 0; i < num_frames; ++i) {
+      canfd_frame f = make_frame(i);
+      while (write(tx, &f, f.len == 8 ? CAN_MTU : CANFD_MTU) < 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));  // ENOBUFS
+      }
+      if (i % 100 == 99) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  });
+
+  int received = 0;
+  uint64_t last_ts = 0;
+  while (received < num_frames && nanos_since_boot() - start_ts < 10e9) {
+    for (const CanFrame &f : reader.read()) {
+      const canfd_frame expected = make_frame(received++);
+      REQUIRE(f.address == (expected.can_id & CAN_EFF_MASK));
+      REQUIRE(f.size == expected.len);
+      REQUIRE(memcmp(f.dat, expected.data, f.size) == 0);
+      REQUIRE(f.mono_time >= last_ts);
+      last_ts = f.mono_time;
+    }
+  }
+  generator.join();
+  close(tx);
+
+  REQUIRE(received == num_frames);
+  REQUIRE(last_ts >= start_ts);
+  REQUIRE(last_ts <= nanos_since_boot());
+}
+#endif
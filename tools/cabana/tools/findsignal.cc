@@ -1,5 +1,10 @@
 #include "tools/cabana/tools/findsignal.h"
 
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+
 #include <QFormLayout>
 #include <QHBoxLayout>
 #include <QHeaderView>
@@ -29,30 +34,46 @@ QVariant FindSignalModel::data(const QModelIndex &index, int role) const {
 }
 
 void FindSignalModel::search(std::function<bool(double)> cmp) {
-  beginResetModel();
-
-  std::mutex lock;
   const auto prev_sigs = !histories.isEmpty() ? histories.back() : initial_signals;
-  filtered_signals.clear();
-  filtered_signals.reserve(prev_sigs.size());
-  QtConcurrent::blockingMap(prev_sigs, [&](auto &s) {
-    const auto &events = can->events(s.id);
-    auto first = std::upper_bound(events.cbegin(), events.cend(), s.mono_time, CompareCanEvent());
+
+  // partition the candidates by message, so the events of a message are looked up once
+  std::map<MessageId, std::vector<int>> msg_sigs;
+  for (int i = 0; i < prev_sigs.size(); ++i) {
+    msg_sigs[prev_sigs[i].id].push_back(i);
+  }
+  std::vector<std::pair<MessageId, std::vector<int>>> partitions(msg_sigs.begin(), msg_sigs.end());
+
+  std::vector<std::optional<SearchSignal>> found(prev_sigs.size());
+  // the workers read the events while the progress dialog keeps the stream running
+  auto hold = can->holdEvents();
+  bool finished = utils::mapWithProgress(qobject_cast<QWidget *>(QObject::parent()), tr("Finding signals..."), partitions, [&](auto &partition) {
+    const auto &events = can->events(partition.first);
     auto last = events.cend();
     if (last_time < std::numeric_limits<uint64_t>::max()) {
       last = std::upper_bound(events.cbegin(), events.cend(), last_time, CompareCanEvent());
     }
 
-    auto it = std::find_if(first, last, [&](const CanEvent *e) { return cmp(get_raw_value(e->dat, e->size, s.sig)); });
-    if (it != last) {
-      auto values = s.values;
-      values += QString("(%1, %2)").arg((*it)->mono_time / 1e9 - can->routeStartTime(), 0, 'f', 2).arg(get_raw_value((*it)->dat, (*it)->size, s.sig));
-      std::lock_guard lk(lock);
-      filtered_signals.push_back({.id = s.id, .mono_time = (*it)->mono_time, .sig = s.sig, .values = values});
+    for (int i : partition.second) {
+      const auto &s = prev_sigs[i];
+      auto first = std::upper_bound(events.cbegin(), last, s.mono_time, CompareCanEvent());
+      auto it = std::find_if(first, last, [&](const CanEvent *e) { return cmp(get_raw_value(e->dat, e->size, s.sig)); });
+      if (it != last) {
+        auto values = s.values;
+        values += QString("(%1, %2)").arg((*it)->mono_time / 1e9 - can->routeStartTime(), 0, 'f', 2).arg(get_raw_value((*it)->dat, (*it)->size, s.sig));
+        found[i] = SearchSignal{.id = s.id, .mono_time = (*it)->mono_time, .sig = s.sig, .values = values};
+      }
     }
   });
-  histories.push_back(filtered_signals);
 
+  beginResetModel();
+  if (finished) {
+    filtered_signals.clear();
+    filtered_signals.reserve(prev_sigs.size());
+    for (auto &s : found) {
+      if (s) filtered_signals.push_back(*s);
+    }
+    histories.push_back(filtered_signals);
+  }
   endResetModel();
 }
 
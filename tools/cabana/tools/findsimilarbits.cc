@@ -1,6 +1,11 @@
 #include "tools/cabana/tools/findsimilarbits.h"
 
 #include <algorithm>
+#include <array>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <vector>
 
 #include <QGridLayout>
 #include <QHeaderView>
@@ -114,47 +119,134 @@ void FindSimilarBitsDlg::find() {
   search_btn->setEnabled(true);
 }
 
+namespace {
+
+// Bit-sliced (vertical) counters: counts the set bits of each of the 64 positions of the words
+// added, using a few logic ops per word instead of a loop over the bits.
+struct BitSlicedCounter {
+  static constexpr int PLANES = 16;
+  uint64_t planes[PLANES] = {};
+  uint32_t pending = 0;
+  std::array<uint32_t, 64> counts = {};
+
+  inline void add(uint64_t w) {
+    for (int p = 0; w && p < PLANES; ++p) {
+      const uint64_t carry = planes[p] & w;
+      planes[p] ^= w;
+      w = carry;
+    }
+    if (++pending == (1u << PLANES) - 1) flush();
+  }
+  void flush() {
+    for (int b = 0; b < 64; ++b) {
+      uint32_t v = 0;
+      for (int p = 0; p < PLANES; ++p) v |= ((planes[p] >> b) & 1) << p;
+      counts[b] += v;
+    }
+    std::fill(std::begin(planes), std::end(planes), 0);
+    pending = 0;
+  }
+};
+
+struct AddressBits {
+  uint32_t total = 0;      // all frames on the find bus
+  uint32_t max_size = 0;   // largest frame compared with the source bit
+  // indexed by the value of the source bit at the time of the frame
+  std::array<std::array<uint32_t, 65>, 2> size_count = {};  // compared frames by size
+  std::array<std::vector<BitSlicedCounter>, 2> ones;       // set bits per 64-bit word of the frame
+
+  void merge(AddressBits &other) {
+    total += other.total;
+    max_size = std::max(max_size, other.max_size);
+    for (int t = 0; t < 2; ++t) {
+      for (int i = 0; i < 65; ++i) size_count[t][i] += other.size_count[t][i];
+      ones[t].resize(std::max(ones[t].size(), other.ones[t].size()));
+      for (int w = 0; w < other.ones[t].size(); ++w) {
+        other.ones[t][w].flush();
+        for (int b = 0; b < 64; ++b) ones[t][w].counts[b] += other.ones[t][w].counts[b];
+      }
+    }
+  }
+};
+
+struct Chunk {
+  size_t begin, end;
+  int bit_to_find;  // source bit before the first event of the chunk
+  std::unordered_map<uint32_t, AddressBits> addresses;
+};
+
+}  // namespace
+
 QList<FindSimilarBitsDlg::mismatched_struct> FindSimilarBitsDlg::calcBits(uint8_t bus, uint32_t selected_address, int byte_idx,
                                                                           int bit_idx, uint8_t find_bus, bool equal, int min_msgs_cnt) {
-  QHash<uint32_t, QVector<uint32_t>> mismatches;
-  QHash<uint32_t, uint32_t> msg_count;
+  // the workers read the events while the progress dialog keeps the stream running
+  auto hold = can->holdEvents();
   const auto &events = can->allEvents();
+  auto source_bit = [=](const CanEvent *e) -> int {
+    return e->src == bus && e->address == selected_address && e->size > byte_idx ? ((e->dat[byte_idx] >> (7 - bit_idx)) & 1) : -1;
+  };
+
+  // split the route in time ordered chunks, each starting with the source bit in effect
+  const size_t CHUNK_SIZE = 256 * 1024;
+  std::vector<Chunk> chunks;
   int bit_to_find = -1;
-  for (const CanEvent *e : events) {
-    if (e->src == bus) {
-      if (e->address == selected_address && e->size > byte_idx) {
-        bit_to_find = ((e->dat[byte_idx] >> (7 - bit_idx)) & 1) != 0;
-      }
-    }
-    if (e->src == find_bus) {
-      ++msg_count[e->address];
+  for (size_t i = 0; i < events.size(); ++i) {
+    if (i % CHUNK_SIZE == 0) chunks.push_back({.begin = i, .end = std::min(events.size(), i + CHUNK_SIZE), .bit_to_find = bit_to_find});
+    if (int bit = source_bit(events[i]); bit != -1) bit_to_find = bit;
+  }
+
+  bool finished = utils::mapWithProgress(this, tr("Finding similar bits..."), chunks, [&](Chunk &c) {
+    int bit_to_find = c.bit_to_find;
+    for (size_t i = c.begin; i < c.end; ++i) {
+      const CanEvent *e = events[i];
+      if (int bit = source_bit(e); bit != -1) bit_to_find = bit;
+      if (e->src != find_bus) continue;
+
+      auto &a = c.addresses[e->address];
+      ++a.total;
       if (bit_to_find == -1) continue;
 
-      auto &mismatched = mismatches[e->address];
-      if (mismatched.size() < e->size * 8) {
-        mismatched.resize(e->size * 8);
-      }
-      for (int i = 0; i < e->size; ++i) {
-        for (int j = 0; j < 8; ++j) {
-          int bit = ((e->dat[i] >> (7 - j)) & 1) != 0;
-          mismatched[i * 8 + j] += equal ? (bit != bit_to_find) : (bit == bit_to_find);
-        }
+      a.max_size = std::max<uint32_t>(a.max_size, e->size);
+      ++a.size_count[bit_to_find][e->size];
+      auto &ones = a.ones[bit_to_find];
+      if (ones.size() * 8 < e->size) ones.resize((e->size + 7) / 8);
+      for (int w = 0; w * 8 < e->size; ++w) {
+        uint64_t word = 0;
+        memcpy(&word, e->dat + w * 8, std::min(8, e->size - w * 8));
+        ones[w].add(word);
       }
     }
+  });
+  if (!finished) return {};
+
+  std::map<uint32_t, AddressBits> addresses;
+  for (auto &c : chunks) {
+    for (auto &[address, bits] : c.addresses) addresses[address].merge(bits);
   }
 
   QList<mismatched_struct> result;
-  result.reserve(mismatches.size());
-  for (auto it = mismatches.begin(); it != mismatches.end(); ++it) {
-    if (auto cnt = msg_count[it.key()]; cnt > min_msgs_cnt) {
-      auto &mismatched = it.value();
-      for (int i = 0; i < mismatched.size(); ++i) {
-        if (float perc = (mismatched[i] / (double)cnt) * 100; perc < 50) {
-          result.push_back({it.key(), (uint32_t)i / 8, (uint32_t)i % 8, mismatched[i], cnt, perc});
-        }
+  for (auto &[address, a] : addresses) {
+    const uint32_t cnt = a.total;
+    if (a.max_size == 0 || cnt <= min_msgs_cnt) continue;
+
+    for (int t = 0; t < 2; ++t) {
+      // number of compared frames long enough to contain each byte
+      for (int size = 63; size >= 0; --size) a.size_count[t][size] += a.size_count[t][size + 1];
+    }
+    for (uint32_t i = 0; i < a.max_size * 8; ++i) {
+      const int byte = i / 8, word_bit = byte % 8 * 8 + (7 - i % 8);
+      uint32_t mismatched = 0;
+      for (int t = 0; t < 2; ++t) {
+        const uint32_t frames = a.size_count[t][byte + 1];
+        const uint32_t ones = byte / 8 < a.ones[t].size() ? a.ones[t][byte / 8].counts[word_bit] : 0;
+        // equal: a mismatch is a bit that differs from the source bit, otherwise one that matches it
+        mismatched += (t == 1) == equal ? frames - ones : ones;
+      }
+      if (float perc = (mismatched / (double)cnt) * 100; perc < 50) {
+        result.push_back({address, i / 8, i % 8, mismatched, cnt, perc});
       }
     }
   }
-  std::sort(result.begin(), result.end(), [](auto &l, auto &r) { return l.perc < r.perc; });
+  std::stable_sort(result.begin(), result.end(), [](auto &l, auto &r) { return l.perc < r.perc; });
   return result;
 }
@@ -1,7 +1,22 @@
 #include "tools/cabana/utils/export.h"
 
+#include <zstd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <thread>
+
 #include <QFile>
+#include <QFutureWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProgressDialog>
 #include <QTextStream>
+#include <QtConcurrent>
 
 #include "tools/cabana/streams/abstractstream.h"
 
@@ -30,18 +45,184 @@ void exportSignalsToCSV(const QString &file_name, const MessageId &msg_id) {
       stream << "," << s->name;
     stream << "\n";
 
+    std::vector<SignalValueCache::Values> values;
+    for (auto s : msg->sigs)
+      values.push_back(can->signalValues(msg_id, s));
+
     const uint64_t start_time = can->routeStartTime();
-    for (auto e : can->events(msg_id)) {
+    const auto &events = can->events(msg_id);
+    for (size_t i = 0; i < events.size(); ++i) {
+      auto e = events[i];
       stream << QString::number((e->mono_time / 1e9) - start_time, 'f', 2) << ","
              << "0x" << QString::number(e->address, 16) << "," << e->src;
-      for (auto s : msg->sigs) {
-        double value = 0;
-        s->getValue(e->dat, e->size, &value);
-        stream << "," << QString::number(value, 'f', s->precision);
+      for (size_t j = 0; j < msg->sigs.size(); ++j) {
+        const double value = (*values[j])[i];
+        stream << "," << QString::number(std::isnan(value) ? 0 : value, 'f', msg->sigs[j]->precision);
       }
       stream << "\n";
     }
   }
 }
 
+namespace {
+
+const char COLUMNAR_MAGIC[] = "CABCOL01";
+// upper bound in seconds of the export range, from the int64 nanosecond range, so open-ended
+// ranges (end_sec defaults to double max) convert to a mono time without overflow
+const double MAX_TIME_SEC = std::numeric_limits<int64_t>::max() / 1e9;
+
+struct ColumnChunk {
+  int table, group;
+  std::vector<std::string> columns;  // compressed time column followed by the signal columns
+};
+
+std::string compressColumn(const std::vector<double> &values) {
+  std::string out(ZSTD_compressBound(values.size() * sizeof(double)), '\0');
+  size_t size = ZSTD_compress(out.data(), out.size(), values.data(), values.size() * sizeof(double), 3);
+  assert(!ZSTD_isError(size));
+  out.resize(size);
+  return out;
+}
+
+ColumnChunk encodeChunk(const std::vector<ColumnarTable> &tables, int table, int group, uint64_t route_start_mono_time) {
+  const auto &t = tables[table];
+  const size_t begin = (size_t)group * COLUMNAR_ROW_GROUP_SIZE;
+  const size_t end = std::min(t.events.size(), begin + COLUMNAR_ROW_GROUP_SIZE);
+
+  ColumnChunk chunk = {.table = table, .group = group};
+  std::vector<double> values(end - begin);
+  for (size_t i = begin; i < end; ++i) {
+    values[i - begin] = (t.events[i]->mono_time - std::min(t.events[i]->mono_time, route_start_mono_time)) / 1e9;
+  }
+  chunk.columns.push_back(compressColumn(values));
+
+  for (const auto &[def, multiplexor] : t.sigs) {
+    // decode with the same Signal::getValue as the SignalValueCache, pointed at the copied multiplexor
+    cabana::Signal sig = def;
+    sig.multiplexor = multiplexor ? (cabana::Signal *)&*multiplexor : nullptr;
+    double value = 0;
+    for (size_t i = begin; i < end; ++i) {
+      const CanEvent *e = t.events[i];
+      values[i - begin] = sig.getValue(e->dat, e->size, &value) ? value : std::numeric_limits<double>::quiet_NaN();
+    }
+    chunk.columns.push_back(compressColumn(values));
+  }
+  return chunk;
+}
+
+}  // namespace
+
+std::vector<ColumnarTable> columnarTables(SignalSelection selection, double begin_sec, double end_sec) {
+  if (selection.empty()) {
+    for (const auto &[id, _] : can->eventsMap()) {
+      if (auto msg = dbc()->msg(id); msg && !msg->sigs.empty()) {
+        selection.push_back({id, {msg->sigs.begin(), msg->sigs.end()}});
+      }
+    }
+    std::sort(selection.begin(), selection.end(), [](auto &l, auto &r) { return l.first < r.first; });
+  }
+
+  std::vector<ColumnarTable> tables;
+  const uint64_t begin_ts = std::clamp(can->routeStartTime() + begin_sec, 0.0, MAX_TIME_SEC) * 1e9;
+  const uint64_t end_ts = std::clamp(can->routeStartTime() + end_sec, 0.0, MAX_TIME_SEC) * 1e9;
+  for (const auto &[id, sigs] : selection) {
+    const auto &events = can->events(id);
+    auto first = std::lower_bound(events.cbegin(), events.cend(), begin_ts, CompareCanEvent());
+    auto last = std::upper_bound(first, events.cend(), end_ts, CompareCanEvent());
+    if (first == last || sigs.empty()) continue;
+
+    auto &t = tables.emplace_back(ColumnarTable{.id = id, .name = msgName(id), .events = {first, last}});
+    for (auto sig : sigs) {
+      t.sigs.push_back({*sig, sig->multiplexor ? std::make_optional(*sig->multiplexor) : std::nullopt});
+    }
+  }
+  return tables;
+}
+
+bool writeColumnar(const QString &file_name, const std::vector<ColumnarTable> &tables, uint64_t route_start_mono_time,
+                   const std::atomic<bool> *abort, std::function<void(int percent)> progress) {
+  QFile file(file_name);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+  file.write(COLUMNAR_MAGIC, 8);
+
+  // row groups are encoded in parallel and written in order, a window at a time
+  std::vector<std::pair<int, int>> jobs;
+  QJsonArray json_tables;
+  for (int t = 0; t < tables.size(); ++t) {
+    const int groups = (tables[t].events.size() + COLUMNAR_ROW_GROUP_SIZE - 1) / COLUMNAR_ROW_GROUP_SIZE;
+    for (int g = 0; g < groups; ++g) jobs.push_back({t, g});
+
+    QJsonArray columns;
+    columns.append(QJsonObject{{"name", "time"}, {"unit", "s"}, {"chunks", QJsonArray()}});
+    for (const auto &[sig, _] : tables[t].sigs) {
+      columns.append(QJsonObject{{"name", sig.name}, {"unit", sig.unit}, {"chunks", QJsonArray()}});
+    }
+    json_tables.append(QJsonObject{{"name", tables[t].name}, {"source", tables[t].id.source}, {"address", (qint64)tables[t].id.address},
+                                   {"rows", (qint64)tables[t].events.size()}, {"columns", columns}});
+  }
+
+  const size_t window = std::max(2u, std::thread::hardware_concurrency()) * 2;
+  for (size_t i = 0; i < jobs.size(); i += window) {
+    if (abort && *abort) return false;
+
+    std::vector<std::future<ColumnChunk>> chunks;
+    for (size_t j = i; j < std::min(jobs.size(), i + window); ++j) {
+      chunks.push_back(std::async(std::launch::async, encodeChunk, std::cref(tables), jobs[j].first, jobs[j].second, route_start_mono_time));
+    }
+    for (auto &f : chunks) {
+      ColumnChunk chunk = f.get();
+      QJsonObject table = json_tables[chunk.table].toObject();
+      QJsonArray columns = table["columns"].toArray();
+      const qint64 rows = std::min<qint64>(COLUMNAR_ROW_GROUP_SIZE, tables[chunk.table].events.size() - (qint64)chunk.group * COLUMNAR_ROW_GROUP_SIZE);
+      for (int c = 0; c < chunk.columns.size(); ++c) {
+        QJsonObject column = columns[c].toObject();
+        QJsonArray column_chunks = column["chunks"].toArray();
+        column_chunks.append(QJsonObject{{"offset", file.pos()}, {"size", (qint64)chunk.columns[c].size()}, {"rows", rows}});
+        column["chunks"] = column_chunks;
+        columns[c] = column;
+        if (file.write(chunk.columns[c].data(), chunk.columns[c].size()) != chunk.columns[c].size()) return false;
+      }
+      table["columns"] = columns;
+      json_tables[chunk.table] = table;
+    }
+    if (progress) progress(std::min(jobs.size(), i + window) * 100 / jobs.size());
+  }
+
+  const QByteArray footer = QJsonDocument(QJsonObject{{"tables", json_tables}}).toJson(QJsonDocument::Compact);
+  const uint64_t footer_size = footer.size();
+  file.write(footer);
+  file.write((const char *)&footer_size, sizeof(footer_size));
+  file.write(COLUMNAR_MAGIC, 8);
+  return file.error() == QFileDevice::NoError;
+}
+
+bool exportToColumnar(QWidget *parent, const QString &file_name, const SignalSelection &selection, double begin_sec, double end_sec) {
+  // the signals are copied here, on the UI thread. The tables only point to the events, which
+  // stay in memory until the export is done, while the progress dialog keeps the stream running.
+  auto hold = can->holdEvents();
+  auto tables = columnarTables(selection, begin_sec, end_sec);
+  const uint64_t route_start_mono_time = can->routeStartTime() * 1e9;
+
+  QProgressDialog progress(QObject::tr("Exporting %1...").arg(file_name), QObject::tr("Cancel"), 0, 100, parent);
+  progress.setWindowModality(Qt::WindowModal);
+  std::atomic<bool> abort = false;
+  QFutureWatcher<bool> watcher;
+  QObject::connect(&watcher, &QFutureWatcher<bool>::finished, &progress, &QProgressDialog::reset);
+  QObject::connect(&progress, &QProgressDialog::canceled, [&abort]() { abort = true; });
+  watcher.setFuture(QtConcurrent::run([&]() {
+    return writeColumnar(file_name, tables, route_start_mono_time, &abort, [&progress](int percent) {
+      QMetaObject::invokeMethod(&progress, [&progress, percent]() { progress.setValue(percent); }, Qt::QueuedConnection);
+    });
+  }));
+  if (!watcher.isFinished()) {
+    progress.exec();
+  }
+  watcher.waitForFinished();
+  if (!watcher.result()) {
+    QFile::remove(file_name);
+    return false;
+  }
+  return true;
+}
+
 }  // namespace utils
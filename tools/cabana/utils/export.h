@@ -1,10 +1,50 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <limits>
 #include <optional>
+#include <utility>
+#include <vector>
+
+#include <QWidget>
 
 #include "tools/cabana/dbc/dbcmanager.h"
 
+struct CanEvent;
+
 namespace utils {
 void exportToCSV(const QString &file_name, std::optional<MessageId> msg_id = std::nullopt);
 void exportSignalsToCSV(const QString &file_name, const MessageId &msg_id);
+
+// Columnar export: one table per message with a "time" column (seconds since route start)
+// and one column per signal, all float64 (NaN where a multiplexed signal isn't present).
+//
+// File layout, integers little endian:
+//   "CABCOL01"
+//   column chunks, each a zstd frame of packed float64 values of up to COLUMNAR_ROW_GROUP_SIZE rows
+//   footer: JSON {"tables": [{"name", "source", "address", "rows",
+//                             "columns": [{"name", "unit", "chunks": [{"offset", "size", "rows"}]}]}]}
+//   uint64 footer size, "CABCOL01"
+const int COLUMNAR_ROW_GROUP_SIZE = 64 * 1024;
+
+struct ColumnarTable {
+  MessageId id;
+  QString name;
+  std::vector<const CanEvent *> events;
+  // signal copies, so the export doesn't depend on the DBC while it runs
+  std::vector<std::pair<cabana::Signal, std::optional<cabana::Signal>>> sigs;  // (signal, multiplexor)
+};
+typedef std::vector<std::pair<MessageId, std::vector<const cabana::Signal *>>> SignalSelection;
+
+// Collect the events in [begin_sec, end_sec] of the selected signals. An empty selection
+// means all signals of all messages in the DBC.
+std::vector<ColumnarTable> columnarTables(SignalSelection selection, double begin_sec, double end_sec);
+// Decode in parallel and stream the tables to file_name. Callable from any thread.
+bool writeColumnar(const QString &file_name, const std::vector<ColumnarTable> &tables, uint64_t route_start_mono_time,
+                   const std::atomic<bool> *abort = nullptr, std::function<void(int percent)> progress = nullptr);
+// Export on a background thread while showing a cancelable progress dialog. Holds the stream's
+// events until the export is done.
+bool exportToColumnar(QWidget *parent, const QString &file_name, const SignalSelection &selection = {},
+                      double begin_sec = 0, double end_sec = std::numeric_limits<double>::max());
 }  // namespace utils
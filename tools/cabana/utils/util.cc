@@ -49,6 +49,79 @@ std::pair<double, double> SegmentTree::get_minmax(int n, int left, int right, in
   return {std::min(l.first, r.first), std::max(l.second, r.second)};
 }
 
+// MinMaxPyramid
+
+void MinMaxPyramid::update(const std::vector<QPointF> &arr, size_t from) {
+  if (arr.empty()) {
+    levels.clear();
+    return;
+  }
+
+  // level 0 summarizes the samples
+  if (levels.empty()) levels.emplace_back();
+  size_t bucket = std::min(from, arr.size() - 1) / BASE_BUCKET_SIZE;
+  levels[0].resize((arr.size() + BASE_BUCKET_SIZE - 1) / BASE_BUCKET_SIZE);
+  for (size_t b = bucket; b < levels[0].size(); ++b) {
+    uint32_t lo = b * BASE_BUCKET_SIZE, hi = lo;
+    for (size_t i = lo + 1; i < std::min(arr.size(), (b + 1) * BASE_BUCKET_SIZE); ++i) {
+      if (arr[i].y() < arr[lo].y()) lo = i;
+      if (arr[i].y() > arr[hi].y()) hi = i;
+    }
+    levels[0][b] = {lo, hi};
+  }
+
+  // each level above merges pairs of buckets below it, only the changed ones are recomputed
+  for (size_t l = 1; levels[l - 1].size() > 1; ++l) {
+    if (l == levels.size()) levels.emplace_back();
+    const auto &prev = levels[l - 1];
+    auto &level = levels[l];
+    bucket /= 2;
+    level.resize((prev.size() + 1) / 2);
+    for (size_t b = bucket; b < level.size(); ++b) {
+      auto [lo, hi] = prev[2 * b];
+      if (2 * b + 1 < prev.size()) {
+        auto [lo2, hi2] = prev[2 * b + 1];
+        if (arr[lo2].y() < arr[lo].y()) lo = lo2;
+        if (arr[hi2].y() > arr[hi].y()) hi = hi2;
+      }
+      level[b] = {lo, hi};
+    }
+  }
+  // drop levels left over from a longer series
+  while (levels.size() > 1 && levels[levels.size() - 2].size() <= 1) {
+    levels.pop_back();
+  }
+}
+
+void MinMaxPyramid::decimate(const std::vector<QPointF> &arr, size_t first, size_t last, size_t max_points, std::vector<QPointF> &out) const {
+  out.clear();
+  last = std::min(last, arr.size());
+  if (first >= last) return;
+
+  const size_t n = last - first;
+  if (n <= max_points || levels.empty()) {
+    out.assign(arr.begin() + first, arr.begin() + last);
+    return;
+  }
+
+  // the finest level that gives at most max_points / 2 buckets
+  size_t level = 0, bucket_size = BASE_BUCKET_SIZE;
+  while (level + 1 < levels.size() && (n / bucket_size) * 2 > max_points) {
+    ++level;
+    bucket_size *= 2;
+  }
+
+  const auto &buckets = levels[level];
+  const size_t end = std::min(buckets.size(), (last + bucket_size - 1) / bucket_size);
+  out.reserve((end - first / bucket_size) * 2);
+  for (size_t b = first / bucket_size; b < end; ++b) {
+    // keep the min and max in time order so lines are drawn through both
+    auto [lo, hi] = std::minmax(buckets[b].first, buckets[b].second);
+    out.push_back(arr[lo]);
+    if (hi != lo) out.push_back(arr[hi]);
+  }
+}
+
 // MessageBytesDelegate
 
 MessageBytesDelegate::MessageBytesDelegate(QObject *parent, bool multiple_lines)
@@ -10,13 +10,16 @@
 #include <QDoubleValidator>
 #include <QFont>
 #include <QFontMetrics>
+#include <QFutureWatcher>
 #include <QPainter>
+#include <QProgressDialog>
 #include <QRegExpValidator>
 #include <QSocketNotifier>
 #include <QStaticText>
 #include <QStringBuilder>
 #include <QStyledItemDelegate>
 #include <QToolButton>
+#include <QtConcurrent>
 
 #include "tools/cabana/dbc/dbc.h"
 #include "tools/cabana/settings.h"
@@ -65,6 +68,23 @@ private:
   int size = 0;
 };
 
+// Multi-resolution min/max summary of a series. Charts use it to hand QtCharts about two
+// points per pixel of the visible range, no matter how many samples the range holds.
+class MinMaxPyramid {
+public:
+  MinMaxPyramid() = default;
+  void build(const std::vector<QPointF> &arr) { levels.clear(); update(arr, 0); }
+  // Update after arr changed from index `from` on
+  void update(const std::vector<QPointF> &arr, size_t from);
+  // Points of arr[first, last) reduced to at most about max_points. Exact if the range has fewer points.
+  void decimate(const std::vector<QPointF> &arr, size_t first, size_t last, size_t max_points, std::vector<QPointF> &out) const;
+
+private:
+  static constexpr size_t BASE_BUCKET_SIZE = 4;
+  // indices of the (min, max) sample of each bucket; bucket size doubles every level
+  std::vector<std::vector<std::pair<uint32_t, uint32_t>>> levels;
+};
+
 class MessageBytesDelegate : public QStyledItemDelegate {
   Q_OBJECT
 public:
@@ -109,6 +129,25 @@ inline QString toHex(const std::vector<uint8_t> &dat, char separator = '\0') {
   return QByteArray::fromRawData((const char *)dat.data(), dat.size()).toHex(separator).toUpper();
 }
 
+// Run fn on every item of sequence on the global thread pool, showing a cancelable
+// progress dialog while the UI keeps processing events. Returns false if canceled.
+template <typename Sequence, typename MapFunctor>
+bool mapWithProgress(QWidget *parent, const QString &label, Sequence &sequence, MapFunctor fn) {
+  QProgressDialog progress(label, QObject::tr("Cancel"), 0, sequence.size(), parent);
+  progress.setWindowModality(Qt::WindowModal);
+
+  QFutureWatcher<void> watcher;
+  QObject::connect(&watcher, &QFutureWatcher<void>::progressValueChanged, &progress, &QProgressDialog::setValue);
+  QObject::connect(&watcher, &QFutureWatcher<void>::finished, &progress, &QProgressDialog::reset);
+  QObject::connect(&progress, &QProgressDialog::canceled, &watcher, &QFutureWatcher<void>::cancel);
+  watcher.setFuture(QtConcurrent::map(sequence, fn));
+  if (!watcher.isFinished()) {
+    progress.exec();
+  }
+  watcher.waitForFinished();
+  return !watcher.isCanceled();
+}
+
 }
 
 class ToolButton : public QToolButton {
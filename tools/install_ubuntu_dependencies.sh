@@ -46,6 +46,7 @@ function install_ubuntu_common_requirements() {
     libssl-dev \
     libusb-1.0-0-dev \
     libzmq3-dev \
+    libzstd-dev \
     libsqlite3-dev \
     libsystemd-dev \
     locales \
@@ -58,7 +59,6 @@ function install_ubuntu_common_requirements() {
     qtpositioning5-dev \
     qttools5-dev-tools \
     libqt5svg5-dev \
-    libqt5serialbus5-dev  \
     libqt5x11extras5-dev \
     libqt5opengl5-dev
 }
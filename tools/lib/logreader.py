@@ -34,7 +34,7 @@ class _LogFileReader:
     ext = None
     if not dat:
       _, ext = os.path.splitext(urllib.parse.urlparse(fn).path)
-      if ext not in ('', '.bz2'):
+      if ext not in ('', '.bz2', '.zst'):
         # old rlogs weren't bz2 compressed
         raise Exception(f"unknown extension {ext}")
 
@@ -43,6 +43,9 @@ class _LogFileReader:
 
     if ext == ".bz2" or dat.startswith(b'BZh9'):
       dat = bz2.decompress(dat)
+    elif ext == ".zst" or dat.startswith(b'\x28\xb5\x2f\xfd'):
+      import zstandard
+      dat = zstandard.ZstdDecompressor().stream_reader(dat, read_across_frames=True).read()
 
     ents = capnp_log.Event.read_multiple_bytes(dat)
 
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""Convert msgq latency traces into a Perfetto-compatible JSON trace.
+
+Run the processes with MSGQ_TRACE=1. Every subscriber then logs the messages it
+dequeues into /dev/shm/[OPENPILOT_PREFIX/]msgq_trace_<pid>, which is kept after the
+process exits. Afterwards, run this script and open the output in ui.perfetto.dev.
+Once read, the buffers of processes that have exited are removed. For each hop, the
+trace shows:
+  * a "publish" slice on the publishing thread, with a flow arrow to the subscriber
+  * an async "queued" span from publish until the subscriber first saw it in msgq_poll
+  * a "dequeue" span from then until the subscriber actually received it
+A per-hop latency summary is also printed.
+"""
+import argparse
+import glob
+import json
+import os
+import struct
+from collections import defaultdict
+
+MAGIC = 0x5254514d
+VERSION = 1
+HEADER = struct.Struct("<IIIIQ16s24x")
+EVENT = struct.Struct("<QQQQQIIII32s")
+
+
+def read_buffer(path):
+  with open(path, "rb") as f:
+    dat = f.read()
+  if len(dat) < HEADER.size:
+    return None
+  magic, version, pid, capacity, _, comm = HEADER.unpack_from(dat)
+  if magic != MAGIC or version != VERSION:
+    return None
+
+  events = []
+  for i in range(capacity):
+    off = HEADER.size + i * EVENT.size
+    if off + EVENT.size > len(dat):
+      break
+    commit, publish, ready, dequeue, seq, pub_pid, pub_tid, sub_tid, size, endpoint = EVENT.unpack_from(dat, off)
+    if commit == 0 or (commit - 1) % capacity != i:
+      continue
+    events.append({
+      "endpoint": endpoint.split(b"\0", 1)[0].decode(), "seq": seq, "size": size,
+      "publish": publish, "ready": ready, "dequeue": dequeue,
+      "pub_pid": pub_pid, "pub_tid": pub_tid, "sub_pid": pid, "sub_tid": sub_tid,
+    })
+  return pid, comm.split(b"\0", 1)[0].decode(), events
+
+
+def process_name(pid, names):
+  if pid in names:
+    return names[pid]
+  try:
+    with open(f"/proc/{pid}/comm") as f:
+      return f.read().strip()
+  except OSError:
+    return f"pid {pid}"
+
+
+def to_us(ns):
+  return ns / 1e3
+
+
+def build_trace(buffers):
+  names = {pid: comm for pid, comm, _ in buffers}
+  events = [e for _, _, evts in buffers for e in evts]
+
+  trace = []
+  for pid in {e["sub_pid"] for e in events} | {e["pub_pid"] for e in events}:
+    trace.append({"ph": "M", "name": "process_name", "pid": pid, "args": {"name": process_name(pid, names)}})
+
+  for i, e in enumerate(events):
+    args = {"seq": e["seq"], "size": e["size"], "publisher": process_name(e["pub_pid"], names)}
+    hop = f"{e['pub_pid']}:{e['endpoint']}:{e['seq']}:{e['sub_pid']}:{e['sub_tid']}"
+    trace += [
+      {"ph": "X", "name": f"publish {e['endpoint']}", "cat": "msgq", "pid": e["pub_pid"], "tid": e["pub_tid"],
+       "ts": to_us(e["publish"]), "dur": 1, "bind_id": i, "flow_out": True, "args": args},
+      {"ph": "b", "name": f"{e['endpoint']} queued", "cat": "msgq", "id": hop, "pid": e["sub_pid"], "tid": e["sub_tid"],
+       "ts": to_us(e["publish"]), "args": args},
+      {"ph": "e", "name": f"{e['endpoint']} queued", "cat": "msgq", "id": hop, "pid": e["sub_pid"], "tid": e["sub_tid"],
+       "ts": to_us(e["ready"])},
+      {"ph": "X", "name": f"dequeue {e['endpoint']}", "cat": "msgq", "pid": e["sub_pid"], "tid": e["sub_tid"],
+       "ts": to_us(e["ready"]), "dur": max(to_us(e["dequeue"] - e["ready"]), 1), "bind_id": i, "flow_in": True, "args": args},
+    ]
+  return trace, events, names
+
+
+def print_summary(events, names):
+  hops = defaultdict(list)
+  for e in events:
+    hops[(e["endpoint"], process_name(e["pub_pid"], names), process_name(e["sub_pid"], names))].append(e)
+
+  print(f"{'service':<24} {'publisher -> subscriber':<36} {'msgs':>7} {'queued p50/p99/max ms':>24} {'dequeue p50/p99/max ms':>24}")
+  for (endpoint, pub, sub), evts in sorted(hops.items()):
+    queued = sorted((e["ready"] - e["publish"]) / 1e6 for e in evts)
+    dequeue = sorted((e["dequeue"] - e["ready"]) / 1e6 for e in evts)
+    fmt = lambda a: f"{a[len(a) // 2]:.2f}/{a[int(len(a) * 0.99)]:.2f}/{a[-1]:.2f}"
+    print(f"{endpoint:<24} {pub + ' -> ' + sub:<36} {len(evts):>7} {fmt(queued):>24} {fmt(dequeue):>24}")
+
+
+def remove_stale_buffers(paths):
+  for path in paths:
+    try:
+      os.kill(int(path.rsplit("_", 1)[1]), 0)
+    except ProcessLookupError:
+      os.unlink(path)
+    except (ValueError, PermissionError):
+      pass
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument("--prefix", default=os.environ.get("OPENPILOT_PREFIX"), help="msgq prefix the processes ran with")
+  parser.add_argument("-o", "--output", default="msgq_trace.json")
+  args = parser.parse_args()
+
+  shm = os.path.join("/dev/shm", args.prefix) if args.prefix else "/dev/shm"
+  paths = sorted(glob.glob(os.path.join(shm, "msgq_trace_*")))
+  buffers = [b for b in (read_buffer(p) for p in paths) if b is not None]
+  remove_stale_buffers(paths)
+  if not buffers:
+    print(f"no msgq trace buffers found in {shm}, run with MSGQ_TRACE=1")
+    return
+
+  trace, events, names = build_trace(buffers)
+  with open(args.output, "w") as f:
+    json.dump({"traceEvents": trace, "displayTimeUnit": "ms"}, f)
+  print(f"wrote {len(events)} messages from {len(buffers)} processes to {args.output}\n")
+  print_summary(events, names)
+
+
+if __name__ == "__main__":
+  main()
@@ -26,7 +26,7 @@ protected:
     int width;
     int height;
     std::thread thread;
-    SafeQueue<std::pair<FrameReader*, const Event *>> queue;
+    MpscQueue<std::pair<FrameReader*, const Event *>, 64> queue;
     std::set<VisionBuf *> cached_buf;
   };
   void startVipcServer();
@@ -1,19 +1,213 @@
 #include "tools/replay/filereader.h"
 
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <mutex>
+#include <vector>
 
+#include "common/timing.h"
 #include "common/util.h"
 #include "system/hardware/hw.h"
 #include "tools/replay/util.h"
 
-std::string cacheFilePath(const std::string &url) {
+namespace {
+
+std::atomic<uint64_t> cache_budget = (uint64_t)util::getenv("REPLAY_CACHE_BUDGET_MB", 20 * 1024) * 1024 * 1024;
+const double CACHE_SCAN_INTERVAL_MS = 60 * 1000;
+
+std::mutex eviction_lock;
+uint64_t cache_size_estimate = 0;
+double last_cache_scan_ms = 0;
+bool cache_scanned = false;
+
+const char CACHE_ENTRY_MAGIC[8] = {'R', 'P', 'L', 'C', 'A', 'C', 'H', 'E'};
+const uint64_t CACHE_ENTRY_VERSION = 2;
+
+struct CacheEntryHeader {
+  char magic[8];
+  uint64_t version;
+  uint64_t index_size;
+  uint64_t data_size;
+  uint64_t checksum;
+};
+
+// the index is padded so that the data stays word aligned for capnp
+inline size_t alignedIndexSize(size_t size) { return (size + 7) & ~size_t(7); }
+
+// Fast non-cryptographic checksum, enough to catch truncated or bit-rotted entries.
+uint64_t checksum(std::string_view s, uint64_t seed) {
+  constexpr uint64_t K = 0x9E3779B97F4A7C15ull;
+  uint64_t lanes[4] = {seed, seed ^ K, seed + K, seed - K};
+  size_t i = 0;
+  for (; i + 32 <= s.size(); i += 32) {
+    for (int j = 0; j < 4; ++j) {
+      uint64_t w;
+      memcpy(&w, s.data() + i + j * 8, sizeof(w));
+      lanes[j] = (lanes[j] ^ w) * K;
+      lanes[j] ^= lanes[j] >> 29;
+    }
+  }
+  for (; i < s.size(); ++i) {
+    lanes[0] = (lanes[0] ^ (uint8_t)s[i]) * K;
+  }
+  uint64_t h = s.size();
+  for (uint64_t l : lanes) {
+    h = (h ^ l) * K;
+    h ^= h >> 32;
+  }
+  return h;
+}
+
+// Replay keeps its files in a subdirectory of the shared download cache, so that the budget
+// and eviction never touch the chunk files other tools (tools/lib/url_file.py) keep there.
+const std::string &cacheRoot() {
   static std::string cache_path = [] {
-    const std::string comma_cache = Path::download_cache_root();
-    util::create_directories(comma_cache, 0755);
-    return comma_cache.back() == '/' ? comma_cache : comma_cache + "/";
+    std::string comma_cache = Path::download_cache_root();
+    if (comma_cache.back() != '/') comma_cache += "/";
+    const std::string replay_cache = comma_cache + "replay/";
+    util::create_directories(replay_cache, 0755);
+    return replay_cache;
   }();
+  return cache_path;
+}
+
+// Removes the least recently used files until the cache fits its budget and returns the
+// resulting size. Temporary files are skipped, they may belong to a write in progress in
+// another process. Must be called with eviction_lock held.
+uint64_t scanAndEvictCacheFiles(const std::string &keep) {
+  struct CacheFile {
+    std::string path;
+    uint64_t size;
+    time_t mtime;
+  };
+  std::vector<CacheFile> files;
+  uint64_t total = 0;
+  if (DIR *dir = opendir(cacheRoot().c_str())) {
+    while (struct dirent *ent = readdir(dir)) {
+      if (strstr(ent->d_name, ".tmp")) continue;
+
+      std::string path = cacheRoot() + ent->d_name;
+      struct stat st;
+      if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+        files.push_back({path, (uint64_t)st.st_size, st.st_mtime});
+        total += st.st_size;
+      }
+    }
+    closedir(dir);
+  }
+  last_cache_scan_ms = millis_since_boot();
+  cache_scanned = true;
+  if (total <= cache_budget) return total;
+
+  std::sort(files.begin(), files.end(), [](auto &l, auto &r) { return l.mtime < r.mtime; });
+  for (auto it = files.begin(); it != files.end() && total > cache_budget; ++it) {
+    if (it->path != keep && unlink(it->path.c_str()) == 0) {
+      total -= it->size;
+    }
+  }
+  return total;
+}
+
+// Scanning the cache directory is slow once it holds many files, so after a write it is only
+// rescanned when the bytes written since the last scan may have pushed it over budget, or
+// at least once a minute to account for other processes sharing the cache.
+void maybeEvictCacheFiles(const std::string &keep, uint64_t bytes_written) {
+  std::lock_guard lk(eviction_lock);
+  cache_size_estimate += bytes_written;
+  if (cache_scanned && cache_size_estimate <= cache_budget && millis_since_boot() - last_cache_scan_ms < CACHE_SCAN_INTERVAL_MS) {
+    return;
+  }
+  cache_size_estimate = scanAndEvictCacheFiles(keep);
+}
+
+// write to a temporary file first so readers never see a partial file
+bool writeCacheFile(const std::string &path, const std::vector<std::string_view> &parts) {
+  const std::string tmp_path = path + ".tmp" + util::random_string(8);
+  std::ofstream fs(tmp_path, std::ios::binary | std::ios::out);
+  uint64_t size = 0;
+  for (auto part : parts) {
+    fs.write(part.data(), part.size());
+    size += part.size();
+  }
+  fs.close();
+  if (!fs || rename(tmp_path.c_str(), path.c_str()) != 0) {
+    unlink(tmp_path.c_str());
+    return false;
+  }
+  maybeEvictCacheFiles(path, size);
+  return true;
+}
+
+}  // namespace
+
+std::string cacheFilePath(const std::string &url) {
+  return cacheRoot() + sha256(getUrlWithoutQuery(url));
+}
+
+std::string cacheEntryPath(const std::string &file, const std::string &suffix) {
+  if (file.find("https://") == 0) {
+    return cacheFilePath(file) + suffix;
+  }
+  struct stat st = {};
+  stat(file.c_str(), &st);
+  return cacheRoot() + sha256(file + ":" + std::to_string(st.st_size) + ":" + std::to_string(st.st_mtime)) + suffix;
+}
+
+bool writeCacheEntry(const std::string &path, std::string_view index, std::string_view data) {
+  CacheEntryHeader header = {
+    .version = CACHE_ENTRY_VERSION,
+    .index_size = index.size(),
+    .data_size = data.size(),
+    .checksum = checksum(data, checksum(index, 0)),
+  };
+  memcpy(header.magic, CACHE_ENTRY_MAGIC, sizeof(header.magic));
+  const char padding[8] = {};
+  return writeCacheFile(path, {std::string_view((const char *)&header, sizeof(header)), index,
+                               std::string_view(padding, alignedIndexSize(index.size()) - index.size()), data});
+}
+
+bool readCacheEntry(const std::string &path, std::string &content, std::string_view &index, std::string_view &data) {
+  if (!util::file_exists(path)) return false;
+
+  content = util::read_file(path);
+  CacheEntryHeader header;
+  bool valid = content.size() >= sizeof(header);
+  if (valid) {
+    memcpy(&header, content.data(), sizeof(header));
+    const size_t available = content.size() - sizeof(header);
+    valid = memcmp(header.magic, CACHE_ENTRY_MAGIC, sizeof(header.magic)) == 0 && header.version == CACHE_ENTRY_VERSION &&
+            header.index_size <= available && header.data_size == available - alignedIndexSize(header.index_size);
+  }
+  if (valid) {
+    index = std::string_view(content.data() + sizeof(header), header.index_size);
+    data = std::string_view(content.data() + sizeof(header) + alignedIndexSize(header.index_size), header.data_size);
+    valid = checksum(data, checksum(index, 0)) == header.checksum;
+  }
+  if (!valid) {
+    rWarning("removing corrupt cache entry %s", path.c_str());
+    unlink(path.c_str());
+    content.clear();
+    return false;
+  }
+  touchCacheFile(path);
+  return true;
+}
+
+void touchCacheFile(const std::string &path) {
+  utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+}
+
+void setCacheBudget(uint64_t bytes) {
+  cache_budget = bytes;
+}
 
-  return cache_path + sha256(getUrlWithoutQuery(url));
+void evictCacheFiles(const std::string &keep) {
+  std::lock_guard lk(eviction_lock);
+  cache_size_estimate = scanAndEvictCacheFiles(keep);
 }
 
 std::string FileReader::read(const std::string &file, std::atomic<bool> *abort) {
@@ -23,11 +217,11 @@ std::string FileReader::read(const std::string &file, std::atomic<bool> *abort)
 
   if ((!is_remote || cache_to_local_) && util::file_exists(local_file)) {
     result = util::read_file(local_file);
+    if (is_remote) touchCacheFile(local_file);
   } else if (is_remote) {
     result = download(file, abort);
     if (cache_to_local_ && !result.empty()) {
-      std::ofstream fs(local_file, std::ios::binary | std::ios::out);
-      fs.write(result.data(), result.size());
+      writeCacheFile(local_file, {result});
     }
   }
   return result;
@@ -2,6 +2,7 @@
 
 #include <atomic>
 #include <string>
+#include <string_view>
 
 class FileReader {
 public:
@@ -18,3 +19,18 @@ private:
 };
 
 std::string cacheFilePath(const std::string &url);
+// Path of an entry derived from a remote or local file (decompressed log, packet index).
+// Local files are keyed by path, size and modification time.
+std::string cacheEntryPath(const std::string &file, const std::string &suffix);
+
+// Derived entries are written atomically with a checksum that is verified on every read;
+// a corrupt entry is removed. Reads and writes refresh the file's modification time, and
+// the least recently used files are evicted once the cache exceeds its byte budget
+// (REPLAY_CACHE_BUDGET_MB, 20GB by default). Only replay's own subdirectory of the
+// download cache is counted and evicted. Writes only rescan the cache directory
+// periodically; evictCacheFiles() scans it right away.
+bool writeCacheEntry(const std::string &path, std::string_view index, std::string_view data);
+bool readCacheEntry(const std::string &path, std::string &content, std::string_view &index, std::string_view &data);
+void touchCacheFile(const std::string &path);
+void evictCacheFiles(const std::string &keep = "");
+void setCacheBudget(uint64_t bytes);
@@ -62,17 +62,27 @@ FrameReader::~FrameReader() {
 }
 
 bool FrameReader::load(CameraType type, const std::string &url, bool no_hw_decoder, std::atomic<bool> *abort, bool local_cache, int chunk_size, int retries) {
-  auto local_file_path = url.find("https://") == 0 ? cacheFilePath(url) : url;
+  const std::string local_file_path = fetch(url, abort, local_cache, chunk_size, retries);
+  return !local_file_path.empty() &&
+         loadFromFile(type, local_file_path, no_hw_decoder, abort, local_cache ? cacheEntryPath(url, ".pidx") : "");
+}
+
+std::string FrameReader::fetch(const std::string &url, std::atomic<bool> *abort, bool local_cache, int chunk_size, int retries) {
+  const bool is_remote = url.find("https://") == 0;
+  auto local_file_path = is_remote ? cacheFilePath(url) : url;
   if (!util::file_exists(local_file_path)) {
     FileReader f(local_cache, chunk_size, retries);
     if (f.read(url, abort).empty()) {
-      return false;
+      return {};
     }
+  } else if (is_remote) {
+    touchCacheFile(local_file_path);
   }
-  return loadFromFile(type, local_file_path, no_hw_decoder, abort);
+  return local_file_path;
 }
 
-bool FrameReader::loadFromFile(CameraType type, const std::string &file, bool no_hw_decoder, std::atomic<bool> *abort) {
+bool FrameReader::loadFromFile(CameraType type, const std::string &file, bool no_hw_decoder, std::atomic<bool> *abort,
+                               const std::string &index_file) {
   if (avformat_open_input(&input_ctx, file.c_str(), nullptr, nullptr) != 0 ||
       avformat_find_stream_info(input_ctx, nullptr) < 0) {
     rError("Failed to open input file or find video stream");
@@ -87,6 +97,14 @@ bool FrameReader::loadFromFile(CameraType type, const std::string &file, bool no
   width = decoder_->width;
   height = decoder_->height;
 
+  // a cached packet index saves reading through the whole file
+  std::string content;
+  std::string_view index, packets;
+  if (!index_file.empty() && readCacheEntry(index_file, content, index, packets) && packets.size() % sizeof(PacketInfo) == 0) {
+    packets_info.assign((const PacketInfo *)packets.data(), (const PacketInfo *)(packets.data() + packets.size()));
+    return !packets_info.empty();
+  }
+
   AVPacket pkt;
   packets_info.reserve(60 * 20);  // 20fps, one minute
   while (!(abort && *abort) && av_read_frame(input_ctx, &pkt) == 0) {
@@ -94,6 +112,9 @@ bool FrameReader::loadFromFile(CameraType type, const std::string &file, bool no
     av_packet_unref(&pkt);
   }
   avio_seek(input_ctx->pb, 0, SEEK_SET);
+  if (!index_file.empty() && !packets_info.empty() && !(abort && *abort)) {
+    writeCacheEntry(index_file, {}, std::string_view((const char *)packets_info.data(), packets_info.size() * sizeof(PacketInfo)));
+  }
   return !packets_info.empty();
 }
 
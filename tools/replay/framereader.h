@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "msgq/visionipc/visionbuf.h"
@@ -20,7 +21,11 @@ public:
   ~FrameReader();
   bool load(CameraType type, const std::string &url, bool no_hw_decoder = false, std::atomic<bool> *abort = nullptr, bool local_cache = false,
             int chunk_size = -1, int retries = 0);
-  bool loadFromFile(CameraType type, const std::string &file, bool no_hw_decoder = false, std::atomic<bool> *abort = nullptr);
+  bool loadFromFile(CameraType type, const std::string &file, bool no_hw_decoder = false, std::atomic<bool> *abort = nullptr,
+                    const std::string &index_file = "");
+  // Returns the local path of a video, downloading a remote one into the cache first. empty on failure.
+  static std::string fetch(const std::string &url, std::atomic<bool> *abort = nullptr, bool local_cache = false,
+                           int chunk_size = -1, int retries = 0);
   bool get(int idx, VisionBuf *buf);
   size_t getFrameCount() const { return packets_info.size(); }
 
@@ -29,10 +34,13 @@ public:
   VideoDecoder *decoder_ = nullptr;
   AVFormatContext *input_ctx = nullptr;
   int prev_idx = -1;
+  // also the layout of the cached packet index, so it has no padding bytes
   struct PacketInfo {
-    int flags;
+    int32_t flags;
+    int32_t reserved;
     int64_t pos;
   };
+  static_assert(std::has_unique_object_representations_v<PacketInfo>);
   std::vector<PacketInfo> packets_info;
 };
 
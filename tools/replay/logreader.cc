@@ -6,17 +6,79 @@
 #include "tools/replay/util.h"
 
 bool LogReader::load(const std::string &url, std::atomic<bool> *abort, bool local_cache, int chunk_size, int retries) {
-  std::string data = FileReader(local_cache, chunk_size, retries).read(url, abort);
+  if (local_cache && loadFromCache(url, abort)) {
+    return true;
+  }
+  // with the local cache on, only the decompressed log is cached
+  std::string data = FileReader(false, chunk_size, retries).read(url, abort);
+  return loadDecompressed(url, decompress(url, std::move(data), abort), abort, local_cache);
+}
+
+std::string LogReader::decompress(const std::string &url, std::string data, std::atomic<bool> *abort) {
   if (!data.empty() && url.find(".bz2") != std::string::npos)
     data = decompressBZ2(data, abort);
+  else if (!data.empty() && url.find(".zst") != std::string::npos)
+    data = decompressZST(data, abort);
+  return data;
+}
 
-  bool success = !data.empty() && load(data.data(), data.size(), abort);
+bool LogReader::loadDecompressed(const std::string &url, std::string data, std::atomic<bool> *abort, bool local_cache) {
+  std::vector<IndexEntry> index;
+  bool success = !data.empty() && parse(data.data(), data.size(), abort, local_cache ? &index : nullptr);
+  if (success && local_cache) {
+    writeCacheEntry(cacheEntryPath(url, ".log"), std::string_view((const char *)index.data(), index.size() * sizeof(IndexEntry)), data);
+  }
   if (filters_.empty())
     raw_ = std::move(data);
   return success;
 }
 
+bool LogReader::loadFromCache(const std::string &url, std::atomic<bool> *abort) {
+  std::string content;
+  std::string_view index_data, data;
+  if (!readCacheEntry(cacheEntryPath(url, ".log"), content, index_data, data) || index_data.size() % sizeof(IndexEntry) != 0) {
+    return false;
+  }
+
+  // the index is already sorted, events are created without parsing the log
+  const IndexEntry *index = (const IndexEntry *)index_data.data();
+  const size_t count = index_data.size() / sizeof(IndexEntry);
+  const capnp::word *words = (const capnp::word *)data.data();
+  const size_t total_words = data.size() / sizeof(capnp::word);
+  events.reserve(count);
+  for (size_t i = 0; i < count && !(abort && *abort); ++i) {
+    const IndexEntry &e = index[i];
+    if (e.offset + e.size > total_words) {
+      events.clear();
+      return false;
+    }
+    if (!filters_.empty() && (e.which >= filters_.size() || !filters_[e.which])) {
+      continue;
+    }
+
+    auto event_data = kj::arrayPtr(words + e.offset, e.size);
+    if (!filters_.empty()) {
+      auto buf = buffer_.allocate(e.size * sizeof(capnp::word));
+      memcpy(buf, event_data.begin(), e.size * sizeof(capnp::word));
+      event_data = kj::arrayPtr((const capnp::word *)buf, e.size);
+    }
+    events.emplace_back((cereal::Event::Which)e.which, e.mono_time, event_data, e.eidx_segnum);
+  }
+
+  if (events.empty() || (abort && *abort)) {
+    events.clear();
+    return false;
+  }
+  if (filters_.empty())
+    raw_ = std::move(content);
+  return true;
+}
+
 bool LogReader::load(const char *data, size_t size, std::atomic<bool> *abort) {
+  return parse(data, size, abort, nullptr);
+}
+
+bool LogReader::parse(const char *data, size_t size, std::atomic<bool> *abort, std::vector<IndexEntry> *index) {
   try {
     events.reserve(65000);
     kj::ArrayPtr<const capnp::word> words((const capnp::word *)data, size / sizeof(capnp::word));
@@ -27,6 +89,29 @@ bool LogReader::load(const char *data, size_t size, std::atomic<bool> *abort) {
       auto event_data = kj::arrayPtr(words.begin(), reader.getEnd());
       words = kj::arrayPtr(reader.getEnd(), words.end());
 
+      const uint64_t mono_time = event.getLogMonoTime();
+      // Add encodeIdx packet again as a frame packet for the video stream
+      const bool is_encode_idx = which == cereal::Event::ROAD_ENCODE_IDX ||
+                                 which == cereal::Event::DRIVER_ENCODE_IDX ||
+                                 which == cereal::Event::WIDE_ROAD_ENCODE_IDX;
+      uint64_t frame_time = mono_time;
+      int32_t segment_num = -1;
+      if (is_encode_idx) {
+        auto idx = capnp::AnyStruct::Reader(event).getPointerSection()[0].getAs<cereal::EncodeIndex>();
+        if (uint64_t sof = idx.getTimestampSof()) {
+          frame_time = sof;
+        }
+        segment_num = idx.getSegmentNum();
+      }
+
+      if (index) {
+        const uint64_t offset = event_data.begin() - (const capnp::word *)data;
+        index->push_back({mono_time, offset, (uint32_t)event_data.size(), (uint32_t)which, -1, 0});
+        if (is_encode_idx) {
+          index->push_back({frame_time, offset, (uint32_t)event_data.size(), (uint32_t)which, segment_num, 0});
+        }
+      }
+
       if (!filters_.empty()) {
         if (which >= filters_.size() || !filters_[which])
           continue;
@@ -35,26 +120,27 @@ bool LogReader::load(const char *data, size_t size, std::atomic<bool> *abort) {
         event_data = kj::arrayPtr((const capnp::word *)buf, event_data.size());
       }
 
-      uint64_t mono_time = event.getLogMonoTime();
-      const Event &evt = events.emplace_back(which, mono_time, event_data);
-      // Add encodeIdx packet again as a frame packet for the video stream
-      if (evt.which == cereal::Event::ROAD_ENCODE_IDX ||
-          evt.which == cereal::Event::DRIVER_ENCODE_IDX ||
-          evt.which == cereal::Event::WIDE_ROAD_ENCODE_IDX) {
-        auto idx = capnp::AnyStruct::Reader(event).getPointerSection()[0].getAs<cereal::EncodeIndex>();
-        if (uint64_t sof = idx.getTimestampSof()) {
-          mono_time = sof;
-        }
-        events.emplace_back(which, mono_time, event_data, idx.getSegmentNum());
+      events.emplace_back(which, mono_time, event_data);
+      if (is_encode_idx) {
+        events.emplace_back(which, frame_time, event_data, segment_num);
       }
     }
   } catch (const kj::Exception &e) {
     rWarning("Failed to parse log : %s.\nRetrieved %zu events from corrupt log", e.getDescription().cStr(), events.size());
   }
 
-  if (!events.empty() && !(abort && *abort)) {
+  if (abort && *abort) {
+    return false;
+  }
+  if (index) {
+    std::stable_sort(index->begin(), index->end(), [](auto &l, auto &r) {
+      return l.mono_time < r.mono_time || (l.mono_time == r.mono_time && l.which < r.which);
+    });
+  }
+  if (!events.empty()) {
     events.shrink_to_fit();
-    std::sort(events.begin(), events.end());
+    // stable, so that events with the same time and type keep their log order
+    std::stable_sort(events.begin(), events.end());
     return true;
   }
   return false;
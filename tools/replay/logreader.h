@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "cereal/gen/cpp/log.capnp.h"
@@ -31,9 +32,29 @@ public:
   bool load(const std::string &url, std::atomic<bool> *abort = nullptr,
             bool local_cache = false, int chunk_size = -1, int retries = 0);
   bool load(const char *data, size_t size, std::atomic<bool> *abort = nullptr);
+
+  // The stages of load(url), for callers that run them on separate threads:
+  // a cached decompressed log if there is one, otherwise read, decompress and parse.
+  bool loadFromCache(const std::string &url, std::atomic<bool> *abort = nullptr);
+  static std::string decompress(const std::string &url, std::string data, std::atomic<bool> *abort = nullptr);
+  bool loadDecompressed(const std::string &url, std::string data, std::atomic<bool> *abort = nullptr, bool local_cache = false);
+
   std::vector<Event> events;
 
 private:
+  // Position of an event in the decompressed log, stored with the log in the local cache.
+  // Written to disk as is, so it has no padding bytes.
+  struct IndexEntry {
+    uint64_t mono_time;
+    uint64_t offset;  // in words
+    uint32_t size;    // in words
+    uint32_t which;
+    int32_t eidx_segnum;
+    uint32_t reserved;
+  };
+  static_assert(sizeof(IndexEntry) == 32 && std::has_unique_object_representations_v<IndexEntry>);
+  bool parse(const char *data, size_t size, std::atomic<bool> *abort, std::vector<IndexEntry> *index);
+
   std::string raw_;
   std::vector<bool> filters_;
   MonotonicBuffer buffer_{1024 * 1024};
@@ -22,7 +22,9 @@ int main(int argc, char *argv[]) {
       {"no-hw-decoder", REPLAY_FLAG_NO_HW_DECODER, "disable HW video decoding"},
       {"no-vipc", REPLAY_FLAG_NO_VIPC, "do not output video"},
       {"all", REPLAY_FLAG_ALL_SERVICES, "do output all messages including uiDebug, userFlag"
-                                        ". this may causes issues when used along with UI"}
+                                        ". this may causes issues when used along with UI"},
+      {"full-speed", REPLAY_FLAG_FULL_SPEED, "publish as fast as possible without the console UI, "
+                                             "then exit at the end of the route"},
   };
 
   QCommandLineParser parser;
@@ -31,6 +33,7 @@ int main(int argc, char *argv[]) {
   parser.addPositionalArgument("route", "the drive to replay. find your drives at connect.comma.ai");
   parser.addOption({{"a", "allow"}, "whitelist of services to send", "allow"});
   parser.addOption({{"b", "block"}, "blacklist of services to send", "block"});
+  parser.addOption({"lockstep", "wait for all subscribers of <services> to read each message before sending the next", "services"});
   parser.addOption({{"c", "cache"}, "cache <n> segments in memory. default is 5", "n"});
   parser.addOption({{"s", "start"}, "start from <seconds>", "seconds"});
   parser.addOption({"x", QString("playback <speed>. between %1 - %2")
@@ -65,7 +68,15 @@ int main(int argc, char *argv[]) {
     op_prefix.reset(new OpenpilotPrefix(prefix.toStdString()));
   }
 
+  const bool full_speed = replay_flags & REPLAY_FLAG_FULL_SPEED;
+  if (full_speed) {
+    replay_flags |= REPLAY_FLAG_NO_LOOP;
+  }
+
   Replay *replay = new Replay(route, allow, block, nullptr, replay_flags, parser.value("data_dir"), &app);
+  if (!parser.value("lockstep").isEmpty() && !replay->setLockstepServices(parser.value("lockstep").split(","))) {
+    return 1;
+  }
   if (!parser.value("c").isEmpty()) {
     replay->setSegmentCacheLimit(parser.value("c").toInt());
   }
@@ -77,7 +88,12 @@ int main(int argc, char *argv[]) {
     return 0;
   }
 
-  ConsoleUI console_ui(replay);
+  std::unique_ptr<ConsoleUI> console_ui;
+  if (full_speed) {
+    QObject::connect(replay, &Replay::finished, &app, &QCoreApplication::quit, Qt::QueuedConnection);
+  } else {
+    console_ui = std::make_unique<ConsoleUI>(replay);
+  }
   replay->start(parser.value("start").toInt());
   return app.exec();
 }
@@ -3,6 +3,7 @@
 #include <QDebug>
 #include <QtConcurrent>
 #include <capnp/dynamic.h>
+#include <cinttypes>
 #include <csignal>
 #include "cereal/services.h"
 #include "common/params.h"
@@ -88,6 +89,19 @@ bool Replay::load() {
   return true;
 }
 
+bool Replay::setLockstepServices(const QStringList &services) {
+  // ZMQ has no way to tell whether the subscribers have read a message
+  if (messaging_use_zmq()) {
+    rWarning("lockstep is not supported with ZMQ");
+    return false;
+  }
+  lockstep_.assign(sockets_.size(), false);
+  for (int i = 0; i < sockets_.size(); ++i) {
+    lockstep_[i] = sockets_[i] && services.contains(sockets_[i]);
+  }
+  return true;
+}
+
 void Replay::start(int seconds) {
   seekTo(route_->identifier().begin_segment * 60 + seconds, false);
 }
@@ -265,57 +279,76 @@ void Replay::updateSegmentsCache() {
 }
 
 void Replay::loadSegmentInRange(SegmentMap::iterator begin, SegmentMap::iterator cur, SegmentMap::iterator end) {
-  auto loadNext = [this](auto begin, auto end) {
-    auto it = std::find_if(begin, end, [](const auto &seg_it) { return !seg_it.second || !seg_it.second->isLoaded(); });
-    if (it != end && !it->second) {
+  // Start all missing segments at once. The loader works on the ones nearest the playhead
+  // first, preferring forward segments.
+  for (auto it = begin; it != end; ++it) {
+    if (!it->second) {
+      const int distance = it->first - cur->first;
+      const int priority = distance >= 0 ? -2 * distance : 2 * distance + 1;
       rDebug("loading segment %d...", it->first);
-      it->second = std::make_unique<Segment>(it->first, route_->at(it->first), flags_, filters_);
+      it->second = std::make_unique<Segment>(it->first, route_->at(it->first), flags_, filters_, priority);
       QObject::connect(it->second.get(), &Segment::loadFinished, this, &Replay::segmentLoadFinished);
-      return true;
     }
-    return false;
-  };
-
-  // Load forward segments, then try reverse
-  if (!loadNext(cur, end)) {
-    loadNext(std::make_reverse_iterator(cur), segments_.rend());
   }
 }
 
 void Replay::mergeSegments(const SegmentMap::iterator &begin, const SegmentMap::iterator &end) {
   std::set<int> segments_to_merge;
-  size_t new_events_size = 0;
   for (auto it = begin; it != end; ++it) {
     if (it->second && it->second->isLoaded()) {
       segments_to_merge.insert(it->first);
-      new_events_size += it->second->log->events.size();
     }
   }
 
-  if (segments_to_merge == merged_segments_) return;
+  std::vector<int> segments_to_remove;
+  for (const auto &[n, _] : merged_segments_) {
+    if (segments_to_merge.count(n) == 0) segments_to_remove.push_back(n);
+  }
+  // Only the segments that changed are added to or removed from events_.
+  std::vector<std::pair<int, std::vector<Event>>> new_segments;
+  for (int n : segments_to_merge) {
+    if (isSegmentMerged(n)) continue;
+
+    auto &events = new_segments.emplace_back(n, std::vector<Event>{}).second;
+    const auto &log_events = segments_.at(n)->log->events;
+    events.reserve(log_events.size());
+    std::copy_if(log_events.begin(), log_events.end(), std::back_inserter(events),
+                 [this](const Event &e) { return e.which < sockets_.size() && sockets_[e.which] != nullptr; });
+  }
+  if (segments_to_remove.empty() && new_segments.empty()) return;
 
   rDebug("merge segments %s", std::accumulate(segments_to_merge.begin(), segments_to_merge.end(), std::string{},
     [](auto & a, int b) { return a + (a.empty() ? "" : ", ") + std::to_string(b); }).c_str());
 
-  std::vector<Event> new_events;
-  new_events.reserve(new_events_size);
-
-  // Merge events from segments_to_merge into new_events
-  for (int n : segments_to_merge) {
-    size_t size = new_events.size();
-    const auto &events = segments_.at(n)->log->events;
-    std::copy_if(events.begin(), events.end(), std::back_inserter(new_events),
-                  [this](const Event &e) { return e.which < sockets_.size() && sockets_[e.which] != nullptr; });
-    std::inplace_merge(new_events.begin(), new_events.begin() + size, new_events.end());
-  }
-
   if (stream_thread_) {
     emit segmentsMerged();
   }
 
   updateEvents([&]() {
-    events_.swap(new_events);
-    merged_segments_ = segments_to_merge;
+    double start_ms = millis_since_boot();
+    for (int n : segments_to_remove) {
+      const auto &data = merged_segments_.at(n);
+      events_.erase(std::remove_if(events_.begin(), events_.end(), [&data](const Event &e) {
+        return std::binary_search(data.begin(), data.end(), e.data.begin());
+      }), events_.end());
+      merged_segments_.erase(n);
+    }
+
+    for (auto &[n, events] : new_segments) {
+      auto &data = merged_segments_[n];
+      data.reserve(events.size());
+      for (const Event &e : events) data.push_back(e.data.begin());
+      std::sort(data.begin(), data.end());
+      if (events.empty()) continue;
+
+      // the new events are merged with only those they overlap in time
+      const size_t first = std::lower_bound(events_.begin(), events_.end(), events.front()) - events_.begin();
+      const size_t last = std::upper_bound(events_.begin(), events_.end(), events.back()) - events_.begin();
+      events_.insert(events_.begin() + last, events.begin(), events.end());
+      std::inplace_merge(events_.begin() + first, events_.begin() + last, events_.begin() + last + events.size());
+    }
+    rDebug("merged in %.1f ms, %zu events", millis_since_boot() - start_ms, events_.size());
+
     // Check if seeking is in progress
     int target_segment = int(seeking_to_seconds_ / 60);
     if (seeking_to_seconds_ >= 0 && segments_to_merge.count(target_segment) > 0) {
@@ -390,6 +423,12 @@ void Replay::publishMessage(const Event *e) {
     if (ret == -1) {
       rWarning("stop publishing %s due to multiple publishers error", sockets_[e->which]);
       sockets_[e->which] = nullptr;
+      return;
+    }
+    ++throughput_.msgs;
+    throughput_.bytes += bytes.size();
+    if (!lockstep_.empty() && lockstep_[e->which]) {
+      lockstep_pending_ = sockets_[e->which];
     }
   } else {
     capnp::FlatArrayMessageReader reader(e->data);
@@ -398,6 +437,42 @@ void Replay::publishMessage(const Event *e) {
   }
 }
 
+bool Replay::waitForReaders() {
+  // no readers counts as not updated, so the first message waits for the subscribers to connect
+  const double timeout_ms = millis_since_boot() + LOCKSTEP_TIMEOUT_MS;
+  while (!pm->all_readers_updated(lockstep_pending_)) {
+    // a pause interrupts the wait, it's picked up again when the stream resumes
+    if (paused_ || exit_) return false;
+    if (millis_since_boot() > timeout_ms) {
+      rWarning("lockstep: %s not read within %d ms, moving on", lockstep_pending_, LOCKSTEP_TIMEOUT_MS);
+      break;
+    }
+    precise_nano_sleep(50 * 1000);
+  }
+  lockstep_pending_ = nullptr;
+  return true;
+}
+
+void Replay::reportThroughput(bool final) {
+  const double now = millis_since_boot();
+  if (throughput_.start_ms == 0) {
+    throughput_.start_ms = throughput_.last_ms = now;
+    return;
+  }
+  if (final) {
+    const double secs = std::max(now - throughput_.start_ms, 1.0) / 1000.0;
+    rInfo("published %" PRIu64 " msgs, %.1f MB in %.1f s: %.0f msgs/s, %.2f MB/s", throughput_.msgs, throughput_.bytes / 1e6,
+          secs, throughput_.msgs / secs, throughput_.bytes / 1e6 / secs);
+  } else if (now - throughput_.last_ms >= 5000) {
+    const double secs = (now - throughput_.last_ms) / 1000.0;
+    rInfo("%.1f s of route: %.0f msgs/s, %.2f MB/s", currentSeconds(), (throughput_.msgs - throughput_.last_msgs) / secs,
+          (throughput_.bytes - throughput_.last_bytes) / 1e6 / secs);
+    throughput_.last_msgs = throughput_.msgs;
+    throughput_.last_bytes = throughput_.bytes;
+    throughput_.last_ms = now;
+  }
+}
+
 void Replay::publishFrame(const Event *e) {
   CameraType cam;
   switch (e->which) {
@@ -444,12 +519,20 @@ void Replay::streamThread() {
 
     if (it != events_.cend()) {
       cur_which = it->which;
-    } else if (!hasFlag(REPLAY_FLAG_NO_LOOP)) {
-      // Check for loop end and restart if necessary
+    } else {
       int last_segment = segments_.rbegin()->first;
       if (current_segment_ >= last_segment && isSegmentMerged(last_segment)) {
-        rInfo("reaches the end of route, restart from beginning");
-        QMetaObject::invokeMethod(this, std::bind(&Replay::seekTo, this, 0, false), Qt::QueuedConnection);
+        if (lockstep_pending_) waitForReaders();
+        if (hasFlag(REPLAY_FLAG_FULL_SPEED)) {
+          reportThroughput(true);
+        }
+        if (!hasFlag(REPLAY_FLAG_NO_LOOP)) {
+          // Restart from the beginning at the end of the route
+          rInfo("reaches the end of route, restart from beginning");
+          QMetaObject::invokeMethod(this, std::bind(&Replay::seekTo, this, 0, false), Qt::QueuedConnection);
+        } else {
+          emit finished();
+        }
       }
     }
   }
@@ -460,6 +543,7 @@ std::vector<Event>::const_iterator Replay::publishEvents(std::vector<Event>::con
   uint64_t evt_start_ts = cur_mono_time_;
   uint64_t loop_start_ts = nanos_since_boot();
   double prev_replay_speed = speed_;
+  const bool full_speed = hasFlag(REPLAY_FLAG_FULL_SPEED);
 
   for (; !paused_ && first != last; ++first) {
     const Event &evt = *first;
@@ -473,27 +557,35 @@ std::vector<Event>::const_iterator Replay::publishEvents(std::vector<Event>::con
      // Skip events if socket is not present
     if (!sockets_[evt.which]) continue;
 
-    const uint64_t current_nanos = nanos_since_boot();
-    const int64_t time_diff = (evt.mono_time - evt_start_ts) / speed_ - (current_nanos - loop_start_ts);
-
-    // Reset timestamps for potential synchronization issues:
-    // - A negative time_diff may indicate slow execution or system wake-up,
-    // - A time_diff exceeding 1 second suggests a skipped segment.
-    if ((time_diff < -1e9 || time_diff >= 1e9) || speed_ != prev_replay_speed) {
-      evt_start_ts = evt.mono_time;
-      loop_start_ts = current_nanos;
-      prev_replay_speed = speed_;
-    } else if (time_diff > 0) {
-      precise_nano_sleep(time_diff);
+    if (full_speed) {
+      // no pacing: events go out in order as fast as the subscribers (in lockstep) take them
+      reportThroughput(false);
+    } else {
+      const uint64_t current_nanos = nanos_since_boot();
+      const int64_t time_diff = (evt.mono_time - evt_start_ts) / speed_ - (current_nanos - loop_start_ts);
+
+      // Reset timestamps for potential synchronization issues:
+      // - A negative time_diff may indicate slow execution or system wake-up,
+      // - A time_diff exceeding 1 second suggests a skipped segment.
+      if ((time_diff < -1e9 || time_diff >= 1e9) || speed_ != prev_replay_speed) {
+        evt_start_ts = evt.mono_time;
+        loop_start_ts = current_nanos;
+        prev_replay_speed = speed_;
+      } else if (time_diff > 0) {
+        precise_nano_sleep(time_diff);
+      }
     }
 
+    // the previous lockstep message has to be read before anything else goes out
+    if (lockstep_pending_ && !waitForReaders()) break;
     if (paused_) break;
 
     cur_mono_time_ = evt.mono_time;
     if (evt.eidx_segnum == -1) {
       publishMessage(&evt);
     } else if (camera_server_) {
-      if (speed_ > 1.0) {
+      // frames must not be dropped when running ahead of real time
+      if (speed_ > 1.0 || full_speed) {
         camera_server_->waitForSent();
       }
       publishFrame(&evt);
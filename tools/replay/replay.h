@@ -19,6 +19,8 @@ const QString DEMO_ROUTE = "a2a0ccea32023010|2023-07-27--13-01-19";
 
 // one segment uses about 100M of memory
 constexpr int MIN_SEGMENTS_CACHE = 5;
+// how long a lockstep message waits for its subscribers before replay moves on
+constexpr int LOCKSTEP_TIMEOUT_MS = 10000;
 
 enum REPLAY_FLAGS {
   REPLAY_FLAG_NONE = 0x0000,
@@ -30,6 +32,7 @@ enum REPLAY_FLAGS {
   REPLAY_FLAG_NO_HW_DECODER = 0x0100,
   REPLAY_FLAG_NO_VIPC = 0x0400,
   REPLAY_FLAG_ALL_SERVICES = 0x0800,
+  REPLAY_FLAG_FULL_SPEED = 0x1000,
 };
 
 enum class FindFlag {
@@ -66,6 +69,10 @@ public:
     filter_opaque = opaque;
     event_filter = filter;
   }
+  // In lockstep, a message of these services is only followed by the next event once all
+  // subscribers have read it, or after LOCKSTEP_TIMEOUT_MS. Requires publishing with a
+  // PubMaster over msgq; returns false with ZMQ.
+  bool setLockstepServices(const QStringList &services);
   inline int segmentCacheLimit() const { return segment_cache_limit; }
   inline void setSegmentCacheLimit(int n) { segment_cache_limit = std::max(MIN_SEGMENTS_CACHE, n); }
   inline bool hasFlag(REPLAY_FLAGS flag) const { return flags_ & flag; }
@@ -93,6 +100,7 @@ signals:
   void segmentsMerged();
   void seekedTo(double sec);
   void qLogLoaded(int segnum, std::shared_ptr<LogReader> qlog);
+  void finished();
 
 protected slots:
   void segmentLoadFinished(bool success);
@@ -111,6 +119,8 @@ protected:
                                                    std::vector<Event>::const_iterator last);
   void publishMessage(const Event *e);
   void publishFrame(const Event *e);
+  bool waitForReaders();
+  void reportThroughput(bool final);
   void buildTimeline();
   inline bool isSegmentMerged(int n) const { return merged_segments_.count(n) > 0; }
 
@@ -130,13 +140,16 @@ protected:
   uint64_t route_start_ts_ = 0;
   std::atomic<uint64_t> cur_mono_time_ = 0;
   std::vector<Event> events_;
-  std::set<int> merged_segments_;
+  // data of the events each merged segment contributed to events_, sorted, to remove them again
+  std::map<int, std::vector<const capnp::word *>> merged_segments_;
 
   // messaging
   SubMaster *sm = nullptr;
   std::unique_ptr<PubMaster> pm;
   std::vector<const char*> sockets_;
   std::vector<bool> filters_;
+  std::vector<bool> lockstep_;
+  const char *lockstep_pending_ = nullptr;
   std::unique_ptr<Route> route_;
   std::unique_ptr<CameraServer> camera_server_;
   std::atomic<uint32_t> flags_ = REPLAY_FLAG_NONE;
@@ -149,4 +162,11 @@ protected:
   replayEventFilter event_filter = nullptr;
   void *filter_opaque = nullptr;
   int segment_cache_limit = MIN_SEGMENTS_CACHE;
+
+  // throughput in full-speed mode, only accessed in the stream thread
+  struct {
+    uint64_t msgs = 0, bytes = 0;
+    uint64_t last_msgs = 0, last_bytes = 0;
+    double start_ms = 0, last_ms = 0;
+  } throughput_;
 };
@@ -5,9 +5,11 @@
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QRegularExpression>
+#include <QThreadPool>
 #include <QtConcurrent>
 #include <array>
 
+#include "common/timing.h"
 #include "selfdrive/ui/qt/api.h"
 #include "system/hardware/hw.h"
 #include "tools/replay/replay.h"
@@ -114,9 +116,9 @@ void Route::addFileToSegment(int n, const QString &file) {
   const int pos = name.lastIndexOf("--");
   name = pos != -1 ? name.mid(pos + 2) : name;
 
-  if (name == "rlog.bz2" || name == "rlog") {
+  if (name == "rlog.bz2" || name == "rlog.zst" || name == "rlog") {
     segments_[n].rlog = file;
-  } else if (name == "qlog.bz2" || name == "qlog") {
+  } else if (name == "qlog.bz2" || name == "qlog.zst" || name == "qlog") {
     segments_[n].qlog = file;
   } else if (name == "fcamera.hevc") {
     segments_[n].road_cam = file;
@@ -131,8 +133,32 @@ void Route::addFileToSegment(int n, const QString &file) {
 
 // class Segment
 
-Segment::Segment(int n, const SegmentFile &files, uint32_t flags, const std::vector<bool> &filters)
-    : seg_num(n), flags(flags), filters_(filters) {
+namespace {
+
+QThreadPool *stagePool(Segment::Stage stage) {
+  // never destroyed, so no pool outlives a running job at exit
+  static QThreadPool *pools = [] {
+    const int cpus = std::max(1, QThread::idealThreadCount());
+    auto pools = new QThreadPool[Segment::StageCount];
+    pools[Segment::Download].setMaxThreadCount(4);
+    pools[Segment::Decompress].setMaxThreadCount(std::max(1, cpus / 2));
+    pools[Segment::Parse].setMaxThreadCount(std::max(1, cpus / 2));
+    pools[Segment::Index].setMaxThreadCount(2);
+    return pools;
+  }();
+  return &pools[stage];
+}
+
+class SegmentJob : public QRunnable {
+public:
+  void run() override { fn(); }
+  std::function<void()> fn;
+};
+
+}  // namespace
+
+Segment::Segment(int n, const SegmentFile &files, uint32_t flags, const std::vector<bool> &filters, int priority)
+    : seg_num(n), flags(flags), filters_(filters), priority_(priority), start_ms_(millis_since_boot()) {
   // [RoadCam, DriverCam, WideRoadCam, log]. fallback to qcamera/qlog
   const std::array file_list = {
       (flags & REPLAY_FLAG_QCAMERA) || files.road_cam.isEmpty() ? files.qcamera : files.road_cam,
@@ -140,10 +166,19 @@ Segment::Segment(int n, const SegmentFile &files, uint32_t flags, const std::vec
       flags & REPLAY_FLAG_ECAM ? files.wide_road_cam : "",
       files.rlog.isEmpty() ? files.qlog : files.rlog,
   };
+  auto should_load = [&](int i) { return !file_list[i].isEmpty() && (!(flags & REPLAY_FLAG_NO_VIPC) || i >= MAX_CAMERAS); };
+  for (int i = 0; i < file_list.size(); ++i) {
+    loading_ += should_load(i);
+  }
   for (int i = 0; i < file_list.size(); ++i) {
-    if (!file_list[i].isEmpty() && (!(flags & REPLAY_FLAG_NO_VIPC) || i >= MAX_CAMERAS)) {
-      ++loading_;
-      synchronizer_.addFuture(QtConcurrent::run(this, &Segment::loadFile, i, file_list[i].toStdString()));
+    if (!should_load(i)) continue;
+
+    if (i < MAX_CAMERAS) {
+      frames[i] = std::make_unique<FrameReader>();
+      loadFrames(i, file_list[i].toStdString());
+    } else {
+      log = std::make_unique<LogReader>(filters_);
+      loadLog(file_list[i].toStdString());
     }
   }
 }
@@ -151,27 +186,104 @@ Segment::Segment(int n, const SegmentFile &files, uint32_t flags, const std::vec
 Segment::~Segment() {
   disconnect();
   abort_ = true;
-  synchronizer_.setCancelOnWait(true);
-  synchronizer_.waitForFinished();
+
+  // drop the jobs still waiting in the pools, and wait for the running ones to bail out
+  std::unique_lock lk(jobs_lock_);
+  for (auto [job, stage] : queued_jobs_) {
+    if (stagePool(stage)->tryTake(job)) {
+      delete job;
+      --pending_jobs_;
+    }
+  }
+  queued_jobs_.clear();
+  jobs_cv_.wait(lk, [this]() { return pending_jobs_ == 0; });
+}
+
+void Segment::schedule(Stage stage, std::function<void()> fn) {
+  auto job = new SegmentJob();
+  job->fn = [this, job, stage, fn = std::move(fn)]() {
+    {
+      std::lock_guard lk(jobs_lock_);
+      queued_jobs_.erase(job);
+    }
+    // a job ends its file's chain unless it schedules the next stage
+    if (abort_) {
+      fileLoaded(false);
+    } else {
+      fn();
+    }
+    std::lock_guard lk(jobs_lock_);
+    --pending_jobs_;
+    jobs_cv_.notify_all();
+  };
+
+  std::lock_guard lk(jobs_lock_);
+  ++pending_jobs_;
+  queued_jobs_[job] = stage;
+  stagePool(stage)->start(job, priority_);
+}
+
+void Segment::timeStage(Stage stage, double start_ms) {
+  stage_us_[stage] += (millis_since_boot() - start_ms) * 1000;
 }
 
-void Segment::loadFile(int id, const std::string file) {
+void Segment::loadLog(const std::string &file) {
   const bool local_cache = !(flags & REPLAY_FLAG_NO_FILE_CACHE);
-  bool success = false;
-  if (id < MAX_CAMERAS) {
-    frames[id] = std::make_unique<FrameReader>();
-    success = frames[id]->load((CameraType)id, file, flags & REPLAY_FLAG_NO_HW_DECODER, &abort_, local_cache, 20 * 1024 * 1024, 3);
-  } else {
-    log = std::make_unique<LogReader>(filters_);
-    success = log->load(file, &abort_, local_cache, 0, 3);
-  }
+  schedule(Download, [=]() {
+    double start = millis_since_boot();
+    if (local_cache && log->loadFromCache(file, &abort_)) {
+      timeStage(Download, start);
+      return fileLoaded(true);
+    }
+    // the decompressed log is cached by loadDecompressed, not the downloaded file
+    auto data = std::make_shared<std::string>(FileReader(false, 0, 3).read(file, &abort_));
+    timeStage(Download, start);
+    if (data->empty()) return fileLoaded(false);
+
+    schedule(Decompress, [=]() {
+      double start = millis_since_boot();
+      *data = LogReader::decompress(file, std::move(*data), &abort_);
+      timeStage(Decompress, start);
+      if (data->empty()) return fileLoaded(false);
+
+      schedule(Parse, [=]() {
+        double start = millis_since_boot();
+        bool success = log->loadDecompressed(file, std::move(*data), &abort_, local_cache);
+        timeStage(Parse, start);
+        fileLoaded(success);
+      });
+    });
+  });
+}
+
+void Segment::loadFrames(int id, const std::string &file) {
+  const bool local_cache = !(flags & REPLAY_FLAG_NO_FILE_CACHE);
+  schedule(Download, [=]() {
+    double start = millis_since_boot();
+    const std::string local_file = FrameReader::fetch(file, &abort_, local_cache, 20 * 1024 * 1024, 3);
+    timeStage(Download, start);
+    if (local_file.empty()) return fileLoaded(false);
+
+    schedule(Index, [=]() {
+      double start = millis_since_boot();
+      bool success = frames[id]->loadFromFile((CameraType)id, local_file, flags & REPLAY_FLAG_NO_HW_DECODER, &abort_,
+                                              local_cache ? cacheEntryPath(file, ".pidx") : "");
+      timeStage(Index, start);
+      fileLoaded(success);
+    });
+  });
+}
 
+void Segment::fileLoaded(bool success) {
   if (!success) {
     // abort all loading jobs.
     abort_ = true;
   }
 
   if (--loading_ == 0) {
+    if (!abort_) rDebug("segment %d loaded in %.0f ms (download %.0f ms, decompress %.0f ms, parse %.0f ms, index %.0f ms)",
+           seg_num, millis_since_boot() - start_ms_, stage_us_[Download] / 1000.0, stage_us_[Decompress] / 1000.0,
+           stage_us_[Parse] / 1000.0, stage_us_[Index] / 1000.0);
     emit loadFinished(!abort_);
   }
 }
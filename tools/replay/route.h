@@ -1,12 +1,15 @@
 #pragma once
 
+#include <condition_variable>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include <QDateTime>
-#include <QFutureSynchronizer>
+#include <QRunnable>
 
 #include "tools/replay/framereader.h"
 #include "tools/replay/logreader.h"
@@ -52,11 +55,16 @@ protected:
   QDateTime date_time_;
 };
 
+// Segment files are loaded in stages, each on its own bounded thread pool:
+// download -> decompress -> parse for the log, download -> index for the videos.
+// Jobs of segments with a higher priority (nearer the playhead) are picked first.
 class Segment : public QObject {
   Q_OBJECT
 
 public:
-  Segment(int n, const SegmentFile &files, uint32_t flags, const std::vector<bool> &filters = {});
+  enum Stage { Download, Decompress, Parse, Index, StageCount };
+
+  Segment(int n, const SegmentFile &files, uint32_t flags, const std::vector<bool> &filters = {}, int priority = 0);
   ~Segment();
   inline bool isLoaded() const { return !loading_ && !abort_; }
 
@@ -68,11 +76,22 @@ signals:
   void loadFinished(bool success);
 
 protected:
-  void loadFile(int id, const std::string file);
+  void loadLog(const std::string &file);
+  void loadFrames(int id, const std::string &file);
+  void schedule(Stage stage, std::function<void()> fn);
+  void timeStage(Stage stage, double start_ms);
+  void fileLoaded(bool success);
 
   std::atomic<bool> abort_ = false;
   std::atomic<int> loading_ = 0;
-  QFutureSynchronizer<void> synchronizer_;
   uint32_t flags;
   std::vector<bool> filters_;
+  const int priority_;
+  const double start_ms_;
+  std::atomic<int64_t> stage_us_[StageCount] = {};
+
+  std::mutex jobs_lock_;
+  std::condition_variable jobs_cv_;
+  std::map<QRunnable *, Stage> queued_jobs_;
+  int pending_jobs_ = 0;
 };
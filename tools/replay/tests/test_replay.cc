@@ -1,10 +1,19 @@
+#include <dirent.h>
+#include <sys/stat.h>
+#include <zstd.h>
+
+#include <array>
 #include <chrono>
+#include <cstring>
+#include <memory>
 #include <thread>
 
+#include <QCoreApplication>
 #include <QEventLoop>
 
 #include "catch2/catch.hpp"
 #include "common/util.h"
+#include "system/hardware/hw.h"
 #include "tools/replay/replay.h"
 #include "tools/replay/util.h"
 
@@ -69,6 +78,139 @@ TEST_CASE("LogReader") {
     REQUIRE(log.load(corrupt_content.data(), corrupt_content.size()));
     REQUIRE(log.events.size() > 0);
   }
+  SECTION("decompressed cache") {
+    const std::string cache_file = cacheEntryPath(TEST_RLOG_URL, ".log");
+    system(("rm " + cache_file + " " + cacheFilePath(TEST_RLOG_URL) + " -f").c_str());
+
+    LogReader parsed, cached;
+    REQUIRE(parsed.load(TEST_RLOG_URL, nullptr, true));
+    REQUIRE(util::file_exists(cache_file));
+    // only the decompressed copy is kept
+    REQUIRE_FALSE(util::file_exists(cacheFilePath(TEST_RLOG_URL)));
+    REQUIRE(cached.load(TEST_RLOG_URL, nullptr, true));
+    REQUIRE(cached.events.size() == parsed.events.size());
+    for (size_t i = 0; i < parsed.events.size(); ++i) {
+      const auto &a = parsed.events[i], &b = cached.events[i];
+      REQUIRE((a.which == b.which && a.mono_time == b.mono_time && a.eidx_segnum == b.eidx_segnum));
+      REQUIRE(a.data.asBytes() == b.data.asBytes());
+    }
+  }
+}
+
+// size of the cache directory holding entry, not counting temporary files
+static uint64_t cacheSize(const std::string &entry) {
+  uint64_t total = 0;
+  const std::string cache_dir = entry.substr(0, entry.rfind('/') + 1);
+  DIR *dir = opendir(cache_dir.c_str());
+  while (struct dirent *ent = readdir(dir)) {
+    struct stat st;
+    if (!strstr(ent->d_name, ".tmp") && stat((cache_dir + ent->d_name).c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+      total += st.st_size;
+    }
+  }
+  closedir(dir);
+  return total;
+}
+
+TEST_CASE("cache entry") {
+  char filename[] = "/tmp/XXXXXX";
+  close(mkstemp(filename));
+  const std::string entry = cacheEntryPath(filename, ".test");
+  const std::string index = "index", data(100000, 'x');
+  REQUIRE(writeCacheEntry(entry, index, data));
+
+  std::string content;
+  std::string_view index_out, data_out;
+  REQUIRE(readCacheEntry(entry, content, index_out, data_out));
+  REQUIRE((index_out == index && data_out == data));
+  REQUIRE((uintptr_t)data_out.data() % 8 == 0);
+
+  SECTION("corrupt entry is removed") {
+    content[content.size() / 2] ^= 1;
+    util::write_file(entry.c_str(), content.data(), content.size(), O_WRONLY | O_TRUNC);
+    REQUIRE_FALSE(readCacheEntry(entry, content, index_out, data_out));
+    REQUIRE_FALSE(util::file_exists(entry));
+  }
+  SECTION("least recently used files are evicted") {
+    const std::string newer = cacheEntryPath(filename, ".test2");
+    struct timespec old_times[2] = {{.tv_sec = 1}, {.tv_sec = 1}};
+    utimensat(AT_FDCWD, entry.c_str(), old_times, 0);
+    REQUIRE(writeCacheEntry(newer, index, data));
+
+    // budget just below the current size, so only the oldest file goes
+    setCacheBudget(cacheSize(entry) - 1);
+    evictCacheFiles(newer);
+    setCacheBudget(20ull * 1024 * 1024 * 1024);
+    REQUIRE_FALSE(util::file_exists(entry));
+    REQUIRE(util::file_exists(newer));
+    unlink(newer.c_str());
+  }
+  SECTION("temporary files are not evicted") {
+    // a write in progress, possibly by another process
+    const std::string tmp = entry + ".tmp" + util::random_string(8);
+    util::write_file(tmp.c_str(), data.data(), data.size(), O_WRONLY | O_CREAT);
+    struct timespec old_times[2] = {{.tv_sec = 1}, {.tv_sec = 1}};
+    utimensat(AT_FDCWD, tmp.c_str(), old_times, 0);
+
+    // the cache is within budget when the oldest file, the temporary one, isn't counted
+    setCacheBudget(cacheSize(entry));
+    evictCacheFiles();
+    setCacheBudget(20ull * 1024 * 1024 * 1024);
+    REQUIRE(util::file_exists(tmp));
+    unlink(tmp.c_str());
+  }
+  SECTION("files of other tools are not counted or evicted") {
+    // e.g. the chunk files of tools/lib/url_file.py in the shared download cache
+    const std::string other = Path::download_cache_root() + "/" + util::random_string(16) + "_0";
+    util::write_file(other.c_str(), data.data(), data.size(), O_WRONLY | O_CREAT);
+    struct timespec old_times[2] = {{.tv_sec = 1}, {.tv_sec = 1}};
+    utimensat(AT_FDCWD, other.c_str(), old_times, 0);
+
+    setCacheBudget(cacheSize(entry));
+    evictCacheFiles();
+    setCacheBudget(20ull * 1024 * 1024 * 1024);
+    REQUIRE(util::file_exists(other));
+    REQUIRE(util::file_exists(entry));
+    unlink(other.c_str());
+  }
+  unlink(entry.c_str());
+  unlink(filename);
+}
+
+TEST_CASE("decompressZST") {
+  FileReader reader(true);
+  std::string content = decompressBZ2(reader.read(TEST_RLOG_URL));
+  REQUIRE(!content.empty());
+
+  // independent frames, as written by loggerd
+  const size_t frame_size = GENERATE(content.size(), 256 * 1024);
+  std::string compressed;
+  for (size_t pos = 0; pos < content.size(); pos += frame_size) {
+    const size_t size = std::min(frame_size, content.size() - pos);
+    std::string frame(ZSTD_compressBound(size), '\0');
+    frame.resize(ZSTD_compress(frame.data(), frame.size(), content.data() + pos, size, 3));
+    compressed += frame;
+  }
+  REQUIRE(decompressZST(compressed) == content);
+
+  SECTION("truncated log") {
+    compressed.resize(compressed.size() / 2);
+    std::string partial = decompressZST(compressed);
+    REQUIRE(content.compare(0, partial.size(), partial) == 0);
+  }
+
+  SECTION("corrupt content size") {
+    // set the first frame's content size field to its maximum
+    const uint8_t fhd = compressed[4];
+    const bool single_segment = fhd & 0x20;
+    const size_t offset = 5 + !single_segment + std::array{0, 1, 2, 4}[fhd & 3];
+    const size_t size = std::array{single_segment ? 1 : 0, 2, 4, 8}[fhd >> 6];
+    REQUIRE(size > 0);
+    memset(&compressed[offset], 0xff, size);
+    std::string out;
+    REQUIRE_NOTHROW(out = decompressZST(compressed));
+    REQUIRE(out.size() <= content.size());
+  }
 }
 
 void read_segment(int n, const SegmentFile &segment_file, uint32_t flags) {
@@ -174,3 +316,38 @@ TEST_CASE("seek_to") {
 
   loop.exec();
 }
+
+TEST_CASE("lockstep") {
+  Replay replay(DEMO_ROUTE, {"carState"}, {}, nullptr, REPLAY_FLAG_NO_VIPC | REPLAY_FLAG_FULL_SPEED,
+                QString::fromStdString(download_demo_route()));
+  if (messaging_use_zmq()) {
+    REQUIRE_FALSE(replay.setLockstepServices({"carState"}));
+    return;
+  }
+  REQUIRE(replay.setLockstepServices({"carState"}));
+
+  std::unique_ptr<Context> ctx(Context::create());
+  std::unique_ptr<SubSocket> fast(SubSocket::create(ctx.get(), "carState"));
+  std::unique_ptr<SubSocket> slow(SubSocket::create(ctx.get(), "carState"));
+  auto receive = [](SubSocket *sock) {
+    // segments are loaded through the event loop
+    for (int i = 0; i < 6000; ++i) {
+      if (std::unique_ptr<Message>(sock->receive(true))) return true;
+      QCoreApplication::processEvents();
+      util::sleep_for(5);
+    }
+    return false;
+  };
+
+  REQUIRE(replay.load());
+  replay.start();
+
+  for (int i = 0; i < 20; ++i) {
+    REQUIRE(receive(fast.get()));
+    // the next message waits until the slow subscriber has read this one too
+    util::sleep_for(20);
+    const bool published = std::unique_ptr<Message>(fast->receive(true)) != nullptr;
+    REQUIRE_FALSE(published);
+    REQUIRE(receive(slow.get()));
+  }
+}
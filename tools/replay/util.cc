@@ -3,6 +3,7 @@
 #include <bzlib.h>
 #include <curl/curl.h>
 #include <openssl/sha.h>
+#include <zstd.h>
 
 #include <cassert>
 #include <algorithm>
@@ -14,7 +15,9 @@
 #include <map>
 #include <mutex>
 #include <numeric>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include "common/timing.h"
 #include "common/util.h"
@@ -173,6 +176,148 @@ size_t getRemoteFileSize(const std::string &url, std::atomic<bool> *abort) {
   return content_length > 0 ? (size_t)content_length : 0;
 }
 
+namespace {
+
+struct ZstdFrame {
+  size_t src_offset, src_size;
+  size_t dst_offset, dst_size;
+};
+
+constexpr uint32_t ZSTD_SKIPPABLE_MAGIC_MASK = 0xFFFFFFF0;
+constexpr uint32_t ZSTD_SEEKABLE_MAGIC = 0x8F92EAB1;
+// The frame sizes are read from the file. Beyond this ratio they are taken as corrupt, and the
+// streaming decode is used instead, which only allocates what actually decompresses.
+constexpr size_t ZSTD_MAX_RATIO = 64;
+
+inline uint32_t readLE32(const std::byte *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// frame layout from the seek table written by loggerd (zstd seekable format)
+bool zstdFramesFromSeekTable(const std::byte *in, size_t in_size, std::vector<ZstdFrame> &frames) {
+  if (in_size < 17 || readLE32(in + in_size - 4) != ZSTD_SEEKABLE_MAGIC) return false;
+
+  const uint32_t num_frames = readLE32(in + in_size - 9);
+  const size_t entry_size = ((uint8_t)in[in_size - 5] & 0x80) ? 12 : 8;
+  const size_t table_size = 8 + (size_t)num_frames * entry_size + 9;
+  if (table_size > in_size || (readLE32(in + in_size - table_size) & ZSTD_SKIPPABLE_MAGIC_MASK) != ZSTD_MAGIC_SKIPPABLE_START) {
+    return false;
+  }
+
+  size_t src_offset = 0, dst_offset = 0;
+  const std::byte *entry = in + in_size - table_size + 8;
+  for (uint32_t i = 0; i < num_frames; ++i, entry += entry_size) {
+    const size_t src_size = readLE32(entry), dst_size = readLE32(entry + 4);
+    frames.push_back({src_offset, src_size, dst_offset, dst_size});
+    src_offset += src_size;
+    dst_offset += dst_size;
+  }
+  return src_offset == in_size - table_size;
+}
+
+// frame layout from the frame headers, for files without a seek table (e.g. unclean shutdown)
+bool zstdFramesFromHeaders(const std::byte *in, size_t in_size, std::vector<ZstdFrame> &frames) {
+  size_t src_offset = 0, dst_offset = 0;
+  while (src_offset < in_size) {
+    const size_t src_size = ZSTD_findFrameCompressedSize(in + src_offset, in_size - src_offset);
+    if (ZSTD_isError(src_size)) {
+      rWarning("decompressZST error : content is truncated or corrupt");
+      break;
+    }
+    if (in_size - src_offset < 4 || (readLE32(in + src_offset) & ZSTD_SKIPPABLE_MAGIC_MASK) != ZSTD_MAGIC_SKIPPABLE_START) {
+      const unsigned long long dst_size = ZSTD_getFrameContentSize(in + src_offset, src_size);
+      if (dst_size == ZSTD_CONTENTSIZE_UNKNOWN || dst_size == ZSTD_CONTENTSIZE_ERROR) return false;
+      if (dst_size / ZSTD_MAX_RATIO > in_size) return false;
+      frames.push_back({src_offset, src_size, dst_offset, (size_t)dst_size});
+      dst_offset += dst_size;
+    }
+    src_offset += src_size;
+  }
+  return true;
+}
+
+std::string decompressZSTStream(const std::byte *in, size_t in_size, std::atomic<bool> *abort) {
+  ZSTD_DCtx *dctx = ZSTD_createDCtx();
+  assert(dctx);
+
+  ZSTD_inBuffer input = {in, in_size, 0};
+  std::string out(in_size * 5, '\0');
+  ZSTD_outBuffer output = {out.data(), out.size(), 0};
+  size_t ret = 0;
+  while (input.pos < input.size && !(abort && *abort)) {
+    ret = ZSTD_decompressStream(dctx, &output, &input);
+    if (ZSTD_isError(ret)) {
+      rWarning("decompressZST error : %s", ZSTD_getErrorName(ret));
+      break;
+    }
+    if (output.pos == output.size) {
+      out.resize(out.size() * 2);
+      output.dst = out.data();
+      output.size = out.size();
+    }
+  }
+  ZSTD_freeDCtx(dctx);
+
+  if (ZSTD_isError(ret) || (abort && *abort)) return {};
+  out.resize(output.pos);
+  out.shrink_to_fit();
+  return out;
+}
+
+}  // namespace
+
+std::string decompressZST(const std::string &in, std::atomic<bool> *abort) {
+  return decompressZST((std::byte *)in.data(), in.size(), abort);
+}
+
+// frames are independent, so decompress them in parallel straight into the output buffer
+std::string decompressZST(const std::byte *in, size_t in_size, std::atomic<bool> *abort) {
+  if (in_size == 0) return {};
+
+  std::vector<ZstdFrame> frames;
+  if (!zstdFramesFromSeekTable(in, in_size, frames)) {
+    frames.clear();
+    if (!zstdFramesFromHeaders(in, in_size, frames)) {
+      return decompressZSTStream(in, in_size, abort);
+    }
+  }
+  if (frames.empty()) return {};
+  const size_t out_size = frames.back().dst_offset + frames.back().dst_size;
+  if (out_size / ZSTD_MAX_RATIO > in_size) {
+    return decompressZSTStream(in, in_size, abort);
+  }
+
+  std::string out(out_size, '\0');
+  std::atomic<size_t> next_frame = 0;
+  std::atomic<bool> failed = false;
+  auto worker = [&]() {
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    assert(dctx);
+    for (size_t i = next_frame++; i < frames.size() && !failed && !(abort && *abort); i = next_frame++) {
+      const ZstdFrame &f = frames[i];
+      size_t ret = ZSTD_decompressDCtx(dctx, &out[f.dst_offset], f.dst_size, in + f.src_offset, f.src_size);
+      if (ZSTD_isError(ret) || ret != f.dst_size) {
+        rWarning("decompressZST error : frame %zu is corrupt", i);
+        failed = true;
+      }
+    }
+    ZSTD_freeDCtx(dctx);
+  };
+
+  const size_t num_threads = std::min<size_t>(frames.size(), std::max(1u, std::thread::hardware_concurrency()));
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto &t : threads) t.join();
+
+  if (failed || (abort && *abort)) return {};
+  return out;
+}
+
 std::string getUrlWithoutQuery(const std::string &url) {
   size_t idx = url.find("?");
   return (idx == std::string::npos ? url : url.substr(0, idx));